@@ -12,6 +12,9 @@
 TEMPLATE = subdirs
 SUBDIRS = src
 
+# benchmarks need the plugin test hooks, enabled by TEST=1
+equals(TEST, 1): SUBDIRS += tests
+
 ####################################################################
 # This target 'make local' will build and
 # install the plugins to $HOME/.local/share/data/
@@ -0,0 +1,188 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#include "compilercache.h"
+#include "settings.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDebug>
+
+namespace LmBase {
+namespace Internal {
+
+const char CCACHE_DIR_NAME[]   = "ccache";
+const char CCACHE_CONF_NAME[]  = "ccache.conf";
+const char ENV_CCACHE_DIR[]    = "CCACHE_DIR";
+const char ENV_LMSDK_CCACHE[]  = "LMSDK_CCACHE";
+
+const char CompilerCache::CCACHE_EXECUTABLE[] = "/usr/bin/ccache";
+
+//indices into the ccache stats files
+enum CCacheStatsField {
+    StatsToCache    = 4,
+    StatsCacheHitCpp = 8,
+    StatsTotalSize  = 12,
+    StatsCacheHitDir = 22
+};
+
+double CompilerCache::Statistics::hitRate() const
+{
+    const quint64 total = hits + misses;
+    if (!total)
+        return 0.0;
+    return double(hits) * 100.0 / double(total);
+}
+
+Utils::FileName CompilerCache::rootPath()
+{
+    return Settings::settingsPath().appendPath(QLatin1String(CCACHE_DIR_NAME));
+}
+
+Utils::FileName CompilerCache::cachePath(const QString &architecture)
+{
+    return rootPath().appendPath(architecture);
+}
+
+/*!
+ * \brief CompilerCache::prepare
+ * Creates the cache directory for \a architecture and writes the
+ * configured maximum size into its ccache.conf
+ */
+bool CompilerCache::prepare(const QString &architecture)
+{
+    const Utils::FileName path = cachePath(architecture);
+    if (!QDir::root().mkpath(path.toString())) {
+        qWarning()<<"Unable to create the compiler cache directory"<<path.toString();
+        return false;
+    }
+
+    const QByteArray config = QStringLiteral("max_size = %1G\n")
+            .arg(Settings::compilerCacheSettings().maxSizeGb)
+            .toLatin1();
+
+    const QString confFile = Utils::FileName(path).appendPath(QLatin1String(CCACHE_CONF_NAME)).toString();
+    QFile existing(confFile);
+    if (existing.open(QIODevice::ReadOnly) && existing.readAll() == config)
+        return true;
+
+    QSaveFile conf(confFile);
+    if (!conf.open(QIODevice::WriteOnly)) {
+        qWarning()<<"Unable to write"<<confFile;
+        return false;
+    }
+    conf.write(config);
+    return conf.commit();
+}
+
+/*!
+ * \brief CompilerCache::environmentChanges
+ * Returns the environment a kit for \a architecture needs to use the cache,
+ * the list is empty if the compiler cache is disabled
+ */
+QList<Utils::EnvironmentItem> CompilerCache::environmentChanges(const QString &architecture)
+{
+    QList<Utils::EnvironmentItem> changes;
+    if (!Settings::compilerCacheSettings().enabled || architecture.isEmpty())
+        return changes;
+
+    if (!prepare(architecture))
+        return changes;
+
+    changes.append(Utils::EnvironmentItem(QLatin1String(ENV_CCACHE_DIR), cachePath(architecture).toString()));
+    changes.append(Utils::EnvironmentItem(QLatin1String(ENV_LMSDK_CCACHE), QLatin1String(CCACHE_EXECUTABLE)));
+    return changes;
+}
+
+/*!
+ * \brief CompilerCache::launcher
+ * Returns the command compilers for \a architecture are prefixed with,
+ * ccache is told where the cache is as the target does not see the
+ * environment of the kit
+ */
+QStringList CompilerCache::launcher(const QString &architecture)
+{
+    return QStringList{
+        QStringLiteral("env"),
+        QStringLiteral("%1=%2").arg(QLatin1String(ENV_CCACHE_DIR), cachePath(architecture).toString()),
+        QLatin1String(CCACHE_EXECUTABLE)
+    };
+}
+
+bool CompilerCache::isCacheVariable(const QString &name)
+{
+    return name == QLatin1String(ENV_CCACHE_DIR) || name == QLatin1String(ENV_LMSDK_CCACHE);
+}
+
+/*!
+ * \brief CompilerCache::isInstalled
+ * Checks if ccache is installed in the target with the given \a rootfs
+ */
+bool CompilerCache::isInstalled(const QString &rootfs)
+{
+    if (rootfs.isEmpty())
+        return false;
+    return QFileInfo(rootfs + QLatin1String(CCACHE_EXECUTABLE)).isExecutable();
+}
+
+/*!
+ * \brief CompilerCache::statistics
+ * Sums up the ccache stats files of the cache for \a architecture,
+ * this does not require ccache to be installed on the host
+ */
+CompilerCache::Statistics CompilerCache::statistics(const QString &architecture)
+{
+    Statistics stats;
+    stats.architecture = architecture;
+
+    const QString base = cachePath(architecture).toString();
+    QStringList statsFiles{ base + QStringLiteral("/stats") };
+    for (int i = 0; i < 16; i++)
+        statsFiles.append(QStringLiteral("%1/%2/stats").arg(base).arg(i, 0, 16));
+
+    foreach (const QString &fileName, statsFiles) {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly))
+            continue;
+
+        const QList<QByteArray> fields = file.readAll().split('\n');
+        auto field = [&fields](int idx) -> quint64 {
+            return idx < fields.size() ? fields.at(idx).trimmed().toULongLong() : 0;
+        };
+
+        stats.hits    += field(StatsCacheHitCpp) + field(StatsCacheHitDir);
+        stats.misses  += field(StatsToCache);
+        stats.sizeKiB += field(StatsTotalSize);
+    }
+
+    return stats;
+}
+
+QList<CompilerCache::Statistics> CompilerCache::allStatistics()
+{
+    QList<Statistics> result;
+    const QStringList architectures = QDir(rootPath().toString()).entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    foreach (const QString &arch, architectures)
+        result.append(statistics(arch));
+    return result;
+}
+
+} // namespace Internal
+} // namespace LmBase
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#ifndef LMBASE_INTERNAL_COMPILERCACHE_H
+#define LMBASE_INTERNAL_COMPILERCACHE_H
+
+#include <utils/fileutils.h>
+#include <utils/environment.h>
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+namespace LmBase {
+namespace Internal {
+
+/*!
+ * \brief The CompilerCache class
+ * Manages the ccache directories used by the targets. There is one cache
+ * per architecture, it lives in the settings directory which is shared
+ * with all targets. The build environment is not forwarded into the
+ * target, so the cache directory is passed on the command line: CMake kits
+ * use the launcher() as compiler launcher, the qmake wrapper prefixes the
+ * compilers with the same command if LMSDK_CCACHE is set.
+ */
+class CompilerCache
+{
+public:
+    struct Statistics {
+        QString architecture;
+        quint64 hits = 0;
+        quint64 misses = 0;
+        quint64 sizeKiB = 0;
+
+        double hitRate () const;
+    };
+
+    static Utils::FileName rootPath ();
+    static Utils::FileName cachePath (const QString &architecture);
+
+    static bool prepare (const QString &architecture);
+    static QList<Utils::EnvironmentItem> environmentChanges (const QString &architecture);
+    static QStringList launcher (const QString &architecture);
+    static bool isCacheVariable (const QString &name);
+    static bool isInstalled (const QString &rootfs);
+
+    static const char CCACHE_EXECUTABLE[];
+
+    static Statistics statistics (const QString &architecture);
+    static QList<Statistics> allStatistics ();
+};
+
+} // namespace Internal
+} // namespace LmBase
+
+#endif // LMBASE_INTERNAL_COMPILERCACHE_H
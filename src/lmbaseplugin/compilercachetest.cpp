@@ -0,0 +1,128 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+
+#include "compilercachetest.h"
+#include "compilercache.h"
+#include "lmqtversion.h"
+
+#include <QFile>
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QTest>
+
+namespace LmBase {
+namespace Internal {
+
+const char WRAPPER_STUB[] =
+        "#!/bin/sh\n"
+        "printf '%s\\n' \"$@\"\n";
+
+CompilerCacheTest::CompilerCacheTest()
+{
+}
+
+void CompilerCacheTest::initTestCase()
+{
+    if (LinkMotionQtVersion::qmakeWrapperScript().isEmpty())
+        QSKIP("The qmake wrapper is not installed");
+
+    QVERIFY(m_dir.isValid());
+
+    QFile stub(m_dir.path() + QStringLiteral("/lmsdk-wrapper"));
+    QVERIFY(stub.open(QIODevice::WriteOnly));
+    stub.write(WRAPPER_STUB);
+    stub.close();
+    QVERIFY(stub.setPermissions(stub.permissions() | QFile::ExeOwner));
+}
+
+void CompilerCacheTest::testQmakeWrapper_data()
+{
+    QTest::addColumn<QString>("ccache");
+    QTest::addColumn<QString>("cacheDir");
+    QTest::addColumn<QStringList>("arguments");
+    QTest::addColumn<QStringList>("expected");
+
+    const QStringList configure{
+        QStringLiteral("/home/user/app/app.pro"),
+        QStringLiteral("-spec"), QStringLiteral("linux-g++"),
+        QStringLiteral("CONFIG+=debug")
+    };
+    const QString ccache = QLatin1String(CompilerCache::CCACHE_EXECUTABLE);
+    const QString cacheDir = QStringLiteral("/home/user/.config/linkmotion/ccache/x86_64");
+    const QString launcher = QStringLiteral("env CCACHE_DIR=%1 %2").arg(cacheDir, ccache);
+
+    QTest::newRow("configure")
+            << ccache
+            << cacheDir
+            << configure
+            << (QStringList(configure)
+                << QStringLiteral("-after")
+                << QStringLiteral("!contains(QMAKE_CC, .*ccache.*): QMAKE_CC = %1 $$QMAKE_CC").arg(launcher)
+                << QStringLiteral("!contains(QMAKE_CXX, .*ccache.*): QMAKE_CXX = %1 $$QMAKE_CXX").arg(launcher));
+    QTest::newRow("default-cache-dir")
+            << ccache
+            << QString()
+            << configure
+            << (QStringList(configure)
+                << QStringLiteral("-after")
+                << QStringLiteral("!contains(QMAKE_CC, .*ccache.*): QMAKE_CC = %1 $$QMAKE_CC").arg(ccache)
+                << QStringLiteral("!contains(QMAKE_CXX, .*ccache.*): QMAKE_CXX = %1 $$QMAKE_CXX").arg(ccache));
+    QTest::newRow("cache-disabled")
+            << QString()
+            << QString()
+            << configure
+            << configure;
+    QTest::newRow("no-project")
+            << ccache
+            << cacheDir
+            << QStringList{ QStringLiteral("-v") }
+            << QStringList{ QStringLiteral("-v") };
+}
+
+void CompilerCacheTest::testQmakeWrapper()
+{
+    QFETCH(QString, ccache);
+    QFETCH(QString, cacheDir);
+    QFETCH(QStringList, arguments);
+    QFETCH(QStringList, expected);
+
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    env.insert(QStringLiteral("PATH"), m_dir.path() + QLatin1Char(':') + env.value(QStringLiteral("PATH")));
+    if (ccache.isEmpty())
+        env.remove(QStringLiteral("LMSDK_CCACHE"));
+    else
+        env.insert(QStringLiteral("LMSDK_CCACHE"), ccache);
+    if (cacheDir.isEmpty())
+        env.remove(QStringLiteral("CCACHE_DIR"));
+    else
+        env.insert(QStringLiteral("CCACHE_DIR"), cacheDir);
+
+    QProcess qmake;
+    qmake.setProcessEnvironment(env);
+    qmake.start(LinkMotionQtVersion::qmakeWrapperScript(), arguments);
+    QVERIFY(qmake.waitForFinished());
+    QCOMPARE(qmake.exitCode(), 0);
+
+    const QStringList received = QString::fromLocal8Bit(qmake.readAllStandardOutput())
+            .split(QLatin1Char('\n'), QString::SkipEmptyParts);
+    QCOMPARE(received, expected);
+}
+
+} // namespace Internal
+} // namespace LmBase
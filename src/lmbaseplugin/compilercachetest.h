@@ -0,0 +1,54 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+
+#ifndef LMBASE_INTERNAL_COMPILERCACHETEST_H
+#define LMBASE_INTERNAL_COMPILERCACHETEST_H
+
+#include <QObject>
+#include <QStringList>
+#include <QTemporaryDir>
+
+namespace LmBase {
+namespace Internal {
+
+/*!
+ * \brief The CompilerCacheTest class
+ * Checks that qmake projects are built through ccache, the qmake
+ * wrapper is run against a lmsdk-wrapper stub printing its arguments
+ */
+class CompilerCacheTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    CompilerCacheTest ();
+
+private slots:
+    void initTestCase ();
+    void testQmakeWrapper_data ();
+    void testQmakeWrapper ();
+
+private:
+    QTemporaryDir m_dir;
+};
+
+} // namespace Internal
+} // namespace LmBase
+
+#endif // LMBASE_INTERNAL_COMPILERCACHETEST_H
@@ -0,0 +1,356 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#include "debugindexcache.h"
+#include "lmbaseplugin_constants.h"
+#include "lmtargetregistry.h"
+#include "lmtargettool.h"
+#include "lmtoolchain.h"
+#include "sysrootpathtranslator.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QSet>
+#include <QDebug>
+
+namespace LmBase {
+namespace Internal {
+
+enum {
+    debug = 0
+};
+
+const char INDEX_STAMP_FILE[] = ".lmsdk-stamp";
+
+//the index cache was added in gdb 8.3
+const int MIN_DEBUGGER_MAJOR = 8;
+const int MIN_DEBUGGER_MINOR = 3;
+
+DebugIndexCache *DebugIndexCache::m_instance = nullptr;
+
+DebugIndexCache::DebugIndexCache(QObject *parent)
+    : QObject(parent)
+{
+    Q_ASSERT_X(!m_instance, Q_FUNC_INFO, "There can be only one DebugIndexCache instance");
+    m_instance = this;
+}
+
+DebugIndexCache::~DebugIndexCache()
+{
+    stopAll();
+    m_instance = nullptr;
+}
+
+DebugIndexCache *DebugIndexCache::instance()
+{
+    return m_instance;
+}
+
+/*!
+ * \brief DebugIndexCache::debuggerScript
+ * Returns the script used as host debugger of the kits,
+ * or a empty string if it is not installed
+ */
+QString DebugIndexCache::debuggerScript()
+{
+    //the wrappers are provisioned from the worker threads
+    static const QString script = [](){
+        QFileInfo info(QString::fromLatin1(Constants::LM_GDB_WRAPPER_SCRIPT).arg(Constants::LM_SCRIPTPATH));
+        return info.isExecutable() ? info.absoluteFilePath() : QString();
+    }();
+    return script;
+}
+
+/*!
+ * \brief DebugIndexCache::indexDirectory
+ * The cache lives next to the rootfs, where the debugger
+ * wrapper of the target finds it
+ */
+Utils::FileName DebugIndexCache::indexDirectory(const QString &containerName)
+{
+    const QString rootfs = TargetRegistry::instance()->rootfs(containerName);
+    if (rootfs.isEmpty())
+        return Utils::FileName();
+
+    return Utils::FileName::fromString(rootfs)
+            .parentDir()
+            .appendPath(QLatin1String(Constants::LM_GDB_INDEX_CACHE));
+}
+
+/*!
+ * \brief DebugIndexCache::prepare
+ * Schedules indexing the libraries of \a containerName, nothing
+ * happens if they were indexed already for the current target
+ */
+void DebugIndexCache::prepare(const QString &containerName)
+{
+    if (debuggerScript().isEmpty() || m_support == Unsupported)
+        return;
+
+    if (m_current == containerName || m_queue.contains(containerName))
+        return;
+
+    if (m_support == Supported && m_indexed.value(containerName) == indexStamp(containerName))
+        return;
+
+    m_queue.append(containerName);
+
+    if (m_support == Unknown)
+        checkDebugger();
+    else
+        startNext();
+}
+
+/*!
+ * \brief DebugIndexCache::invalidate
+ * Throws away the index of \a containerName and builds it again, used
+ * after the target was upgraded. Indexing starts once the running
+ * registry refresh finished, the stamp depends on the upgraded image.
+ */
+void DebugIndexCache::invalidate(const QString &containerName)
+{
+    if (m_current == containerName && m_process) {
+        m_process->disconnect(this);
+        m_process->kill();
+        m_process->deleteLater();
+        m_process = nullptr;
+        m_current.clear();
+    }
+
+    m_indexed.remove(containerName);
+    m_queue.removeAll(containerName);
+
+    const Utils::FileName dir = indexDirectory(containerName);
+    if (!dir.isEmpty())
+        QDir(dir.toString()).removeRecursively();
+
+    prepare(containerName);
+}
+
+void DebugIndexCache::stopAll()
+{
+    m_queue.clear();
+    if (m_process) {
+        m_process->disconnect(this);
+        m_process->kill();
+        m_process->waitForFinished(1000);
+        delete m_process;
+        m_process = nullptr;
+    }
+    m_current.clear();
+}
+
+/*!
+ * \brief DebugIndexCache::checkDebugger
+ * Finds out if the host debugger knows about the index cache, without
+ * the cache directory the wrapper runs gdb without it
+ */
+void DebugIndexCache::checkDebugger()
+{
+    m_support = Checking;
+
+    QProcess *proc = new QProcess(this);
+    connect(proc, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+            this, [this, proc]() {
+        const QString version = QString::fromLocal8Bit(proc->readAllStandardOutput())
+                .section(QLatin1Char('\n'), 0, 0).trimmed();
+        proc->deleteLater();
+
+        const QRegularExpressionMatch match
+                = QRegularExpression(QStringLiteral("(\\d+)\\.(\\d+)\\S*$")).match(version);
+        const int major = match.captured(1).toInt();
+        const int minor = match.captured(2).toInt();
+
+        if (match.hasMatch() && (major > MIN_DEBUGGER_MAJOR
+                                 || (major == MIN_DEBUGGER_MAJOR && minor >= MIN_DEBUGGER_MINOR))) {
+            m_support = Supported;
+            m_debuggerVersion = version;
+            startNext();
+            return;
+        }
+
+        if (debug) qDebug()<<"No gdb index cache support in"<<version;
+        m_support = Unsupported;
+        m_queue.clear();
+    });
+    connect(proc, &QProcess::errorOccurred, this, [this, proc](QProcess::ProcessError err) {
+        if (err != QProcess::FailedToStart)
+            return;
+        proc->deleteLater();
+        m_support = Unsupported;
+        m_queue.clear();
+    });
+
+    proc->start(QLatin1String(Constants::LM_GDB_WRAPPER_NAME), QStringList{QStringLiteral("--version")});
+}
+
+/*!
+ * \brief DebugIndexCache::startNext
+ * Lets gdb read the libraries of the next target in the queue, the
+ * wrapper makes it store their index in the cache of the target. While
+ * the registry is refreshing nothing is started, the stamps might be
+ * outdated, the queue is picked up again when the refresh finished.
+ */
+void DebugIndexCache::startNext()
+{
+    if (m_process || m_support != Supported || TargetRegistry::instance()->isRefreshing())
+        return;
+
+    while (!m_queue.isEmpty()) {
+        const QString containerName = m_queue.takeFirst();
+        const QByteArray stamp = indexStamp(containerName);
+        const QString dir = indexDirectory(containerName).toString();
+        if (stamp.isEmpty() || dir.isEmpty() || !QDir::root().mkpath(dir))
+            continue;
+
+        QFile stampFile(QDir(dir).filePath(QLatin1String(INDEX_STAMP_FILE)));
+        if (stampFile.open(QIODevice::ReadOnly) && stampFile.readAll() == stamp) {
+            m_indexed.insert(containerName, stamp);
+            continue;
+        }
+
+        const QString rootfs = TargetRegistry::instance()->rootfs(containerName);
+        const QString debugger = LinkMotionTargetTool::findOrCreateToolWrapper(
+                    QLatin1String(Constants::LM_GDB_WRAPPER_NAME),
+                    TargetRegistry::instance()->targetInfo(containerName).target);
+        const QStringList libraries = librariesToIndex(containerName);
+        if (debugger.isEmpty() || libraries.isEmpty())
+            continue;
+
+        QStringList args{
+            QStringLiteral("-nx"),
+            QStringLiteral("-batch"),
+            QStringLiteral("-iex"),
+            QStringLiteral("set debug-file-directory %1/usr/lib/debug").arg(rootfs)
+        };
+        foreach (const QString &lib, libraries)
+            args << QStringLiteral("-ex") << QStringLiteral("file %1").arg(lib);
+
+        if (debug) qDebug()<<"Indexing"<<libraries.size()<<"libraries of"<<containerName;
+
+        m_current = containerName;
+        m_currentStamp = stamp;
+        m_process = new QProcess(this);
+        m_process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        m_process->setStandardOutputFile(QProcess::nullDevice());
+        connect(m_process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+                this, [this](int, QProcess::ExitStatus status) { indexFinished(status == QProcess::NormalExit); });
+        connect(m_process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError err) {
+            if (err == QProcess::FailedToStart)
+                indexFinished(false);
+        });
+        m_process->start(debugger, args);
+        return;
+    }
+}
+
+void DebugIndexCache::indexFinished(bool success)
+{
+    m_process->deleteLater();
+    m_process = nullptr;
+
+    const QString containerName = m_current;
+    const QByteArray stamp = m_currentStamp;
+    m_current.clear();
+    m_currentStamp.clear();
+
+    if (success) {
+        QSaveFile stampFile(indexDirectory(containerName).appendPath(QLatin1String(INDEX_STAMP_FILE)).toString());
+        if (stampFile.open(QIODevice::WriteOnly)) {
+            stampFile.write(stamp);
+            stampFile.commit();
+        }
+        m_indexed.insert(containerName, stamp);
+    } else {
+        qWarning()<<"Indexing the debug info of"<<containerName<<"failed";
+    }
+
+    startNext();
+}
+
+/*!
+ * \brief DebugIndexCache::indexStamp
+ * Changes whenever the index of \a containerName has to be built
+ * again, because the image or the debugger changed
+ */
+QByteArray DebugIndexCache::indexStamp(const QString &containerName) const
+{
+    const TargetRegistry::TargetInfo info = TargetRegistry::instance()->targetInfo(containerName);
+    if (info.rootfs.isEmpty())
+        return QByteArray();
+
+    return QStringList{
+        info.target.distribution,
+        info.target.version,
+        QString::number(info.rootfsStamp),
+        m_debuggerVersion
+    }.join(QLatin1Char('\n')).toUtf8();
+}
+
+/*!
+ * \brief DebugIndexCache::librariesToIndex
+ * The Qt libraries are the biggest part of the debug info an
+ * application loads, the rest is indexed on first use
+ */
+QStringList DebugIndexCache::librariesToIndex(const QString &containerName)
+{
+    const TargetRegistry::TargetInfo info = TargetRegistry::instance()->targetInfo(containerName);
+    if (info.rootfs.isEmpty())
+        return QStringList();
+
+    const QString triplet = LinkMotionToolChain::gnutriplet(
+                LinkMotionToolChain::architectureNameToAbi(info.target.architecture));
+    const QStringList filters{
+        QStringLiteral("libQt5*.so.5"),
+        QStringLiteral("libstdc++.so.6")
+    };
+
+    //links in the rootfs can be absolute, they have to be followed inside of it.
+    //Broken links only look broken from the host, so they are listed as well
+    const SysrootPathTranslator::Ptr translator
+            = SysrootPathTranslator::forSysroot(Utils::FileName::fromString(info.rootfs));
+
+    QSet<QString> known;
+    QStringList libraries;
+    foreach (const QString &libDir, QStringList{QStringLiteral("/lib"), QStringLiteral("/usr/lib")}) {
+        //with a merged /usr both directories are the same
+        const QString dirPath = translator->resolve(libDir).absoluteFilePath();
+        if (known.contains(dirPath))
+            continue;
+        known.insert(dirPath);
+
+        const QString containerDir = QStringLiteral("%1/%2").arg(libDir).arg(triplet);
+        QDir dir(translator->resolve(containerDir).absoluteFilePath());
+        foreach (const QString &fileName, dir.entryList(filters, QDir::Files | QDir::System)) {
+            const QFileInfo lib = translator->resolve(containerDir + QLatin1Char('/') + fileName);
+            const QString path = lib.absoluteFilePath();
+            if (!lib.isFile() || known.contains(path))
+                continue;
+            known.insert(path);
+            libraries.append(path);
+        }
+    }
+    return libraries;
+}
+
+} // namespace Internal
+} // namespace LmBase
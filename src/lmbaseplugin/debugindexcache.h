@@ -0,0 +1,91 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#ifndef LMBASE_INTERNAL_DEBUGINDEXCACHE_H
+#define LMBASE_INTERNAL_DEBUGINDEXCACHE_H
+
+#include <utils/fileutils.h>
+
+#include <QObject>
+#include <QHash>
+#include <QStringList>
+
+QT_BEGIN_NAMESPACE
+class QProcess;
+QT_END_NAMESPACE
+
+namespace LmBase {
+namespace Internal {
+
+/*!
+ * \brief The DebugIndexCache class
+ * Keeps a gdb index cache for every target that is used by a project. The
+ * debugger of the kits is a wrapper that points gdb to the cache of its
+ * target, so the debug info of the rootfs libraries is only indexed once.
+ * The Qt libraries of a target are indexed in the background, one target
+ * at a time, and again after the target was upgraded.
+ */
+class DebugIndexCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DebugIndexCache(QObject *parent = 0);
+    ~DebugIndexCache();
+
+    static DebugIndexCache *instance ();
+
+    static QString debuggerScript ();
+    static Utils::FileName indexDirectory (const QString &containerName);
+
+public slots:
+    void prepare (const QString &containerName);
+    void invalidate (const QString &containerName);
+    void startNext ();
+    void stopAll ();
+
+private:
+    void checkDebugger ();
+    void indexFinished (bool success);
+
+    QByteArray indexStamp (const QString &containerName) const;
+    static QStringList librariesToIndex (const QString &containerName);
+
+private:
+    enum DebuggerSupport {
+        Unknown,
+        Checking,
+        Supported,
+        Unsupported
+    };
+
+    static DebugIndexCache *m_instance;
+
+    DebuggerSupport m_support = Unknown;
+    QString m_debuggerVersion;
+    QStringList m_queue;
+    QHash<QString, QByteArray> m_indexed; //container -> stamp of the last index run
+    QString m_current;
+    QByteArray m_currentStamp;
+    QProcess *m_process = nullptr;
+};
+
+} // namespace Internal
+} // namespace LmBase
+
+#endif // LMBASE_INTERNAL_DEBUGINDEXCACHE_H
@@ -6,7 +6,14 @@ HEADERS += \
     $$PWD/containerprocesslist.h \
     $$PWD/containerdevicesignaloperation.h \
     $$PWD/containerdeviceprocess.h \
+    $$PWD/containerexecprocess.h \
+    $$PWD/containerpidfilter.h \
+    $$PWD/containerlauncher.h \
+    $$PWD/percontainer.h \
+    $$PWD/containerweston.h \
     $$PWD/containerdevice_p.h \
+    $$PWD/containerdetection.h \
+    $$PWD/containerconnection.h \
     $$PWD/containerdevicefactory.h \
     $$PWD/containerdevice.h
 
@@ -18,5 +25,16 @@ SOURCES += \
     $$PWD/containerprocesslist.cpp \
     $$PWD/containerdevicesignaloperation.cpp \
     $$PWD/containerdeviceprocess.cpp \
+    $$PWD/containerexecprocess.cpp \
+    $$PWD/containerpidfilter.cpp \
+    $$PWD/containerlauncher.cpp \
+    $$PWD/containerweston.cpp \
     $$PWD/containerdevicefactory.cpp \
+    $$PWD/containerdetection.cpp \
+    $$PWD/containerconnection.cpp \
     $$PWD/containerdevice.cpp
+
+equals(TEST, 1) {
+    HEADERS += $$PWD/containerpidfiltertest.h
+    SOURCES += $$PWD/containerpidfiltertest.cpp
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#include "containerconnection.h"
+#include "containerdevice.h"
+#include "percontainer.h"
+
+#include <projectexplorer/devicesupport/devicemanager.h>
+#include <ssh/sshconnection.h>
+#include <ssh/sshconnectionmanager.h>
+
+#include <QDebug>
+
+namespace LmBase {
+namespace Internal {
+
+enum {
+    debug = 0
+};
+
+//a connection that was lost while the device is still ready, e.g. because
+//sshd inside the container was restarted, is opened again after this delay
+const int RECONNECT_DELAY = 5000;
+
+ContainerConnection::Ptr ContainerConnection::forContainer(const QString &containerName)
+{
+    return PerContainer<ContainerConnection>::instance(containerName, [&containerName]() {
+        return new ContainerConnection(containerName);
+    }, &ContainerConnection::update);
+}
+
+ContainerConnection::ContainerConnection(const QString &containerName)
+    : QObject(nullptr)
+    , m_deviceId(ContainerDevice::createIdForContainer(containerName))
+{
+    m_reconnectTimer.setSingleShot(true);
+    m_reconnectTimer.setInterval(RECONNECT_DELAY);
+    connect(&m_reconnectTimer, &QTimer::timeout, this, &ContainerConnection::update);
+
+    ProjectExplorer::DeviceManager *devMgr = ProjectExplorer::DeviceManager::instance();
+    connect(devMgr, &ProjectExplorer::DeviceManager::deviceAdded,
+            this, &ContainerConnection::handleDeviceUpdated);
+    connect(devMgr, &ProjectExplorer::DeviceManager::deviceUpdated,
+            this, &ContainerConnection::handleDeviceUpdated);
+    connect(devMgr, &ProjectExplorer::DeviceManager::deviceListReplaced,
+            this, &ContainerConnection::update);
+}
+
+ContainerConnection::~ContainerConnection()
+{
+    release();
+}
+
+bool ContainerConnection::isConnected() const
+{
+    return m_connection && m_connection->state() == QSsh::SshConnection::Connected;
+}
+
+/*!
+ * \brief ContainerConnection::update
+ * Opens the connection when the registered device became ready to use,
+ * or gives it back if the device is gone or was disconnected. If the
+ * SSH parameters of the device changed the connection is opened again
+ */
+void ContainerConnection::update()
+{
+    m_reconnectTimer.stop();
+
+    ProjectExplorer::IDevice::ConstPtr device = ProjectExplorer::DeviceManager::instance()->find(m_deviceId);
+    if (!device || device->deviceState() != ProjectExplorer::IDevice::DeviceReadyToUse) {
+        release();
+        return;
+    }
+
+    const QSsh::SshConnectionParameters params = device->sshParameters();
+    if (m_connection && m_connection->connectionParameters() == params)
+        return;
+
+    release();
+
+    if (debug) qDebug()<<"Opening the shared connection to"<<m_deviceId.toString();
+
+    m_connection = QSsh::acquireConnection(params);
+    connect(m_connection, &QSsh::SshConnection::disconnected,
+            this, &ContainerConnection::handleConnectionLost);
+    connect(m_connection, &QSsh::SshConnection::error,
+            this, &ContainerConnection::handleConnectionLost);
+
+    if (m_connection->state() == QSsh::SshConnection::Unconnected)
+        m_connection->connectToHost();
+}
+
+void ContainerConnection::handleDeviceUpdated(Core::Id id)
+{
+    if (id == m_deviceId)
+        update();
+}
+
+void ContainerConnection::handleConnectionLost()
+{
+    if (debug) qDebug()<<"Lost the shared connection to"<<m_deviceId.toString();
+
+    //a disconnected connection is deleted by the connection manager
+    release();
+    m_reconnectTimer.start();
+}
+
+void ContainerConnection::release()
+{
+    if (!m_connection)
+        return;
+
+    m_connection->disconnect(this);
+    QSsh::releaseConnection(m_connection);
+    m_connection = nullptr;
+}
+
+} // namespace Internal
+} // namespace LmBase
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#ifndef LM_INTERNAL_CONTAINERCONNECTION_H
+#define LM_INTERNAL_CONTAINERCONNECTION_H
+
+#include <coreplugin/id.h>
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QTimer>
+
+namespace QSsh { class SshConnection; }
+
+namespace LmBase {
+namespace Internal {
+
+/*!
+ * \brief The ContainerConnection class
+ * Keeps one authenticated SSH connection to a container open while its
+ * device is ready to use. The connection is held by the QSsh connection
+ * manager, so every process, signal, debugger and profiler channel that
+ * acquires a connection with the parameters of the device is multiplexed
+ * over it instead of doing a new handshake.
+ *
+ * There is one connection per container, shared by all ContainerDevice
+ * instances and their clones.
+ */
+class ContainerConnection : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef QSharedPointer<ContainerConnection> Ptr;
+
+    static Ptr forContainer (const QString &containerName);
+    ~ContainerConnection ();
+
+    bool isConnected () const;
+
+private slots:
+    void update ();
+    void handleDeviceUpdated (Core::Id id);
+    void handleConnectionLost ();
+
+private:
+    explicit ContainerConnection (const QString &containerName);
+
+    void release ();
+
+private:
+    Core::Id m_deviceId;
+    QSsh::SshConnection *m_connection = nullptr;
+    QTimer m_reconnectTimer;
+};
+
+} // namespace Internal
+} // namespace LmBase
+
+#endif // LM_INTERNAL_CONTAINERCONNECTION_H
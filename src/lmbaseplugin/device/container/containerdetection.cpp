@@ -0,0 +1,734 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#include "containerdetection.h"
+#include "containerdevice.h"
+#include "percontainer.h"
+
+#include <lmbaseplugin/lmbaseplugin_constants.h>
+#include <lmbaseplugin/lmbaseplugin.h>
+#include <lmbaseplugin/lmtargetregistry.h>
+#include <lmbaseplugin/lmtargettool.h>
+#include <lmbaseplugin/settings.h>
+#include <lmbaseplugin/lxd/lxdclient.h>
+#include <lmbaseplugin/lxd/lxdeventmonitor.h>
+
+#include <projectexplorer/kitinformation.h>
+#include <projectexplorer/kitmanager.h>
+#include <projectexplorer/project.h>
+#include <projectexplorer/session.h>
+#include <projectexplorer/target.h>
+#include <projectexplorer/taskhub.h>
+#include <ssh/sshkeygenerator.h>
+#include <utils/fileutils.h>
+#include <utils/runextensions.h>
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLockFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+
+namespace LmBase {
+namespace Internal {
+
+//failed detections are retried with a exponential backoff, while the LXD events
+//are available a container that is started or stopped is picked up right away
+const int FIRST_RETRY_INTERVAL = 1000;
+const int MAX_RETRY_INTERVAL = 60000;
+const int MAX_RETRY_INTERVAL_WITH_EVENTS = 300000;
+
+//one container state change usually comes with several events
+const int EVENT_COMPRESSION_DELAY = 200;
+
+//the file sshd of the targets reads the authorized keys from
+const char AUTHORIZED_KEYS_DIR[]  = "/etc/ssh/authorized_keys.d";
+const char AUTHORIZED_KEYS_FILE[] = "/etc/ssh/authorized_keys.d/key";
+
+//all running Qt Creator instances share the identity, only one may generate it
+const char SSHIDENTITY_LOCK[] = ".keylock";
+const int  SSHIDENTITY_LOCK_TIMEOUT = 10000;
+
+struct KeyDeployment {
+    enum Result {
+        Deployed,
+        NeedsTargetTool,
+        Failed
+    };
+
+    Result result = Failed;
+    QByteArray publicKey;
+    QString error;
+};
+
+static QString identityFile()
+{
+    return Settings::settingsPath()
+            .appendPath(QLatin1String(Constants::LM_DEVICE_SSHIDENTITY))
+            .toString();
+}
+
+static QString keyStampFile(const QString &rootfs)
+{
+    return Utils::FileName::fromString(rootfs)
+            .parentDir()
+            .appendPath(QLatin1String(Constants::LM_DEVICE_SSHKEY_STAMP))
+            .toString();
+}
+
+/*!
+ * \brief keyStamp
+ * Returns the checksum of the public key and the authorized keys file
+ * of the target, if the key file was touched the checksum changes
+ */
+static QByteArray keyStamp(const QString &rootfs, const QString &identity)
+{
+    QFile publicKey(identity + QStringLiteral(".pub"));
+    if (!publicKey.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    const QFileInfo keys(rootfs + QLatin1String(AUTHORIZED_KEYS_FILE));
+    if (!keys.exists())
+        return QByteArray();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(publicKey.readAll().trimmed());
+    hash.addData(QByteArray::number(keys.size()));
+    hash.addData(QByteArray::number(keys.lastModified().toMSecsSinceEpoch()));
+    return hash.result().toHex();
+}
+
+static bool isKeyDeployed(const QString &rootfs, const QString &identity)
+{
+    if (rootfs.isEmpty())
+        return false;
+
+    const QByteArray stamp = keyStamp(rootfs, identity);
+    if (stamp.isEmpty())
+        return false;
+
+    QFile stampFile(keyStampFile(rootfs));
+    if (!stampFile.open(QIODevice::ReadOnly))
+        return false;
+    return stampFile.readAll().trimmed() == stamp;
+}
+
+static void writeKeyStamp(const QString &rootfs, const QString &identity)
+{
+    const QByteArray stamp = keyStamp(rootfs, identity);
+    if (stamp.isEmpty())
+        return;
+
+    QSaveFile stampFile(keyStampFile(rootfs));
+    if (!stampFile.open(QIODevice::WriteOnly))
+        return;
+    stampFile.write(stamp);
+    stampFile.commit();
+}
+
+/*!
+ * \brief ensureIdentity
+ * Returns the public key of the SSH identity used for all devices,
+ * the identity is generated if it does not exist yet. ECDSA keys
+ * are generated in a few milliseconds
+ */
+static QByteArray ensureIdentity(const QString &identity, QString *error)
+{
+    static QMutex mutex;
+    QMutexLocker processLock(&mutex);
+
+    QLockFile lock(QFileInfo(identity).absoluteDir().filePath(QLatin1String(SSHIDENTITY_LOCK)));
+    if (!lock.tryLock(SSHIDENTITY_LOCK_TIMEOUT)) {
+        *error = QCoreApplication::translate("LmBase::Internal::ContainerDetection",
+                                             "Unable to lock the SSH identity %1.").arg(identity);
+        return QByteArray();
+    }
+
+    QFile publicKey(identity + QStringLiteral(".pub"));
+    if (QFileInfo(identity).isFile() && publicKey.open(QIODevice::ReadOnly)) {
+        const QByteArray key = publicKey.readAll().trimmed();
+        if (!key.isEmpty())
+            return key;
+    }
+
+    QSsh::SshKeyGenerator generator;
+    if (!generator.generateKeys(QSsh::SshKeyGenerator::Ecdsa,
+                                QSsh::SshKeyGenerator::OpenSsl,
+                                256,
+                                QSsh::SshKeyGenerator::DoNotOfferEncryption)) {
+        *error = generator.error();
+        return QByteArray();
+    }
+
+    QSaveFile privateFile(identity);
+    if (!privateFile.open(QIODevice::WriteOnly)
+            || !privateFile.setPermissions(QFile::ReadOwner | QFile::WriteOwner)
+            || privateFile.write(generator.privateKey()) < 0
+            || !privateFile.commit()) {
+        *error = QCoreApplication::translate("LmBase::Internal::ContainerDetection",
+                                             "Unable to write the SSH identity %1.").arg(identity);
+        return QByteArray();
+    }
+
+    const QByteArray key = generator.publicKey().trimmed();
+    QSaveFile publicFile(identity + QStringLiteral(".pub"));
+    if (!publicFile.open(QIODevice::WriteOnly)
+            || publicFile.write(key + '\n') < 0
+            || !publicFile.commit()) {
+        *error = QCoreApplication::translate("LmBase::Internal::ContainerDetection",
+                                             "Unable to write the SSH identity %1.").arg(publicFile.fileName());
+        return QByteArray();
+    }
+    return key;
+}
+
+/*!
+ * \brief containsKey
+ * Compares the type and key data of all lines in \a authorizedKeys
+ * with \a publicKey, the comment is ignored
+ */
+static bool containsKey(const QByteArray &authorizedKeys, const QByteArray &publicKey)
+{
+    const QList<QByteArray> key = publicKey.simplified().split(' ');
+    if (key.size() < 2)
+        return false;
+
+    foreach (const QByteArray &line, authorizedKeys.split('\n')) {
+        const QList<QByteArray> fields = line.simplified().split(' ');
+        if (fields.size() >= 2 && fields.at(0) == key.at(0) && fields.at(1) == key.at(1))
+            return true;
+    }
+    return false;
+}
+
+/*!
+ * \brief deployKeyToRootfs
+ * Adds the public key to the authorized keys of the target by writing
+ * directly into its rootfs. If the rootfs is not writable for the user
+ * the caller has to fall back to lmsdk-target
+ */
+static KeyDeployment deployKeyToRootfs(const QString &rootfs, const QString &identity)
+{
+    KeyDeployment deployment;
+    deployment.publicKey = ensureIdentity(identity, &deployment.error);
+    if (deployment.publicKey.isEmpty())
+        return deployment;
+
+    deployment.result = KeyDeployment::NeedsTargetTool;
+    if (rootfs.isEmpty())
+        return deployment;
+
+    QFile keys(rootfs + QLatin1String(AUTHORIZED_KEYS_FILE));
+    if (keys.exists()) {
+        if (!keys.open(QIODevice::ReadOnly))
+            return deployment;
+
+        const QByteArray authorizedKeys = keys.readAll();
+        keys.close();
+        if (containsKey(authorizedKeys, deployment.publicKey)) {
+            writeKeyStamp(rootfs, identity);
+            deployment.result = KeyDeployment::Deployed;
+            return deployment;
+        }
+    } else if (!QDir().mkpath(rootfs + QLatin1String(AUTHORIZED_KEYS_DIR))) {
+        return deployment;
+    }
+
+    //appending keeps owner and permissions of the existing file
+    const bool created = !keys.exists();
+    if (!keys.open(QIODevice::WriteOnly | QIODevice::Append))
+        return deployment;
+
+    QByteArray line = deployment.publicKey + '\n';
+    if (keys.size() > 0)
+        line.prepend('\n');
+    if (keys.write(line) != line.size())
+        return deployment;
+    keys.close();
+
+    if (created)
+        keys.setPermissions(QFile::ReadOwner | QFile::WriteOwner);
+
+    writeKeyStamp(rootfs, identity);
+    deployment.result = KeyDeployment::Deployed;
+    return deployment;
+}
+
+ContainerDetection::Ptr ContainerDetection::forContainer(const QString &containerName)
+{
+    return PerContainer<ContainerDetection>::instance(containerName, [&containerName]() {
+        return new ContainerDetection(containerName);
+    }, &ContainerDetection::updateActivation);
+}
+
+ContainerDetection::ContainerDetection(const QString &containerName)
+    : QObject(nullptr)
+    , m_containerName(containerName)
+    , m_deviceId(ContainerDevice::createIdForContainer(containerName))
+{
+    m_retryTimer.setSingleShot(true);
+    connect(&m_retryTimer, &QTimer::timeout, this, &ContainerDetection::reset);
+
+    //the detection only runs while a active target uses the device
+    connect(ProjectExplorer::KitManager::instance(), &ProjectExplorer::KitManager::kitUpdated,
+            this, &ContainerDetection::updateActivation);
+
+    ProjectExplorer::SessionManager *session = ProjectExplorer::SessionManager::instance();
+    connect(session, &ProjectExplorer::SessionManager::projectAdded,
+            this, [this](ProjectExplorer::Project *project) {
+        watchProject(project);
+        updateActivation();
+    });
+    connect(session, &ProjectExplorer::SessionManager::projectRemoved,
+            this, &ContainerDetection::updateActivation);
+    foreach (ProjectExplorer::Project *project, ProjectExplorer::SessionManager::projects())
+        watchProject(project);
+
+    if (LxdEventMonitor *monitor = LxdEventMonitor::instance()) {
+        connect(monitor, &LxdEventMonitor::containerStateChanged,
+                this, &ContainerDetection::handleContainerStateChanged);
+        connect(monitor, &LxdEventMonitor::connectedChanged,
+                this, &ContainerDetection::handleLxdConnectedChanged);
+    }
+}
+
+ContainerDetection::~ContainerDetection()
+{
+    if (m_detectionProcess) {
+        m_detectionProcess->disconnect(this);
+        if (m_detectionProcess->state() != QProcess::NotRunning)
+            m_detectionProcess->kill();
+    }
+}
+
+QString ContainerDetection::containerName() const
+{
+    return m_containerName;
+}
+
+QString ContainerDetection::deviceIP() const
+{
+    return m_deviceIP;
+}
+
+QString ContainerDetection::userName() const
+{
+    return m_userName;
+}
+
+bool ContainerDetection::isReady() const
+{
+    return m_state == Finished;
+}
+
+/*!
+ * \brief ContainerDetection::updateActivation
+ * Starts the detection if the kit of a active target uses the
+ * device, otherwise the detection is suspended
+ */
+void ContainerDetection::updateActivation()
+{
+    const bool active = isUsedByActiveTarget();
+    if (active == m_active)
+        return;
+
+    m_active = active;
+    if (!m_active) {
+        suspend();
+        return;
+    }
+
+    m_failedAttempts = 0;
+    if (m_state != Finished)
+        reset();
+}
+
+void ContainerDetection::reset()
+{
+    m_retryTimer.stop();
+    ++m_detectionRun;
+
+    setState(Initial);
+
+    if (!m_active)
+        return;
+
+    handleDetectionStepFinished();
+}
+
+void ContainerDetection::resetProcess()
+{
+    if (m_detectionProcess) {
+        m_detectionProcess->disconnect(this);
+        if (m_detectionProcess->state() != QProcess::NotRunning)
+            m_detectionProcess->kill();
+        delete m_detectionProcess;
+        m_detectionProcess = nullptr;
+    }
+    m_detectionProcess = new QProcess(this);
+    connect(m_detectionProcess, SIGNAL(finished(int)), this, SLOT(handleDetectionStepFinished()));
+}
+
+void ContainerDetection::showWarningMessage(const QString &msg)
+{
+    //only the first failure of a series is reported, the retries would flood the issues pane
+    if (m_failedAttempts > 0)
+        return;
+
+    ProjectExplorer::TaskHub::addTask(ProjectExplorer::Task::Error, msg, Constants::LM_TASK_CATEGORY_DEVICE);
+}
+
+void ContainerDetection::handleDetectionStepFinished()
+{
+    switch(m_state) {
+        case Initial: {
+            m_state = GetStatus;
+
+            if (LxdClient::isAvailable()) {
+                queryStatusFromLxd();
+                return;
+            }
+
+            startStatusProcess();
+            return;
+        }
+        case GetStatus: {
+            if ((m_detectionProcess->exitStatus() != QProcess::NormalExit || m_detectionProcess->exitCode() != 0)) {
+                printProcessError();
+                resetProcess();
+                triggerRedetection();
+                return;
+            }
+
+            QJsonParseError err;
+            QJsonDocument doc = QJsonDocument::fromJson( m_detectionProcess->readAllStandardOutput(), &err);
+            if (err.error != QJsonParseError::NoError) {
+                showWarningMessage(tr("There was a error in the device detection of %1, it was not possible to parse the status:\n%2")
+                                   .arg(m_containerName)
+                                   .arg(err.errorString()));
+                triggerRedetection();
+                return;
+            }
+
+            if (!doc.isObject()) {
+                showWarningMessage(tr("There was a error in the device detection of %1, the returned format was not a JSON object.")
+                                   .arg(m_containerName));
+                triggerRedetection();
+                return;
+            }
+
+            QVariantMap obj = doc.object().toVariantMap();
+            if (!obj.contains(QStringLiteral("ipv4"))) {
+                showWarningMessage(tr("There was a error in the device detection of %1, no IP address was returned.")
+                                   .arg(m_containerName));
+                triggerRedetection();
+                return;
+            }
+
+            m_deviceIP = obj[QStringLiteral("ipv4")].toString();
+            startDeployKey();
+            return;
+        }
+        case DeployKey: {
+            if ((m_detectionProcess->exitStatus() != QProcess::NormalExit || m_detectionProcess->exitCode() != 0)) {
+                printProcessError();
+                resetProcess();
+
+                triggerRedetection();
+                return;
+            }
+
+            writeKeyStamp(TargetRegistry::instance()->rootfs(m_containerName), identityFile());
+            finishDetection();
+            return;
+        }
+        default: {
+            break;
+        }
+    }
+}
+
+/*!
+ * \brief ContainerDetection::queryStatusFromLxd
+ * Asks LXD directly for the container state, if the container is not running
+ * or LXD can not be reached lmsdk-target takes over
+ */
+void ContainerDetection::queryStatusFromLxd()
+{
+    const QString containerName = m_containerName;
+    const int run = m_detectionRun;
+    QFuture<QString> future = Utils::runAsync(LinkMotionTargetTool::workerPool(), [containerName]() {
+        LxdClient::ContainerState state;
+        if (!LxdClient().containerState(containerName, &state)
+                || state.status != QStringLiteral("Running"))
+            return QString();
+        return state.ipv4;
+    });
+
+    Utils::onResultReady(future, this, [this, run](const QString &ip) {
+        //the detection was reset in the meantime
+        if (run != m_detectionRun || m_state != GetStatus)
+            return;
+
+        if (ip.isEmpty()) {
+            startStatusProcess();
+            return;
+        }
+
+        m_deviceIP = ip;
+        startDeployKey();
+    });
+}
+
+void ContainerDetection::startStatusProcess()
+{
+    resetProcess();
+
+    QString tool = LinkMotionBasePlugin::lmTargetTool();
+    if (tool.isEmpty()) {
+        showWarningMessage(tr("Could not find lmsdk-target. Container backend will not work."));
+        triggerRedetection();
+        return;
+    }
+
+    m_detectionProcess->setProgram(tool);
+    m_detectionProcess->setArguments(QStringList{
+        QStringLiteral("status"),
+        m_containerName
+    });
+    startDetectionProcess();
+}
+
+/*!
+ * \brief ContainerDetection::startDeployKey
+ * Makes sure the SSH key is in the authorized keys of the container, on a
+ * warm start the stored checksum matches and nothing needs to be done
+ */
+void ContainerDetection::startDeployKey()
+{
+    m_state = DeployKey;
+
+    const QString rootfs = TargetRegistry::instance()->rootfs(m_containerName);
+    const QString identity = identityFile();
+    if (isKeyDeployed(rootfs, identity)) {
+        finishDetection();
+        return;
+    }
+
+    const int run = m_detectionRun;
+    QFuture<KeyDeployment> future = Utils::runAsync(LinkMotionTargetTool::workerPool(), [rootfs, identity]() {
+        return deployKeyToRootfs(rootfs, identity);
+    });
+
+    Utils::onResultReady(future, this, [this, run](const KeyDeployment &deployment) {
+        //the detection was reset in the meantime
+        if (run != m_detectionRun || m_state != DeployKey)
+            return;
+
+        switch (deployment.result) {
+            case KeyDeployment::Deployed:
+                finishDetection();
+                return;
+            case KeyDeployment::NeedsTargetTool:
+                startDeployKeyProcess(deployment.publicKey);
+                return;
+            case KeyDeployment::Failed:
+                showWarningMessage(tr("There was a error in the device detection of %1, the SSH key could not be created:\n%2")
+                                   .arg(m_containerName)
+                                   .arg(deployment.error));
+                triggerRedetection();
+                return;
+        }
+    });
+}
+
+/*!
+ * \brief ContainerDetection::startDeployKeyProcess
+ * Deploys \a publicKey using lmsdk-target if the rootfs of the
+ * container is not writable, all steps run in one call
+ */
+void ContainerDetection::startDeployKeyProcess(const QByteArray &publicKey)
+{
+    resetProcess();
+
+    QString tool = LinkMotionBasePlugin::lmTargetTool();
+    if (tool.isEmpty()) {
+        showWarningMessage(tr("Could not find lmsdk-target. Container backend will not work."));
+        triggerRedetection();
+        return;
+    }
+
+    const QString script = QStringLiteral("mkdir -p %1 && touch %2 && "
+                                          "(grep -qF '%3' %2 || echo '%3' >> %2) && "
+                                          "chown nobody:nobody %2 && chmod 0600 %2")
+            .arg(QLatin1String(AUTHORIZED_KEYS_DIR))
+            .arg(QLatin1String(AUTHORIZED_KEYS_FILE))
+            .arg(QString::fromLatin1(publicKey.simplified()));
+
+    m_detectionProcess->setProgram(tool);
+    m_detectionProcess->setArguments(QStringList{
+        QStringLiteral("maint"),
+        m_containerName,
+        QStringLiteral("--"),
+        QStringLiteral("bash"),
+        QStringLiteral("-c"),
+        script
+    });
+    startDetectionProcess();
+}
+
+void ContainerDetection::finishDetection()
+{
+    m_failedAttempts = 0;
+    m_userName = LinkMotionTargetTool::targetDefaultUser(m_containerName);
+    setState(Finished);
+}
+
+void ContainerDetection::startDetectionProcess()
+{
+    m_detectionProcess->start();
+    if (!m_detectionProcess->waitForStarted(3000)) {
+        showWarningMessage(tr("Error while detecting the device state of %1.\n%2 %3")
+                           .arg(m_containerName)
+                           .arg(m_detectionProcess->program())
+                           .arg(m_detectionProcess->arguments().join(QStringLiteral(" "))));
+        resetProcess();
+        triggerRedetection();
+    }
+}
+
+/*!
+ * \brief ContainerDetection::triggerRedetection
+ * Retries a failed detection, the interval doubles with every failure
+ */
+void ContainerDetection::triggerRedetection()
+{
+    if (!m_active)
+        return;
+
+    LxdEventMonitor *monitor = LxdEventMonitor::instance();
+    const int maxInterval = (monitor && monitor->isConnected())
+            ? MAX_RETRY_INTERVAL_WITH_EVENTS
+            : MAX_RETRY_INTERVAL;
+    const qint64 interval = qMin(qint64(FIRST_RETRY_INTERVAL) << qMin(m_failedAttempts, 16),
+                                 qint64(maxInterval));
+
+    ++m_failedAttempts;
+    m_retryTimer.start(int(interval));
+}
+
+/*!
+ * \brief ContainerDetection::suspend
+ * Stops all detection steps, a device that was detected
+ * already keeps its state
+ */
+void ContainerDetection::suspend()
+{
+    m_retryTimer.stop();
+    ++m_detectionRun;
+
+    if (m_detectionProcess) {
+        m_detectionProcess->disconnect(this);
+        if (m_detectionProcess->state() != QProcess::NotRunning)
+            m_detectionProcess->kill();
+        m_detectionProcess->deleteLater();
+        m_detectionProcess = nullptr;
+    }
+
+    if (m_state != Finished)
+        setState(Initial);
+}
+
+/*!
+ * \brief ContainerDetection::setState
+ * Tells the devices when the container became ready or stopped being ready
+ */
+void ContainerDetection::setState(ContainerDetection::State state)
+{
+    const bool wasReady = isReady();
+    m_state = state;
+    if (wasReady != isReady())
+        emit changed();
+}
+
+bool ContainerDetection::isUsedByActiveTarget() const
+{
+    foreach (ProjectExplorer::Project *project, ProjectExplorer::SessionManager::projects()) {
+        ProjectExplorer::Target *target = project->activeTarget();
+        if (target && ProjectExplorer::DeviceKitInformation::deviceId(target->kit()) == m_deviceId)
+            return true;
+    }
+    return false;
+}
+
+void ContainerDetection::watchProject(ProjectExplorer::Project *project)
+{
+    connect(project, &ProjectExplorer::Project::activeTargetChanged,
+            this, &ContainerDetection::updateActivation);
+}
+
+void ContainerDetection::printProcessError()
+{
+    QString message = tr("There was a error in the device detection, it will not be possible to run apps on it:\n%1\n%2")
+            .arg(QString::fromLocal8Bit(m_detectionProcess->readAllStandardOutput()))
+            .arg(QString::fromLocal8Bit(m_detectionProcess->readAllStandardError()));
+    showWarningMessage(message);
+}
+
+/*!
+ * \brief ContainerDetection::handleContainerStateChanged
+ * The container was started or stopped, detect the device again
+ */
+void ContainerDetection::handleContainerStateChanged(const QString &containerName)
+{
+    if (containerName != m_containerName)
+        return;
+
+    m_failedAttempts = 0;
+    if (!m_active) {
+        //detect it again as soon as it is used
+        if (m_state == Finished)
+            setState(Initial);
+        return;
+    }
+
+    m_retryTimer.start(EVENT_COMPRESSION_DELAY);
+}
+
+/*!
+ * \brief ContainerDetection::handleLxdConnectedChanged
+ * Events might have been missed while the monitor was not connected
+ */
+void ContainerDetection::handleLxdConnectedChanged(bool connected)
+{
+    if (!connected || !m_active)
+        return;
+
+    m_failedAttempts = 0;
+    m_retryTimer.start(EVENT_COMPRESSION_DELAY);
+}
+
+} // namespace Internal
+} // namespace LmBase
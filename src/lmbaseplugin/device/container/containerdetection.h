@@ -0,0 +1,113 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#ifndef LM_INTERNAL_CONTAINERDETECTION_H
+#define LM_INTERNAL_CONTAINERDETECTION_H
+
+#include <coreplugin/id.h>
+
+#include <QObject>
+#include <QProcess>
+#include <QSharedPointer>
+#include <QTimer>
+
+namespace ProjectExplorer { class Project; }
+
+namespace LmBase {
+namespace Internal {
+
+/*!
+ * \brief The ContainerDetection class
+ * Finds out the IP of a container and deploys the SSH key into it. There
+ * is one detection per container, shared by all ContainerDevice instances
+ * and their clones, so cloning a device does not start a new detection.
+ *
+ * The detection only runs while the kit of a active target uses the
+ * device, it is restarted by the LXD events of the container and failed
+ * attempts are retried with a exponential backoff.
+ */
+class ContainerDetection : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef QSharedPointer<ContainerDetection> Ptr;
+
+    static Ptr forContainer (const QString &containerName);
+    ~ContainerDetection ();
+
+    QString containerName () const;
+    QString deviceIP () const;
+    QString userName () const;
+    bool isReady () const;
+
+signals:
+    void changed ();
+
+public slots:
+    void updateActivation ();
+
+private slots:
+    void handleDetectionStepFinished ();
+    void reset ();
+
+private:
+    enum State {
+        Initial,
+        GetStatus,
+        DeployKey,
+        Finished
+    };
+
+    explicit ContainerDetection (const QString &containerName);
+
+    void resetProcess ();
+    void showWarningMessage (const QString &msg);
+    void printProcessError ();
+    void queryStatusFromLxd ();
+    void startStatusProcess ();
+    void startDeployKey ();
+    void startDeployKeyProcess (const QByteArray &publicKey);
+    void finishDetection ();
+    void startDetectionProcess ();
+    void triggerRedetection ();
+    void suspend ();
+    void setState (State state);
+    bool isUsedByActiveTarget () const;
+    void watchProject (ProjectExplorer::Project *project);
+    void handleContainerStateChanged (const QString &containerName);
+    void handleLxdConnectedChanged (bool connected);
+
+private:
+    QString m_containerName;
+    Core::Id m_deviceId;
+    State m_state = Initial;
+    QString m_deviceIP;
+    QString m_userName;
+
+    QProcess *m_detectionProcess = nullptr;
+    QTimer m_retryTimer;
+    int  m_failedAttempts = 0;
+    int  m_detectionRun = 0;
+    bool m_active = false;
+};
+
+} // namespace Internal
+} // namespace LmBase
+
+#endif // LM_INTERNAL_CONTAINERDETECTION_H
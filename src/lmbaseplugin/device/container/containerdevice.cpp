@@ -19,19 +19,17 @@
 #include "containerdevice.h"
 #include "containerdevice_p.h"
 #include "containerdeviceprocess.h"
+#include "containerdevicesignaloperation.h"
+#include "containerexecprocess.h"
 
 #include <lmbaseplugin/lmbaseplugin_constants.h>
-#include <lmbaseplugin/lmbaseplugin.h>
 #include <lmbaseplugin/settings.h>
 #include <lmbaseplugin/lmtargettool.h>
 
 #include <projectexplorer/devicesupport/devicemanager.h>
-#include <projectexplorer/taskhub.h>
 #include <ssh/sshconnection.h>
 #include <utils/portlist.h>
 
-#include <QJsonDocument>
-#include <QJsonObject>
 #include <QStandardPaths>
 #include <QTimer>
 
@@ -45,163 +43,45 @@ namespace Internal {
 ContainerDevicePrivate::ContainerDevicePrivate(ContainerDevice *q)
     : QObject(nullptr)
     , q_ptr(q)
-    , m_detectionProcess(nullptr)
+    , m_detection(ContainerDetection::forContainer(q->containerName()))
+    , m_connection(ContainerConnection::forContainer(q->containerName()))
+    , m_weston(ContainerWeston::forContainer(q->containerName()))
 {
-
-}
-
-void ContainerDevicePrivate::resetProcess()
-{
-    if (m_detectionProcess) {
-        m_detectionProcess->disconnect(this);
-        if (m_detectionProcess->state() != QProcess::NotRunning)
-            m_detectionProcess->kill();
-        delete m_detectionProcess;
-        m_detectionProcess = nullptr;
-    }
-    m_detectionProcess = new QProcess(this);
-    connect(m_detectionProcess, SIGNAL(finished(int)), this, SLOT(handleDetectionStepFinished()));
-}
-
-QString ContainerDevicePrivate::userName() const
-{
-    return LinkMotionTargetTool::targetDefaultUser(q_ptr->containerName());
-}
-
-void ContainerDevicePrivate::reset()
-{
-    Q_Q(ContainerDevice);
-
-    m_deviceState = Initial;
-    ProjectExplorer::DeviceManager::instance()->setDeviceState(q->id(), ProjectExplorer::IDevice::DeviceDisconnected);
-
-    handleDetectionStepFinished();
-}
-
-void ContainerDevicePrivate::showWarningMessage(const QString &msg)
-{
-    ProjectExplorer::TaskHub::addTask(ProjectExplorer::Task::Error, msg, Constants::LM_TASK_CATEGORY_DEVICE);
+    connect(m_detection.data(), &ContainerDetection::changed,
+            this, &ContainerDevicePrivate::applyDetectionState);
 }
 
-void ContainerDevicePrivate::handleDetectionStepFinished()
+/*!
+ * \brief ContainerDevicePrivate::applyDetectionState
+ * Takes over the state of the shared detection, only the registered
+ * device reports its state change to the DeviceManager
+ */
+void ContainerDevicePrivate::applyDetectionState()
 {
     Q_Q(ContainerDevice);
 
-    switch(m_deviceState) {
-        case Initial: {
-            m_deviceState = GetStatus;
-
-            resetProcess();
-
-            QString tool = LinkMotionBasePlugin::lmTargetTool();
-            if (tool.isEmpty()) {
-                showWarningMessage(tr("Could not find lmsdk-target. Container backend will not work."));
-                triggerDeviceRedetection();
-                return;
-            }
-
-            m_detectionProcess->setProgram(tool);
-            m_detectionProcess->setArguments(QStringList{
-                QStringLiteral("status"),
-                q->containerName()
-            });
-            break;
-        }
-        case GetStatus: {
-            if ((m_detectionProcess->exitStatus() != QProcess::NormalExit || m_detectionProcess->exitStatus() != 0)) {
-                printProcessError();
-                resetProcess();
-                triggerDeviceRedetection();
-                return;
-            }
-
-            QJsonParseError err;
-            QJsonDocument doc = QJsonDocument::fromJson( m_detectionProcess->readAllStandardOutput(), &err);
-            if (err.error != QJsonParseError::NoError) {
-                showWarningMessage(tr("There was a error in the device detection of %1, it was not possible to parse the status:\n%2")
-                                   .arg(q->containerName())
-                                   .arg(err.errorString()));
-                triggerDeviceRedetection();
-                return;
-            }
-
-            if (!doc.isObject()) {
-                showWarningMessage(tr("There was a error in the device detection of %1, the returned format was not a JSON object.")
-                                   .arg(q->containerName()));
-                triggerDeviceRedetection();
-                return;
-            }
-
-            QVariantMap obj = doc.object().toVariantMap();
-            if (!obj.contains(QStringLiteral("ipv4"))) {
-                showWarningMessage(tr("There was a error in the device detection of %1, no IP address was returned.")
-                                   .arg(q->containerName()));
-                triggerDeviceRedetection();
-                return;
-            }
-
-            m_deviceIP = obj[QStringLiteral("ipv4")].toString();
-            m_deviceState = DeployKey;
-
-            resetProcess();
-            m_detectionProcess->setProgram(QString::fromLatin1(Constants::LM_CONTAINER_DEPLOY_PUBKEY_SCRIPT)
-                                           .arg(Constants::LM_SCRIPTPATH));
-            m_detectionProcess->setArguments(QStringList{q->containerName()});
-            break;
-        }
-        case DeployKey: {
-            if ((m_detectionProcess->exitStatus() != QProcess::NormalExit || m_detectionProcess->exitStatus() != 0)) {
-                printProcessError();
-                resetProcess();
-
-                triggerDeviceRedetection();
-                return;
-            }
-
-            m_deviceState = Finished;
-
-            QSsh::SshConnectionParameters params = q->sshParameters();
-            params.userName = userName();
-            params.host = m_deviceIP;
-            params.authenticationType = QSsh::SshConnectionParameters::AuthenticationTypePublicKey;
-            params.timeout = 20;
-            params.port = 22;
-            params.privateKeyFile = Settings::settingsPath()
-                    .appendPath(QLatin1String(Constants::LM_DEVICE_SSHIDENTITY))
-                    .toString();
-
-            q->setSshParameters(params);
-            ProjectExplorer::DeviceManager::instance()->setDeviceState(q->id(), ProjectExplorer::IDevice::DeviceReadyToUse);
-            return;
-        }
-        default: {
-            break;
-        }
+    if (m_detection->isReady()) {
+        QSsh::SshConnectionParameters params = q->sshParameters();
+        params.userName = m_detection->userName();
+        params.host = m_detection->deviceIP();
+        params.authenticationType = QSsh::SshConnectionParameters::AuthenticationTypePublicKey;
+        params.timeout = 20;
+        params.port = 22;
+        params.privateKeyFile = Settings::settingsPath()
+                .appendPath(QLatin1String(Constants::LM_DEVICE_SSHIDENTITY))
+                .toString();
+        q->setSshParameters(params);
     }
 
-    m_detectionProcess->start();
-    if (!m_detectionProcess->waitForStarted(3000)) {
-        showWarningMessage(tr("Error while detecting the device state of %1.\n%2 %3")
-                           .arg(q->containerName())
-                           .arg(m_detectionProcess->program())
-                           .arg(m_detectionProcess->arguments().join(QStringLiteral(" "))));
-        resetProcess();
-        triggerDeviceRedetection();
-    }
-}
+    const ProjectExplorer::IDevice::DeviceState state = m_detection->isReady()
+            ? ProjectExplorer::IDevice::DeviceReadyToUse
+            : ProjectExplorer::IDevice::DeviceDisconnected;
 
-void ContainerDevicePrivate::triggerDeviceRedetection()
-{
-    //trigger device redetection
-    QTimer::singleShot(1000, this, &ContainerDevicePrivate::reset);
-}
-
-void ContainerDevicePrivate::printProcessError()
-{
-    QString message = tr("There was a error in the device detection, it will not be possible to run apps on it:\n%1\n%2")
-            .arg(QString::fromLocal8Bit(m_detectionProcess->readAllStandardOutput()))
-            .arg(QString::fromLocal8Bit(m_detectionProcess->readAllStandardError()));
-    showWarningMessage(message);
+    ProjectExplorer::DeviceManager *devMgr = ProjectExplorer::DeviceManager::instance();
+    if (devMgr->find(q->id()).data() == q)
+        devMgr->setDeviceState(q->id(), state);
+    else
+        q->setDeviceState(state);
 }
 
 ContainerDevice::ContainerDevice(Core::Id type, Core::Id id) :
@@ -222,15 +102,17 @@ ContainerDevice::ContainerDevice(Core::Id type, Core::Id id) :
             .arg(Constants::LM_DESKTOP_PORT_END);
     setFreePorts(Utils::PortList::fromString(portRange));
 
-    d_ptr->reset();
+    d_ptr->applyDetectionState();
 }
 
 ContainerDevice::ContainerDevice(const ContainerDevice &other)
     : LinuxDevice(other)
     , d_ptr(new ContainerDevicePrivate(this))
 {
-    //no need to copy over the private, just redetect the device status
-    d_ptr->reset();
+    d_ptr->m_transport = other.d_ptr->m_transport;
+
+    //the detection is shared with the original device
+    d_ptr->applyDetectionState();
 }
 
 ContainerDevice::Ptr ContainerDevice::create(Core::Id type, Core::Id id)
@@ -271,15 +153,38 @@ ProjectExplorer::IDeviceWidget *ContainerDevice::createWidget()
     return 0;
 }
 
+/*!
+ * \brief ContainerDevice::transport
+ * Returns how applications are started on the device, either through
+ * SSH or directly with lmsdk-target exec
+ */
+ContainerDevice::Transport ContainerDevice::transport() const
+{
+    Q_D(const ContainerDevice);
+    return d->m_transport;
+}
+
+void ContainerDevice::setTransport(ContainerDevice::Transport transport)
+{
+    Q_D(ContainerDevice);
+    d->m_transport = transport;
+}
+
 QList<Core::Id> ContainerDevice::actionIds() const
 {
-    return QList<Core::Id>();
+    if (transport() == ExecTransport)
+        return QList<Core::Id>{ Core::Id(Constants::LM_DEVICE_ACTION_USE_SSH) };
+    return QList<Core::Id>{ Core::Id(Constants::LM_DEVICE_ACTION_USE_EXEC) };
 }
 
 void ContainerDevice::executeAction(Core::Id actionId, QWidget *parent)
 {
-    Q_UNUSED(actionId);
     Q_UNUSED(parent);
+
+    if (actionId == Constants::LM_DEVICE_ACTION_USE_SSH)
+        setTransport(SshTransport);
+    else if (actionId == Constants::LM_DEVICE_ACTION_USE_EXEC)
+        setTransport(ExecTransport);
 }
 
 ProjectExplorer::IDevice::Ptr ContainerDevice::clone() const
@@ -289,7 +194,10 @@ ProjectExplorer::IDevice::Ptr ContainerDevice::clone() const
 
 QString ContainerDevice::displayNameForActionId(Core::Id actionId) const
 {
-    Q_UNUSED(actionId);
+    if (actionId == Constants::LM_DEVICE_ACTION_USE_SSH)
+        return tr("Run Applications Through SSH");
+    if (actionId == Constants::LM_DEVICE_ACTION_USE_EXEC)
+        return tr("Run Applications Directly in the Container");
     return QString();
 }
 
@@ -300,9 +208,35 @@ QString ContainerDevice::displayType() const
 
 ProjectExplorer::DeviceProcess *ContainerDevice::createProcess(QObject *parent) const
 {
+    if (transport() == ExecTransport)
+        return new ContainerExecProcess(sharedFromThis(), parent);
     return new ContainerDeviceProcess(sharedFromThis(), parent);
 }
 
+ProjectExplorer::DeviceProcessSignalOperation::Ptr ContainerDevice::signalOperation() const
+{
+    //sshd might not even run in the container
+    if (transport() == ExecTransport) {
+        return ProjectExplorer::DeviceProcessSignalOperation::Ptr(
+                    new ContainerDeviceSignalOperation(sharedFromThis().staticCast<const ContainerDevice>()));
+    }
+    return LinuxDevice::signalOperation();
+}
+
+void ContainerDevice::fromMap(const QVariantMap &map)
+{
+    LinuxDevice::fromMap(map);
+    setTransport(static_cast<Transport>(map.value(QLatin1String(Constants::LM_DEVICE_TRANSPORT_KEY),
+                                                  SshTransport).toInt()));
+}
+
+QVariantMap ContainerDevice::toMap() const
+{
+    QVariantMap map = LinuxDevice::toMap();
+    map.insert(QLatin1String(Constants::LM_DEVICE_TRANSPORT_KEY), transport());
+    return map;
+}
+
 } // namespace Internal
 } // namespace LmBase
 
@@ -33,6 +33,11 @@ public:
     typedef QSharedPointer<ContainerDevice> Ptr;
     typedef QSharedPointer<const ContainerDevice> ConstPtr;
 
+    enum Transport {
+        SshTransport,
+        ExecTransport
+    };
+
     static Ptr create(Core::Id type, Core::Id id);
 
     ~ContainerDevice ();
@@ -41,6 +46,9 @@ public:
     QString containerName() const;
     Utils::FileName westonConfig() const;
 
+    Transport transport() const;
+    void setTransport(Transport transport);
+
     // IDevice interface
     virtual ProjectExplorer::IDeviceWidget *createWidget() override;
     virtual QList<Core::Id> actionIds() const override;
@@ -49,6 +57,9 @@ public:
     virtual QString displayNameForActionId(Core::Id actionId) const override;
     virtual QString displayType() const override;
     virtual ProjectExplorer::DeviceProcess *createProcess(QObject *parent) const override;
+    virtual ProjectExplorer::DeviceProcessSignalOperation::Ptr signalOperation() const override;
+    virtual void fromMap(const QVariantMap &map) override;
+    virtual QVariantMap toMap() const override;
 
 protected:
     ContainerDevice(Core::Id type, Core::Id id);
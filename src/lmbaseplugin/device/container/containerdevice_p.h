@@ -20,45 +20,32 @@
 #ifndef CONTAINERDEVICE_P_H
 #define CONTAINERDEVICE_P_H
 
+#include "containerconnection.h"
+#include "containerdetection.h"
+#include "containerdevice.h"
+#include "containerweston.h"
+
 #include <QObject>
-#include <QProcess>
 
 namespace LmBase {
 namespace Internal {
 
-class ContainerDevice;
 class ContainerDevicePrivate : public QObject
 {
     Q_OBJECT
 
 public:
     ContainerDevicePrivate (LmBase::Internal::ContainerDevice *q);
-    void resetProcess();
-    QString userName () const;
-    void reset ();
-
-    void showWarningMessage (const QString &msg);
 
 public slots:
-    void handleDetectionStepFinished();
-    void triggerDeviceRedetection();
-
-public:
-
-    enum State {
-        Initial,
-        GetStatus,
-        DeployKey,
-        Finished
-    } m_deviceState = Initial;
-    QString m_deviceIP;
-
-private:
-    void printProcessError ();
+    void applyDetectionState ();
 
 private:
     ContainerDevice *q_ptr;
-    QProcess *m_detectionProcess;
+    ContainerDetection::Ptr m_detection;
+    ContainerConnection::Ptr m_connection;
+    ContainerWeston::Ptr m_weston;
+    ContainerDevice::Transport m_transport = ContainerDevice::SshTransport;
     Q_DECLARE_PUBLIC(ContainerDevice)
 };
 
@@ -67,4 +54,3 @@ private:
 
 
 #endif // CONTAINERDEVICE_P_H
-
@@ -21,6 +21,7 @@
 #include "containerdevice.h"
 #include <lmbaseplugin/lmbaseplugin_constants.h>
 #include <lmbaseplugin/lmtargettool.h>
+#include <lmbaseplugin/lmtargetregistry.h>
 
 #include <utils/hostosinfo.h>
 #include <utils/qtcassert.h>
@@ -46,7 +47,7 @@ QString ContainerDeviceFactory::displayNameForId(Core::Id type) const
 QList<Core::Id> ContainerDeviceFactory::availableCreationIds() const
 {
     QList<Core::Id> deviceIds;
-    QList<LinkMotionTargetTool::Target> targets = LinkMotionTargetTool::listPossibleDeviceContainers();
+    QList<LinkMotionTargetTool::Target> targets = TargetRegistry::instance()->deviceContainers();
 
     foreach(const LinkMotionTargetTool::Target &t, targets) {
         deviceIds.append(ContainerDevice::createIdForContainer(t.containerName));
@@ -63,8 +64,11 @@ ProjectExplorer::IDevice::Ptr ContainerDeviceFactory::create(Core::Id id) const
 
 bool ContainerDeviceFactory::canRestore(const QVariantMap &map) const
 {
-    //we can only restore devices that have a existing container
-    return availableCreationIds().contains(ProjectExplorer::IDevice::idFromMap(map));
+    //checking for the container here would block the GUI thread for every
+    //stored device, devices without a container are removed by the kit manager
+    //as soon as the list of available targets is known
+    return ProjectExplorer::IDevice::typeFromMap(map).toString().startsWith(QLatin1String(Constants::LM_CONTAINER_DEVICE_TYPE_ID))
+            && ProjectExplorer::IDevice::idFromMap(map).toString().startsWith(QLatin1String(Constants::LM_CONTAINER_DEVICE_TYPE_ID));
 }
 
 ProjectExplorer::IDevice::Ptr ContainerDeviceFactory::restore(const QVariantMap &map) const
@@ -18,20 +18,15 @@
  */
 
 #include "containerdeviceprocess.h"
+#include "containerlauncher.h"
 #include <lmbaseplugin/lmbaseplugin_constants.h>
 #include <lmbaseplugin/device/container/containerdevice.h>
 
 #include <utils/qtcassert.h>
-#include <utils/qtcprocess.h>
-#include <projectexplorer/runnables.h>
 
-#include <QProcess>
 #include <QDebug>
-#include <QUuid>
-#include <QTemporaryDir>
 
-#include <stdlib.h>
-#include <unistd.h>
+#include <signal.h>
 
 namespace LmBase {
 namespace Internal {
@@ -40,156 +35,88 @@ ContainerDeviceProcess::ContainerDeviceProcess(const QSharedPointer<const Projec
                                            QObject *parent)
     : LinuxDeviceProcess(device, parent)
 {
-    m_pidFile = QString::fromLatin1("/tmp/qtc.%1.pid").arg(QString::fromLatin1(QUuid::createUuid().toRfc4122().toHex()));
-
     QTC_ASSERT(device->type().toString().startsWith(Constants::LM_CONTAINER_DEVICE_TYPE_ID), return);
 
-    const ContainerDevice *dev = static_cast<const ContainerDevice *>(device.data());
-    if (dev) {
-        m_westonConf = dev->westonConfig();
-    }
-
-
+    m_launcher = new ContainerLauncher(device.staticCast<const ContainerDevice>(), this);
+    connect(m_launcher, &ContainerLauncher::readyToStart,
+            this, &ContainerDeviceProcess::startPending);
+    connect(this, &ProjectExplorer::SshDeviceProcess::finished,
+            this, &ContainerDeviceProcess::handleFinished);
 }
 
 ContainerDeviceProcess::~ContainerDeviceProcess()
 {
-    SshDeviceProcess *cleaner = new SshDeviceProcess(device());
-
-    QString pid = m_pidFile;
-    auto callback = [pid, cleaner](){
-        if (cleaner->exitCode() != 0) {
-            qWarning()<<"Cleaning the pidfile "<<pid<<" has failed";
-        }
-        cleaner->deleteLater();
-    };
-
-    connect(cleaner, &SshDeviceProcess::finished, callback);
-
-    ProjectExplorer::StandardRunnable r;
-    r.executable = QStringLiteral("rm");
-    r.commandLineArguments = m_pidFile;
-    cleaner->start(r);
-
-    cleanupWestonProcess();
 }
 
 void ContainerDeviceProcess::start(const ProjectExplorer::Runnable &runnable)
 {
+    QTC_ASSERT(m_launcher, return);
+
     ProjectExplorer::StandardRunnable rc = runnable.as<ProjectExplorer::StandardRunnable>();
-    if(rc.runMode == ProjectExplorer::ApplicationLauncher::Gui) {
-
-        cleanupWestonProcess();
-
-        m_westonDir = new QTemporaryDir(QStringLiteral("/tmp/lmsdk-XXXXXX"));
-        if (!m_westonDir->isValid()) {
-            qDebug()<<"Unable to create weston dir";
-        }
-
-        m_westonProc = new QProcess(this);
-        if (m_westonConf.exists()) {
-            m_westonProc->setArguments(QStringList{
-                QString::fromLatin1("-c%1").arg(m_westonConf.toString())
-            });
-        } else {
-            m_westonProc->setArguments(QStringList{
-                QString::fromLatin1("-c%1/../weston.ini").arg(Constants::LM_SCRIPTPATH)
-            });
-        }
-
-        QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
-        env.insert("XDG_RUNTIME_DIR", m_westonDir->path()); // Add an environment variable
-        m_westonProc->setProcessEnvironment(env);
-        m_westonProc->setProgram(QStringLiteral("weston"));
-
-        connect(this, &ProjectExplorer::SshDeviceProcess::finished,
-                this, &ContainerDeviceProcess::cleanupWestonProcess);
-
-        m_westonProc->start();
-        if (!m_westonProc->waitForStarted(5000)) {
-            qDebug()<<"Failed to start Weston "<<m_westonProc->errorString();
-        }
-
-        rc.environment.appendOrSet(QStringLiteral("XDG_RUNTIME_DIR"),
-                                   m_westonDir->path());
+    if (!m_launcher->prepare(&rc)) {
+        m_pendingRunnable = rc;
+        return;
     }
     LinuxDeviceProcess::start(rc);
 }
 
-void ContainerDeviceProcess::doSignal(const int sig)
+void ContainerDeviceProcess::startPending()
 {
-    SshDeviceProcess *signaler = new SshDeviceProcess(device(), this);
-    connect(signaler, &SshDeviceProcess::finished, [signaler](){
-        if (signaler->exitCode() != 0) {
-            qWarning()<<"Killing the process has failed";
-            qWarning()<<signaler->readAllStandardOutput();
-            qWarning()<<signaler->readAllStandardError();
-        }
-        signaler->deleteLater();
-    });
-
-    ProjectExplorer::StandardRunnable r;
-    r.executable = QStringLiteral("kill");
-    r.commandLineArguments = QString::fromLatin1("-%2 `cat %1`").arg(m_pidFile).arg(sig);
-    signaler->start(r);
+    LinuxDeviceProcess::start(m_pendingRunnable);
 }
 
-void ContainerDeviceProcess::cleanupWestonProcess()
+void ContainerDeviceProcess::doSignal(const int sig)
 {
-    if(m_westonProc) {
-        if (m_westonProc->state() != QProcess::NotRunning) {
-            m_westonProc->terminate();
-            if(m_westonProc->waitForFinished(5000)) {
-                m_westonProc->kill();
-            }
-        }
-        delete m_westonProc;
-        m_westonProc = nullptr;
+    QTC_ASSERT(m_launcher, return);
+
+    if (m_launcher->cancelPendingStart()) {
+        emit finished();
+        return;
     }
 
-    if (m_westonDir) {
-        delete m_westonDir;
-        m_westonDir = nullptr;
+    //the pid might still wait in the output nobody read yet
+    m_launcher->addOutput(LinuxDeviceProcess::readAllStandardOutput());
+    if (m_launcher->signalApplication(sig))
+        return;
+
+    //fall back to the signal operation of the SSH process
+    switch (sig) {
+        case SIGINT:
+            LinuxDeviceProcess::interrupt();
+            break;
+        case SIGKILL:
+            LinuxDeviceProcess::kill();
+            break;
+        default:
+            LinuxDeviceProcess::terminate();
+            break;
     }
 }
 
+/*!
+ * \brief ContainerDeviceProcess::readAllStandardOutput
+ * Strips the pid reported by the shell from the output
+ */
+QByteArray ContainerDeviceProcess::readAllStandardOutput()
+{
+    QTC_ASSERT(m_launcher, return LinuxDeviceProcess::readAllStandardOutput());
+
+    m_launcher->addOutput(LinuxDeviceProcess::readAllStandardOutput());
+    return m_launcher->takeOutput();
+}
+
+void ContainerDeviceProcess::handleFinished()
+{
+    m_launcher->finishOutput();
+    if (m_launcher->hasOutput())
+        emit readyReadStandardOutput();
+
+    m_launcher->release();
+}
+
 QString ContainerDeviceProcess::fullCommandLine(const ProjectExplorer::StandardRunnable &runnable) const
 {
-    //reimpl start and check for runmode, open weston window if its GUI
-
-    QString fullCommandLine;
-    QStringList rcFiles {
-        QLatin1String("/etc/profile")
-        , QLatin1String("$HOME/.profile")
-    };
-    foreach (const QString &filePath, rcFiles)
-        fullCommandLine += QString::fromLatin1("test -f %1 && . %1;").arg(filePath);
-    if (runnable.workingDirectory.isEmpty()) {
-        fullCommandLine.append(QLatin1String("cd ")).append(Utils::QtcProcess::quoteArgUnix(runnable.workingDirectory))
-                .append(QLatin1String(" && "));
-    }
-    QString envString;
-    for (auto it = runnable.environment.constBegin(); it != runnable.environment.constEnd(); ++it) {
-        if (!envString.isEmpty())
-            envString += QLatin1Char(' ');
-        envString.append(it.key()).append(QLatin1String("='")).append(it.value())
-                .append(QLatin1Char('\''));
-    }
-    if (!envString.isEmpty())
-        fullCommandLine.append(QLatin1Char(' ')).append(envString);
-
-    if (!fullCommandLine.isEmpty())
-        fullCommandLine += QLatin1Char(' ');
-
-    //fullCommandLine.append(Utils::QtcProcess::quoteArgUnix(QStringLiteral("dbus-run-session")));
-    fullCommandLine += QString::fromLatin1(" bash -c \"echo \\$\\$ > %1; exec ").arg(m_pidFile);
-    fullCommandLine.append(Utils::QtcProcess::quoteArgUnix(runnable.executable));
-    if (!runnable.commandLineArguments.isEmpty()) {
-        fullCommandLine.append(QLatin1Char(' '));
-        fullCommandLine.append(runnable.commandLineArguments);
-    }
-    fullCommandLine.append(QStringLiteral("\""));
-    return fullCommandLine;
+    return ContainerLauncher::commandLine(runnable);
 }
 
 } // namespace Internal
@@ -22,15 +22,15 @@
 
 #include "containerdevice.h"
 
+#include <projectexplorer/runnables.h>
 #include <remotelinux/linuxdeviceprocess.h>
 #include <utils/environment.h>
 
-#include <QTemporaryDir>
-
 namespace LmBase {
 namespace Internal {
 
 class ContainerDevice;
+class ContainerLauncher;
 
 class ContainerDeviceProcess: public RemoteLinux::LinuxDeviceProcess
 {
@@ -45,17 +45,18 @@ public:
     virtual void terminate() override { doSignal(15); }
     virtual void kill() override { doSignal(9); }
 
+    virtual QByteArray readAllStandardOutput() override;
+
     void doSignal (const int sig);
 private:
 
-    void cleanupWestonProcess ();
+    void startPending ();
+    void handleFinished ();
 
     // SshDeviceProcess interface
     virtual QString fullCommandLine(const ProjectExplorer::StandardRunnable &) const override;
-    QString m_pidFile;
-    Utils::FileName m_westonConf;
-    QProcess *m_westonProc = nullptr;
-    QTemporaryDir *m_westonDir = nullptr;
+    ContainerLauncher *m_launcher = nullptr;
+    ProjectExplorer::StandardRunnable m_pendingRunnable;
 };
 
 } // namespace Internal
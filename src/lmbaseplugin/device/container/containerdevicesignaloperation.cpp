@@ -21,6 +21,10 @@
 #include "containerprocesslist.h"
 #include <lmbaseplugin/lmbaseplugin_constants.h>
 #include <lmbaseplugin/lmbaseplugin.h>
+#include <lmbaseplugin/lmtargettool.h>
+#include <lmbaseplugin/lxd/lxdclient.h>
+
+#include <utils/runextensions.h>
 
 #include <QDebug>
 
@@ -39,6 +43,24 @@ ContainerDeviceSignalOperation::~ContainerDeviceSignalOperation()
 {
 }
 
+/*!
+ * \brief ContainerDeviceSignalOperation::signalProcess
+ * Sends \a signal to \a pid inside the container of \a dev, failures
+ * are only logged. Used by the processes of the device that know the
+ * pid of the application they started
+ */
+void ContainerDeviceSignalOperation::signalProcess(ContainerDevice::ConstPtr dev, int pid, int signal)
+{
+    ContainerDeviceSignalOperation *op = new ContainerDeviceSignalOperation(dev);
+    connect(op, &ContainerDeviceSignalOperation::finished,
+            op, [op, pid](const QString &errorMessage) {
+        if (!errorMessage.isEmpty())
+            qWarning()<<"Signalling the process"<<pid<<"has failed"<<errorMessage;
+        op->deleteLater();
+    });
+    op->sendSignal(pid, signal);
+}
+
 void ContainerDeviceSignalOperation::killProcess(int pid)
 {
     killProcessSilently(pid);
@@ -117,6 +139,33 @@ void ContainerDeviceSignalOperation::sendSignal(int pid, int signal)
         return;
     }
 
+    if (!LxdClient::isAvailable()) {
+        sendSignalWithTargetTool(pid, signal);
+        return;
+    }
+
+    //send the signal through the LXD API, lmsdk-target is only used
+    //if LXD can not be reached
+    const QString containerName = m_dev->containerName();
+    const QStringList command {
+        QStringLiteral("kill"), QStringLiteral("-%1").arg(signal), QString::number(pid)
+    };
+    QFuture<bool> future = Utils::runAsync(LinkMotionTargetTool::workerPool(), [containerName, command]() {
+        int exitCode = -1;
+        return LxdClient().exec(containerName, command, nullptr, &exitCode, LxdClient::DEFAULT_TIMEOUT)
+                && exitCode == 0;
+    });
+
+    Utils::onResultReady(future, this, [this, pid, signal](bool success) {
+        if (success)
+            emit finished(QString());
+        else
+            sendSignalWithTargetTool(pid, signal);
+    });
+}
+
+void ContainerDeviceSignalOperation::sendSignalWithTargetTool(int pid, int signal)
+{
     QProcess *proc = new QProcess(this);
     connect(proc,SIGNAL(finished(int,QProcess::ExitStatus)),this,SLOT(processFinished(int,QProcess::ExitStatus)));
     connect(proc,SIGNAL(finished(int,QProcess::ExitStatus)),proc,SLOT(deleteLater()));
@@ -32,6 +32,9 @@ class ContainerDeviceSignalOperation : public ProjectExplorer::DeviceProcessSign
     Q_OBJECT
 public:
     ~ContainerDeviceSignalOperation();
+
+    static void signalProcess(ContainerDevice::ConstPtr dev, int pid, int signal);
+
     void killProcess(int pid);
     void killProcess(const QString &filePath);
     void interruptProcess(int pid);
@@ -50,6 +53,7 @@ protected:
     friend class ContainerDevice;
 
     void sendSignal(int pid, int signal);
+    void sendSignalWithTargetTool(int pid, int signal);
 protected slots:
     void processFinished(int exitCode, QProcess::ExitStatus exitState);
     void processError(QProcess::ProcessError procErr);
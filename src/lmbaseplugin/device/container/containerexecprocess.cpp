@@ -0,0 +1,191 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#include "containerexecprocess.h"
+#include "containerlauncher.h"
+
+#include <lmbaseplugin/lmbaseplugin_constants.h>
+#include <lmbaseplugin/lmbaseplugin.h>
+
+#include <utils/qtcassert.h>
+
+#include <QDebug>
+
+#include <signal.h>
+
+namespace LmBase {
+namespace Internal {
+
+enum {
+    debug = 0
+};
+
+ContainerExecProcess::ContainerExecProcess(const QSharedPointer<const ProjectExplorer::IDevice> &device,
+                                           QObject *parent)
+    : DeviceProcess(device, parent)
+{
+    QTC_ASSERT(device->type().toString().startsWith(Constants::LM_CONTAINER_DEVICE_TYPE_ID), return);
+
+    m_launcher = new ContainerLauncher(device.staticCast<const ContainerDevice>(), this);
+    connect(m_launcher, &ContainerLauncher::readyToStart,
+            this, &ContainerExecProcess::startProcess);
+
+    connect(&m_process, &QProcess::started,
+            this, &ContainerExecProcess::started);
+    connect(&m_process, &QProcess::errorOccurred,
+            this, &ContainerExecProcess::error);
+    connect(&m_process, &QProcess::readyReadStandardOutput,
+            this, &ContainerExecProcess::handleReadyReadStandardOutput);
+    connect(&m_process, &QProcess::readyReadStandardError,
+            this, &ContainerExecProcess::readyReadStandardError);
+    connect(&m_process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+            this, &ContainerExecProcess::handleFinished);
+}
+
+ContainerExecProcess::~ContainerExecProcess()
+{
+    m_process.disconnect(this);
+    if (m_process.state() != QProcess::NotRunning) {
+        m_process.kill();
+        m_process.waitForFinished(1000);
+    }
+}
+
+void ContainerExecProcess::start(const ProjectExplorer::Runnable &runnable)
+{
+    QTC_ASSERT(m_launcher && m_process.state() == QProcess::NotRunning, return);
+
+    ProjectExplorer::StandardRunnable rc = runnable.as<ProjectExplorer::StandardRunnable>();
+    const bool ready = m_launcher->prepare(&rc);
+
+    const ContainerDevice *dev = static_cast<const ContainerDevice *>(device().data());
+    m_process.setProgram(LinkMotionBasePlugin::lmTargetTool());
+    m_process.setArguments(QStringList{
+        QStringLiteral("exec"),
+        dev->containerName(),
+        QStringLiteral("--"),
+        QStringLiteral("bash"),
+        QStringLiteral("-c"),
+        ContainerLauncher::commandLine(rc)
+    });
+
+    if (ready)
+        startProcess();
+}
+
+void ContainerExecProcess::startProcess()
+{
+    if (debug) qDebug()<<"Starting"<<m_process.arguments();
+    m_process.start();
+}
+
+void ContainerExecProcess::interrupt()
+{
+    sendSignal(SIGINT);
+}
+
+void ContainerExecProcess::terminate()
+{
+    sendSignal(SIGTERM);
+}
+
+void ContainerExecProcess::kill()
+{
+    sendSignal(SIGKILL);
+}
+
+QProcess::ProcessState ContainerExecProcess::state() const
+{
+    return m_process.state();
+}
+
+QProcess::ExitStatus ContainerExecProcess::exitStatus() const
+{
+    return m_process.exitStatus();
+}
+
+int ContainerExecProcess::exitCode() const
+{
+    return m_process.exitCode();
+}
+
+QString ContainerExecProcess::errorString() const
+{
+    return m_process.errorString();
+}
+
+QByteArray ContainerExecProcess::readAllStandardOutput()
+{
+    return m_launcher->takeOutput();
+}
+
+QByteArray ContainerExecProcess::readAllStandardError()
+{
+    return m_process.readAllStandardError();
+}
+
+qint64 ContainerExecProcess::write(const QByteArray &data)
+{
+    return m_process.write(data);
+}
+
+void ContainerExecProcess::handleReadyReadStandardOutput()
+{
+    m_launcher->addOutput(m_process.readAllStandardOutput());
+    if (m_launcher->hasOutput())
+        emit readyReadStandardOutput();
+}
+
+void ContainerExecProcess::handleFinished()
+{
+    m_launcher->finishOutput();
+    if (m_launcher->hasOutput())
+        emit readyReadStandardOutput();
+
+    m_launcher->release();
+    emit finished();
+}
+
+/*!
+ * \brief ContainerExecProcess::sendSignal
+ * Signals the application inside the container, as long as the
+ * pid is not known the local lmsdk-target process is signalled
+ */
+void ContainerExecProcess::sendSignal(int signal)
+{
+    QTC_ASSERT(m_launcher, return);
+
+    if (m_launcher->cancelPendingStart()) {
+        emit finished();
+        return;
+    }
+
+    if (m_process.state() == QProcess::NotRunning)
+        return;
+
+    if (m_launcher->signalApplication(signal))
+        return;
+
+    if (signal == SIGKILL)
+        m_process.kill();
+    else
+        m_process.terminate();
+}
+
+} // namespace Internal
+} // namespace LmBase
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#ifndef LM_INTERNAL_CONTAINEREXECPROCESS_H
+#define LM_INTERNAL_CONTAINEREXECPROCESS_H
+
+#include "containerdevice.h"
+
+#include <projectexplorer/devicesupport/deviceprocess.h>
+#include <projectexplorer/runnables.h>
+
+#include <QProcess>
+
+namespace LmBase {
+namespace Internal {
+
+class ContainerLauncher;
+
+/*!
+ * \brief The ContainerExecProcess class
+ * Runs a application in a local container device without SSH, the
+ * program is started with lmsdk-target exec and the stdio pipes
+ * and exit code of the container side are used directly.
+ *
+ * The ContainerLauncher reports the pid of the application inside the
+ * container on the output and strips it again, signals are sent to
+ * that pid through LXD.
+ */
+class ContainerExecProcess : public ProjectExplorer::DeviceProcess
+{
+    Q_OBJECT
+
+public:
+    ContainerExecProcess (const QSharedPointer<const ProjectExplorer::IDevice> &device, QObject *parent = 0);
+    ~ContainerExecProcess ();
+
+    // DeviceProcess interface
+    virtual void start (const ProjectExplorer::Runnable &runnable) override;
+    virtual void interrupt () override;
+    virtual void terminate () override;
+    virtual void kill () override;
+    virtual QProcess::ProcessState state () const override;
+    virtual QProcess::ExitStatus exitStatus () const override;
+    virtual int exitCode () const override;
+    virtual QString errorString () const override;
+    virtual QByteArray readAllStandardOutput () override;
+    virtual QByteArray readAllStandardError () override;
+    virtual qint64 write (const QByteArray &data) override;
+
+private:
+    void handleReadyReadStandardOutput ();
+    void handleFinished ();
+    void startProcess ();
+    void sendSignal (int signal);
+
+private:
+    QProcess m_process;
+    ContainerLauncher *m_launcher = nullptr;
+};
+
+} // namespace Internal
+} // namespace LmBase
+
+#endif // LM_INTERNAL_CONTAINEREXECPROCESS_H
@@ -0,0 +1,179 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#include "containerlauncher.h"
+#include "containerdevicesignaloperation.h"
+
+#include <utils/qtcprocess.h>
+
+namespace LmBase {
+namespace Internal {
+
+ContainerLauncher::ContainerLauncher(const ContainerDevice::ConstPtr &device, QObject *parent)
+    : QObject(parent)
+    , m_device(device)
+    , m_weston(ContainerWeston::forContainer(device->containerName()))
+{
+    connect(m_weston.data(), &ContainerWeston::startFinished,
+            this, &ContainerLauncher::handleWestonStarted);
+}
+
+ContainerLauncher::~ContainerLauncher()
+{
+    release();
+}
+
+/*!
+ * \brief ContainerLauncher::prepare
+ * Resets the output state for a new run of \a runnable and points GUI
+ * applications to the compositor. Returns false if the compositor is
+ * still starting, readyToStart is emitted once the application can run.
+ */
+bool ContainerLauncher::prepare(ProjectExplorer::StandardRunnable *runnable)
+{
+    m_pidFilter.reset();
+    m_output.clear();
+
+    if (runnable->runMode != ProjectExplorer::ApplicationLauncher::Gui || !m_weston)
+        return true;
+
+    if (!m_westonAcquired) {
+        m_weston->acquire(m_device->westonConfig());
+        m_westonAcquired = true;
+    }
+    runnable->environment.appendOrSet(QStringLiteral("XDG_RUNTIME_DIR"),
+                                      m_weston->runtimeDirectory());
+
+    m_startPending = m_weston->isStarting();
+    return !m_startPending;
+}
+
+/*!
+ * \brief ContainerLauncher::cancelPendingStart
+ * Returns true if the application was not started yet and
+ * will not be started anymore
+ */
+bool ContainerLauncher::cancelPendingStart()
+{
+    if (!m_startPending)
+        return false;
+
+    release();
+    return true;
+}
+
+/*!
+ * \brief ContainerLauncher::release
+ * The compositor is kept running for the next application
+ */
+void ContainerLauncher::release()
+{
+    m_startPending = false;
+    if (m_westonAcquired) {
+        m_weston->release();
+        m_westonAcquired = false;
+    }
+}
+
+void ContainerLauncher::addOutput(const QByteArray &data)
+{
+    m_output.append(m_pidFilter.filter(data));
+}
+
+/*!
+ * \brief ContainerLauncher::finishOutput
+ * Releases output held back by the pid filter, the shell
+ * might have failed before it could report the pid
+ */
+void ContainerLauncher::finishOutput()
+{
+    m_output.append(m_pidFilter.flush());
+}
+
+bool ContainerLauncher::hasOutput() const
+{
+    return !m_output.isEmpty();
+}
+
+QByteArray ContainerLauncher::takeOutput()
+{
+    const QByteArray data = m_output;
+    m_output.clear();
+    return data;
+}
+
+/*!
+ * \brief ContainerLauncher::signalApplication
+ * Sends \a signal to the application inside the container, returns
+ * false if its pid is not known yet
+ */
+bool ContainerLauncher::signalApplication(int signal)
+{
+    if (m_pidFilter.pid() <= 0)
+        return false;
+
+    ContainerDeviceSignalOperation::signalProcess(m_device, int(m_pidFilter.pid()), signal);
+    return true;
+}
+
+/*!
+ * \brief ContainerLauncher::commandLine
+ * The shell command starting \a runnable in the container, it reads the
+ * profile, reports its pid and replaces itself with the application
+ */
+QString ContainerLauncher::commandLine(const ProjectExplorer::StandardRunnable &runnable)
+{
+    QString commandLine;
+    QStringList rcFiles {
+        QLatin1String("/etc/profile")
+        , QLatin1String("$HOME/.profile")
+    };
+    foreach (const QString &filePath, rcFiles)
+        commandLine += QString::fromLatin1("test -f %1 && . %1;").arg(filePath);
+
+    if (!runnable.workingDirectory.isEmpty()) {
+        commandLine.append(QLatin1String(" cd ")).append(Utils::QtcProcess::quoteArgUnix(runnable.workingDirectory))
+                .append(QLatin1String(" || exit 1;"));
+    }
+
+    commandLine += QString::fromLatin1(" echo %1$$; exec env").arg(ContainerPidFilter::marker());
+    for (auto it = runnable.environment.constBegin(); it != runnable.environment.constEnd(); ++it) {
+        commandLine.append(QLatin1Char(' '));
+        commandLine.append(Utils::QtcProcess::quoteArgUnix(it.key() + QLatin1Char('=') + it.value()));
+    }
+
+    commandLine.append(QLatin1Char(' '));
+    commandLine.append(Utils::QtcProcess::quoteArgUnix(runnable.executable));
+    if (!runnable.commandLineArguments.isEmpty()) {
+        commandLine.append(QLatin1Char(' '));
+        commandLine.append(runnable.commandLineArguments);
+    }
+    return commandLine;
+}
+
+void ContainerLauncher::handleWestonStarted()
+{
+    if (!m_startPending)
+        return;
+
+    m_startPending = false;
+    emit readyToStart();
+}
+
+} // namespace Internal
+} // namespace LmBase
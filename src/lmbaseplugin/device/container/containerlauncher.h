@@ -0,0 +1,81 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#ifndef LM_INTERNAL_CONTAINERLAUNCHER_H
+#define LM_INTERNAL_CONTAINERLAUNCHER_H
+
+#include "containerdevice.h"
+#include "containerpidfilter.h"
+#include "containerweston.h"
+
+#include <projectexplorer/runnables.h>
+
+#include <QObject>
+
+namespace LmBase {
+namespace Internal {
+
+/*!
+ * \brief The ContainerLauncher class
+ * The part of starting a application on a container device both the
+ * SSH and the exec transport share. It makes GUI applications wait for
+ * the compositor of the container, builds the shell command line that
+ * reports the pid of the application and strips that pid from the
+ * output again, so the application can be signalled inside the container.
+ */
+class ContainerLauncher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ContainerLauncher (const ContainerDevice::ConstPtr &device, QObject *parent = 0);
+    ~ContainerLauncher ();
+
+    bool prepare (ProjectExplorer::StandardRunnable *runnable);
+    bool cancelPendingStart ();
+    void release ();
+
+    void addOutput (const QByteArray &data);
+    void finishOutput ();
+    bool hasOutput () const;
+    QByteArray takeOutput ();
+
+    bool signalApplication (int signal);
+
+    static QString commandLine (const ProjectExplorer::StandardRunnable &runnable);
+
+signals:
+    //the compositor is ready, the start prepare() held back can happen now
+    void readyToStart ();
+
+private:
+    void handleWestonStarted ();
+
+private:
+    ContainerDevice::ConstPtr m_device;
+    ContainerWeston::Ptr m_weston;
+    ContainerPidFilter m_pidFilter;
+    QByteArray m_output;
+    bool m_westonAcquired = false;
+    bool m_startPending = false;
+};
+
+} // namespace Internal
+} // namespace LmBase
+
+#endif // LM_INTERNAL_CONTAINERLAUNCHER_H
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#include "containerpidfilter.h"
+
+namespace LmBase {
+namespace Internal {
+
+const char PID_MARKER[] = "LMSDK_PID:";
+
+QString ContainerPidFilter::marker()
+{
+    return QLatin1String(PID_MARKER);
+}
+
+/*!
+ * \brief couldBeMarkerLine
+ * Checks if the line at the start of \a data can still turn out to be the
+ * pid line, \a newline is the end of the line or -1 if it is incomplete
+ */
+static bool couldBeMarkerLine(const QByteArray &data, int newline)
+{
+    const QByteArray marker = QByteArray::fromRawData(PID_MARKER, int(qstrlen(PID_MARKER)));
+    if (newline >= 0 || data.size() >= marker.size())
+        return data.startsWith(marker);
+    return marker.startsWith(data);
+}
+
+/*!
+ * \brief ContainerPidFilter::filter
+ * Returns the part of \a data that belongs to the output, only a line
+ * that might be the pid line is held back until it is complete
+ */
+QByteArray ContainerPidFilter::filter(const QByteArray &data)
+{
+    if (m_done)
+        return data;
+
+    m_buffer.append(data);
+
+    QByteArray output;
+    while (!m_buffer.isEmpty()) {
+        const int newline = m_buffer.indexOf('\n');
+        if (m_atLineStart && couldBeMarkerLine(m_buffer, newline)) {
+            if (newline < 0)
+                break;
+
+            m_pid = m_buffer.mid(int(qstrlen(PID_MARKER)), newline - int(qstrlen(PID_MARKER))).trimmed().toLongLong();
+            m_buffer.remove(0, newline + 1);
+            return output + flush();
+        }
+
+        //not the pid line, pass it on right away
+        const int length = newline < 0 ? m_buffer.size() : newline + 1;
+        output += m_buffer.left(length);
+        m_buffer.remove(0, length);
+        m_atLineStart = newline >= 0;
+        m_scanned += length;
+    }
+
+    if (m_scanned + m_buffer.size() > MAX_SCAN)
+        output += flush();
+    return output;
+}
+
+/*!
+ * \brief ContainerPidFilter::flush
+ * Gives up waiting for the pid, e.g. because the shell failed
+ * before it could print it, and returns the held back output
+ */
+QByteArray ContainerPidFilter::flush()
+{
+    m_done = true;
+
+    const QByteArray data = m_buffer;
+    m_buffer.clear();
+    return data;
+}
+
+void ContainerPidFilter::reset()
+{
+    m_buffer.clear();
+    m_pid = 0;
+    m_scanned = 0;
+    m_atLineStart = true;
+    m_done = false;
+}
+
+/*!
+ * \brief ContainerPidFilter::pid
+ * Returns the pid of the application inside the container,
+ * or 0 if it was not received yet
+ */
+qint64 ContainerPidFilter::pid() const
+{
+    return m_pid;
+}
+
+} // namespace Internal
+} // namespace LmBase
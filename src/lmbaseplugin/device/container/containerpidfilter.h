@@ -0,0 +1,62 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#ifndef LM_INTERNAL_CONTAINERPIDFILTER_H
+#define LM_INTERNAL_CONTAINERPIDFILTER_H
+
+#include <QByteArray>
+#include <QString>
+
+namespace LmBase {
+namespace Internal {
+
+/*!
+ * \brief The ContainerPidFilter class
+ * The shell starting a application in a container prints the pid of
+ * the application on a line of its own before it execs the program,
+ * the profile scripts sourced before can print lines of their own. The
+ * filter takes the pid line from the output and passes everything else
+ * on unchanged, it stops looking for it after MAX_SCAN bytes.
+ */
+class ContainerPidFilter
+{
+public:
+    static QString marker ();
+
+    QByteArray filter (const QByteArray &data);
+    QByteArray flush ();
+    void reset ();
+
+    qint64 pid () const;
+
+    enum {
+        MAX_SCAN = 64 * 1024
+    };
+
+private:
+    QByteArray m_buffer;
+    qint64 m_pid = 0;
+    int  m_scanned = 0;
+    bool m_atLineStart = true;
+    bool m_done = false;
+};
+
+} // namespace Internal
+} // namespace LmBase
+
+#endif // LM_INTERNAL_CONTAINERPIDFILTER_H
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+
+#include "containerpidfiltertest.h"
+#include "containerpidfilter.h"
+
+#include <QTest>
+
+namespace LmBase {
+namespace Internal {
+
+void ContainerPidFilterTest::testFilter_data()
+{
+    QTest::addColumn<QList<QByteArray>>("chunks");
+    QTest::addColumn<QByteArray>("expected");
+    QTest::addColumn<qint64>("pid");
+
+    QTest::newRow("first-line")
+            << QList<QByteArray>{ "LMSDK_PID:42\nHello\n" }
+            << QByteArray("Hello\n")
+            << qint64(42);
+    QTest::newRow("profile-output")
+            << QList<QByteArray>{ "Welcome to the container\n",
+                                  "LMSDK_PID notice\nLMSDK\n",
+                                  "LMSDK_PID:1234\nHello\n" }
+            << QByteArray("Welcome to the container\nLMSDK_PID notice\nLMSDK\nHello\n")
+            << qint64(1234);
+    QTest::newRow("split-marker")
+            << QList<QByteArray>{ "motd\nLMS", "DK_PI", "D:77", "\r\nHel", "lo\n" }
+            << QByteArray("motd\nHello\n")
+            << qint64(77);
+    QTest::newRow("marker-mid-line")
+            << QList<QByteArray>{ "echo LMSDK_PID:5\n", "LMSDK_PID:6\n" }
+            << QByteArray("echo LMSDK_PID:5\n")
+            << qint64(6);
+}
+
+void ContainerPidFilterTest::testFilter()
+{
+    QFETCH(QList<QByteArray>, chunks);
+    QFETCH(QByteArray, expected);
+    QFETCH(qint64, pid);
+
+    ContainerPidFilter filter;
+    QByteArray output;
+    for (const QByteArray &chunk : chunks)
+        output += filter.filter(chunk);
+    output += filter.flush();
+
+    QCOMPARE(output, expected);
+    QCOMPARE(filter.pid(), pid);
+}
+
+void ContainerPidFilterTest::testNoMarker()
+{
+    ContainerPidFilter filter;
+    const QByteArray line(79, 'x');
+
+    QByteArray input;
+    QByteArray output;
+    while (input.size() <= ContainerPidFilter::MAX_SCAN) {
+        input += line + '\n';
+        output += filter.filter(line + '\n');
+    }
+
+    //lines without the marker are never held back
+    QCOMPARE(output, input);
+
+    //the filter gave up, a late marker is plain output
+    QCOMPARE(filter.filter("LMSDK_PID:9\n"), QByteArray("LMSDK_PID:9\n"));
+    QCOMPARE(filter.pid(), qint64(0));
+}
+
+} // namespace Internal
+} // namespace LmBase
@@ -0,0 +1,46 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+
+#ifndef LM_INTERNAL_CONTAINERPIDFILTERTEST_H
+#define LM_INTERNAL_CONTAINERPIDFILTERTEST_H
+
+#include <QObject>
+
+namespace LmBase {
+namespace Internal {
+
+/*!
+ * \brief The ContainerPidFilterTest class
+ * Feeds the ContainerPidFilter with output the way it arrives from
+ * the container, in arbitrary chunks and after the profile output
+ */
+class ContainerPidFilterTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testFilter_data ();
+    void testFilter ();
+    void testNoMarker ();
+};
+
+} // namespace Internal
+} // namespace LmBase
+
+#endif // LM_INTERNAL_CONTAINERPIDFILTERTEST_H
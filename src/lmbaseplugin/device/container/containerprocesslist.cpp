@@ -21,6 +21,7 @@
 #include "containerdevice.h"
 #include <lmbaseplugin/lmbaseplugin_constants.h>
 #include <lmbaseplugin/lmbaseplugin.h>
+#include <lmbaseplugin/lxd/lxdclient.h>
 
 #include <utils/synchronousprocess.h>
 #include <coreplugin/id.h>
@@ -32,43 +33,59 @@
 namespace LmBase {
 namespace Internal {
 
+// Split "457 /Users/foo.app arg1 arg2"
+static QList<ProjectExplorer::DeviceProcessItem> parsePsOutput(const QByteArray &output)
+{
+    QList<ProjectExplorer::DeviceProcessItem> processes;
+    const QStringList lines = QString::fromLocal8Bit(output).split(QLatin1Char('\n'));
+    const int lineCount = lines.size();
+    const QChar blank = QLatin1Char(' ');
+    for (int l = 1; l < lineCount; l++) { // Skip header
+        const QString line = lines.at(l).simplified();
+        const int pidSep = line.indexOf(blank);
+        const int cmdSep = pidSep != -1 ? line.indexOf(blank, pidSep + 1) : -1;
+        if (cmdSep > 0) {
+            const int argsSep = cmdSep != -1 ? line.indexOf(blank, cmdSep + 1) : -1;
+            ProjectExplorer::DeviceProcessItem procData;
+            procData.pid = line.left(pidSep).toInt();
+            procData.cmdLine = line.mid(cmdSep + 1);
+            if (argsSep == -1)
+                procData.exe = line.mid(cmdSep + 1);
+            else
+                procData.exe = line.mid(cmdSep + 1, argsSep - cmdSep -1);
+            processes.push_back(procData);
+        }
+    }
+    return processes;
+}
+
 // shamelessly stolen from localprocesslist.cpp
 // Determine UNIX processes by running ps
 static QList<ProjectExplorer::DeviceProcessItem> getContainerProcessesWithPs(const QString &containerName)
 {
-    QList<ProjectExplorer::DeviceProcessItem> processes;
+    const QStringList psArgs {
+        QStringLiteral("ps"), QStringLiteral("-e"), QStringLiteral("-o"), QStringLiteral("pid,comm,args")
+    };
+
+    //talking to LXD directly saves spawning lmsdk-target
+    if (LxdClient::isAvailable()) {
+        QByteArray output;
+        int exitCode = -1;
+        if (LxdClient().exec(containerName, psArgs, &output, &exitCode) && exitCode == 0)
+            return parsePsOutput(output);
+    }
+
     QProcess psProcess;
     QStringList args;
-    args <<QStringLiteral("exec") << containerName << QStringLiteral("ps")
-        << QStringLiteral("-e") << QStringLiteral("-o") << QStringLiteral("pid,comm,args");
+    args <<QStringLiteral("exec") << containerName << psArgs;
     psProcess.setArguments(args);
     psProcess.start(LinkMotionBasePlugin::lmTargetTool());
     if (psProcess.waitForStarted()) {
         QByteArray output;
-        if (Utils::SynchronousProcess::readDataFromProcess(psProcess, 30000, &output, 0, false)) {
-            // Split "457 /Users/foo.app arg1 arg2"
-            const QStringList lines = QString::fromLocal8Bit(output).split(QLatin1Char('\n'));
-            const int lineCount = lines.size();
-            const QChar blank = QLatin1Char(' ');
-            for (int l = 1; l < lineCount; l++) { // Skip header
-                const QString line = lines.at(l).simplified();
-                const int pidSep = line.indexOf(blank);
-                const int cmdSep = pidSep != -1 ? line.indexOf(blank, pidSep + 1) : -1;
-                if (cmdSep > 0) {
-                    const int argsSep = cmdSep != -1 ? line.indexOf(blank, cmdSep + 1) : -1;
-                    ProjectExplorer::DeviceProcessItem procData;
-                    procData.pid = line.left(pidSep).toInt();
-                    procData.cmdLine = line.mid(cmdSep + 1);
-                    if (argsSep == -1)
-                        procData.exe = line.mid(cmdSep + 1);
-                    else
-                        procData.exe = line.mid(cmdSep + 1, argsSep - cmdSep -1);
-                    processes.push_back(procData);
-                }
-            }
-        }
+        if (Utils::SynchronousProcess::readDataFromProcess(psProcess, 30000, &output, 0, false))
+            return parsePsOutput(output);
     }
-    return processes;
+    return QList<ProjectExplorer::DeviceProcessItem>();
 }
 
 ContainerProcessList::ContainerProcessList(const ContainerDevice::ConstPtr &device, QObject *parent)
@@ -0,0 +1,227 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#include "containerweston.h"
+#include "percontainer.h"
+
+#include <lmbaseplugin/lmbaseplugin_constants.h>
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QTemporaryDir>
+#include <QDebug>
+
+namespace LmBase {
+namespace Internal {
+
+enum {
+    debug = 0
+};
+
+const char WESTON_SOCKET[] = "wayland-0";
+
+//the applications are started anyway if the socket does not show up
+const int START_TIMEOUT = 10000;
+
+//the compositor is stopped if no application was started for this long
+const int IDLE_TIMEOUT = 10 * 60 * 1000;
+
+ContainerWeston::Ptr ContainerWeston::forContainer(const QString &containerName)
+{
+    return PerContainer<ContainerWeston>::instance(containerName, []() {
+        return new ContainerWeston;
+    });
+}
+
+ContainerWeston::ContainerWeston()
+    : QObject(nullptr)
+{
+    m_startTimer.setSingleShot(true);
+    m_startTimer.setInterval(START_TIMEOUT);
+    connect(&m_startTimer, &QTimer::timeout, this, &ContainerWeston::handleStartTimeout);
+
+    m_idleTimer.setSingleShot(true);
+    m_idleTimer.setInterval(IDLE_TIMEOUT);
+    connect(&m_idleTimer, &QTimer::timeout, this, &ContainerWeston::stop);
+
+    connect(&m_socketWatcher, &QFileSystemWatcher::directoryChanged,
+            this, &ContainerWeston::checkSocket);
+
+    //the devices might outlive the event loop
+    connect(qApp, &QCoreApplication::aboutToQuit, this, &ContainerWeston::stop);
+}
+
+ContainerWeston::~ContainerWeston()
+{
+    stop();
+}
+
+/*!
+ * \brief ContainerWeston::acquire
+ * Registers a application using the compositor, it is started
+ * with \a config if it is not running already
+ */
+void ContainerWeston::acquire(const Utils::FileName &config)
+{
+    ++m_users;
+    m_idleTimer.stop();
+
+    if (m_state == Stopped)
+        start(config);
+}
+
+void ContainerWeston::release()
+{
+    if (m_users <= 0)
+        return;
+
+    if (--m_users == 0 && m_state != Stopped)
+        m_idleTimer.start();
+}
+
+bool ContainerWeston::isStarting() const
+{
+    return m_state == Starting;
+}
+
+QString ContainerWeston::runtimeDirectory() const
+{
+    return m_runtimeDir ? m_runtimeDir->path() : QString();
+}
+
+void ContainerWeston::start(const Utils::FileName &config)
+{
+    m_runtimeDir = new QTemporaryDir(QStringLiteral("/tmp/lmsdk-XXXXXX"));
+    if (!m_runtimeDir->isValid()) {
+        qDebug()<<"Unable to create weston dir";
+    }
+
+    m_process = new QProcess(this);
+    QStringList args{
+        QString::fromLatin1("--socket=%1").arg(QLatin1String(WESTON_SOCKET))
+    };
+    if (config.exists())
+        args.append(QString::fromLatin1("-c%1").arg(config.toString()));
+    else
+        args.append(QString::fromLatin1("-c%1/../weston.ini").arg(Constants::LM_SCRIPTPATH));
+    m_process->setArguments(args);
+
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    env.insert(QStringLiteral("XDG_RUNTIME_DIR"), m_runtimeDir->path());
+    m_process->setProcessEnvironment(env);
+    m_process->setProgram(QStringLiteral("weston"));
+
+    connect(m_process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+            this, &ContainerWeston::handleProcessFinished);
+    connect(m_process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            qDebug()<<"Failed to start Weston "<<m_process->errorString();
+            handleProcessFinished();
+        }
+    });
+
+    m_state = Starting;
+    if (m_runtimeDir->isValid())
+        m_socketWatcher.addPath(m_runtimeDir->path());
+    m_startTimer.start();
+    m_process->start();
+
+    if (debug) qDebug()<<"Starting weston in"<<m_runtimeDir->path();
+}
+
+/*!
+ * \brief ContainerWeston::checkSocket
+ * The runtime directory changed, weston is ready as soon
+ * as it created the Wayland socket
+ */
+void ContainerWeston::checkSocket()
+{
+    if (m_state != Starting || !m_runtimeDir)
+        return;
+
+    if (QFileInfo(m_runtimeDir->path() + QLatin1Char('/') + QLatin1String(WESTON_SOCKET)).exists())
+        finishStart();
+}
+
+void ContainerWeston::handleStartTimeout()
+{
+    if (m_state != Starting)
+        return;
+
+    qWarning()<<"Weston did not create its socket within"<<START_TIMEOUT<<"ms";
+    finishStart();
+}
+
+void ContainerWeston::finishStart()
+{
+    m_startTimer.stop();
+    if (m_runtimeDir)
+        m_socketWatcher.removePath(m_runtimeDir->path());
+
+    m_state = Running;
+    if (m_users == 0)
+        m_idleTimer.start();
+
+    if (debug) qDebug()<<"Weston is ready";
+    emit startFinished();
+}
+
+/*!
+ * \brief ContainerWeston::handleProcessFinished
+ * Weston exited on its own, e.g. because its window was closed.
+ * The next application starts it again
+ */
+void ContainerWeston::handleProcessFinished()
+{
+    const bool wasStarting = m_state == Starting;
+    stop();
+
+    //do not leave waiting applications behind
+    if (wasStarting)
+        emit startFinished();
+}
+
+void ContainerWeston::stop()
+{
+    m_startTimer.stop();
+    m_idleTimer.stop();
+
+    if (m_process) {
+        m_process->disconnect(this);
+        if (m_process->state() != QProcess::NotRunning) {
+            m_process->terminate();
+            if (!m_process->waitForFinished(3000))
+                m_process->kill();
+        }
+        m_process->deleteLater();
+        m_process = nullptr;
+    }
+
+    if (m_runtimeDir) {
+        m_socketWatcher.removePath(m_runtimeDir->path());
+        delete m_runtimeDir;
+        m_runtimeDir = nullptr;
+    }
+
+    m_state = Stopped;
+}
+
+} // namespace Internal
+} // namespace LmBase
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#ifndef LM_INTERNAL_CONTAINERWESTON_H
+#define LM_INTERNAL_CONTAINERWESTON_H
+
+#include <utils/fileutils.h>
+
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QSharedPointer>
+#include <QTimer>
+
+QT_BEGIN_NAMESPACE
+class QProcess;
+class QTemporaryDir;
+QT_END_NAMESPACE
+
+namespace LmBase {
+namespace Internal {
+
+/*!
+ * \brief The ContainerWeston class
+ * Runs the weston compositor on the host that GUI applications of a
+ * container device are displayed in. There is one compositor per
+ * container, it is started by the first GUI run and reused by the
+ * following ones. It is ready as soon as its Wayland socket appears.
+ *
+ * When no application used it for a while, or Qt Creator exits,
+ * the compositor is stopped.
+ */
+class ContainerWeston : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef QSharedPointer<ContainerWeston> Ptr;
+
+    static Ptr forContainer (const QString &containerName);
+    ~ContainerWeston ();
+
+    void acquire (const Utils::FileName &config);
+    void release ();
+
+    bool isStarting () const;
+    QString runtimeDirectory () const;
+
+signals:
+    /*!
+     * \brief startFinished
+     * Emitted when the Wayland socket was created, or if the
+     * compositor did not come up within the timeout
+     */
+    void startFinished ();
+
+private slots:
+    void checkSocket ();
+    void handleStartTimeout ();
+    void handleProcessFinished ();
+    void stop ();
+
+private:
+    enum State {
+        Stopped,
+        Starting,
+        Running
+    };
+
+    ContainerWeston ();
+
+    void start (const Utils::FileName &config);
+    void finishStart ();
+
+private:
+    State m_state = Stopped;
+    int m_users = 0;
+    QProcess *m_process = nullptr;
+    QTemporaryDir *m_runtimeDir = nullptr;
+    QFileSystemWatcher m_socketWatcher;
+    QTimer m_startTimer;
+    QTimer m_idleTimer;
+};
+
+} // namespace Internal
+} // namespace LmBase
+
+#endif // LM_INTERNAL_CONTAINERWESTON_H
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#ifndef LM_INTERNAL_PERCONTAINER_H
+#define LM_INTERNAL_PERCONTAINER_H
+
+#include <QHash>
+#include <QObject>
+#include <QSharedPointer>
+#include <QString>
+#include <QTimer>
+#include <QWeakPointer>
+
+#include <functional>
+
+namespace LmBase {
+namespace Internal {
+
+/*!
+ * \brief The PerContainer class
+ * Keeps one shared instance of \a T per container. The instance is
+ * created on first use and lives as long as one of the devices or
+ * processes of the container holds a pointer to it. It is deleted
+ * later, the last pointer might be dropped from one of its own signals.
+ */
+template <typename T>
+class PerContainer
+{
+public:
+    typedef QSharedPointer<T> Ptr;
+
+    /*!
+     * \brief PerContainer::instance
+     * Returns the instance of \a containerName, \a create makes a new one.
+     * The \a activate slot of a new instance is called once the event loop
+     * runs again, the device asking for it is not registered yet.
+     */
+    static Ptr instance (const QString &containerName, const std::function<T *()> &create,
+                         void (T::*activate)() = nullptr)
+    {
+        static QHash<QString, QWeakPointer<T> > instances;
+
+        Ptr obj = instances.value(containerName).toStrongRef();
+        if (!obj) {
+            obj = Ptr(create(), &QObject::deleteLater);
+            instances.insert(containerName, obj);
+
+            if (activate)
+                QTimer::singleShot(0, obj.data(), activate);
+        }
+        return obj;
+    }
+};
+
+} // namespace Internal
+} // namespace LmBase
+
+#endif // LM_INTERNAL_PERCONTAINER_H
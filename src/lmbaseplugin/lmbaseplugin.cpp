@@ -27,6 +27,13 @@
 #include "lmqtversion.h"
 #include "lmwelcomepage.h"
 #include "processoutputdialog.h"
+#ifdef WITH_TESTS
+#include "lmbenchmark.h"
+#include "compilercachetest.h"
+#include "preamblecachetest.h"
+#include "lxd/lxdclienttest.h"
+#include "device/container/containerpidfiltertest.h"
+#endif
 
 #include <lmbaseplugin/lmsettingstargetpage.h>
 
@@ -92,6 +99,7 @@
 #include <QAction>
 #include <QMessageBox>
 #include <QCheckBox>
+#include <QElapsedTimer>
 
 #include <coreplugin/icore.h>
 #include <stdint.h>
@@ -124,6 +132,11 @@ bool LinkMotionBasePlugin::initialize(const QStringList &arguments, QString *err
     Q_UNUSED(arguments)
     Q_UNUSED(errorString)
 
+#ifdef WITH_TESTS
+    QElapsedTimer initializeTimer;
+    initializeTimer.start();
+#endif
+
     if (::getuid() == 0) {
         criticalError(tr("\nThe Link Motion SDK can not be used as superuser."));
         return false;
@@ -161,6 +174,27 @@ bool LinkMotionBasePlugin::initialize(const QStringList &arguments, QString *err
         return false;
     }
 
+    //restore the targets from the cache or query them in the background,
+    //toolchains, kits and devices are updated as soon as the registry is loaded
+    m_targetRegistry.load();
+
+    //compiler probes of earlier sessions, shared by all targets of the same image
+    m_probeCache.load();
+
+    //containers created or removed behind our back are picked up right away
+    connect(&m_lxdEvents, &LxdEventMonitor::containerListChanged,
+            &m_targetRegistry, &TargetRegistry::refresh);
+    m_lxdEvents.start();
+
+    //projects on the same target share the precompiled Qt headers in the code model
+    m_preambles.start();
+
+    //the index and preamble stamps depend on the registry, builds wait for it
+    connect(&m_targetRegistry, &TargetRegistry::refreshFinished,
+            &m_debugIndex, &DebugIndexCache::startNext);
+    connect(&m_targetRegistry, &TargetRegistry::refreshFinished,
+            &m_preambles, &PreambleCache::startNext);
+
     // welcome page plugin
     addAutoReleasedObject(new LinkMotionWelcomePage);
 
@@ -173,7 +207,8 @@ bool LinkMotionBasePlugin::initialize(const QStringList &arguments, QString *err
     CMakeProjectManager::CMakeToolManager::registerAutodetectionHelper([](){
         QList<CMakeProjectManager::CMakeTool *> found;
 
-        QList<LinkMotionTargetTool::Target> targets = LinkMotionTargetTool::listAvailableTargets();
+        //targets not known yet get their tool when the kits are created
+        QList<LinkMotionTargetTool::Target> targets = TargetRegistry::instance()->targets();
         foreach (const LinkMotionTargetTool::Target &t, targets) {
             CMakeProjectManager::CMakeTool *tool = LinkMotionKitManager::createCMakeTool(t);
             if (tool)
@@ -266,6 +301,9 @@ bool LinkMotionBasePlugin::initialize(const QStringList &arguments, QString *err
 
     #endif
 
+#ifdef WITH_TESTS
+    m_initializeTime = initializeTimer.elapsed();
+#endif
     return true;
 }
 
@@ -326,12 +364,36 @@ QString LinkMotionBasePlugin::lmTargetWrapper()
     return lmsdkTarget;
 }
 
+#ifdef WITH_TESTS
+QList<QObject *> LinkMotionBasePlugin::createTestObjects() const
+{
+    return QList<QObject *>() << new LinkMotionBenchmark(const_cast<LinkMotionBasePlugin *>(this))
+                              << new LxdClientTest
+                              << new CompilerCacheTest
+                              << new PreambleCacheTest
+                              << new ContainerPidFilterTest;
+}
+#endif
+
 void LinkMotionBasePlugin::onKitsLoaded()
 {
+#ifdef WITH_TESTS
+    QElapsedTimer kitsLoadedTimer;
+    kitsLoadedTimer.start();
+#endif
+
+    //from now on kits follow all changes in the target registry
+    connect(&m_targetRegistry, &TargetRegistry::targetsChanged,
+            &LinkMotionKitManager::autoDetectKits);
+
     LinkMotionKitManager::autoDetectKits();
     disconnect(ProjectExplorer::KitManager::instance(),SIGNAL(kitsLoaded())
                ,this,SLOT(onKitsLoaded()));
 
+#ifdef WITH_TESTS
+    m_kitsLoadedTime = kitsLoadedTimer.elapsed();
+#endif
+
     showFirstStartWizard();
 
 }
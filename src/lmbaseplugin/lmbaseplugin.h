@@ -24,6 +24,11 @@
 
 #include "lmbaseplugin_global.h"
 #include "settings.h"
+#include "lmtargetregistry.h"
+#include "lxd/lxdeventmonitor.h"
+#include "toolchainprobecache.h"
+#include "debugindexcache.h"
+#include "preamblecache.h"
 #if 0
 #include "ubuntudevicemode.h"
 #include "ubuntupackagingmode.h"
@@ -52,6 +57,10 @@ public:
     static QString lmTargetTool ();
     static QString lmTargetWrapper ();
 
+#ifdef WITH_TESTS
+    QList<QObject *> createTestObjects() const override;
+#endif
+
 private slots:
     void onKitsLoaded ();
     void showFirstStartWizard ();
@@ -65,8 +74,19 @@ protected:
     //UbuntuPackagingMode    *m_ubuntuPackagingMode;
     //QAction                *m_migrateProjectAction;
     Settings                m_settings;
+    TargetRegistry          m_targetRegistry;
+    LxdEventMonitor         m_lxdEvents;
+    ToolChainProbeCache     m_probeCache;
+    DebugIndexCache         m_debugIndex;
+    PreambleCache           m_preambles;
 
     ProjectExplorer::Project *m_currentContextMenuProject;
+
+#ifdef WITH_TESTS
+    friend class LinkMotionBenchmark;
+    qint64 m_initializeTime = -1;
+    qint64 m_kitsLoadedTime = -1;
+#endif
 };
 
 
@@ -19,6 +19,12 @@ HEADERS += \
     lmbaseplugin_constants.h \
     lmbaseplugin_global.h \
     lmtargettool.h \
+    lmtargetregistry.h \
+    sysrootpathtranslator.h \
+    compilercache.h \
+    toolchainprobecache.h \
+    debugindexcache.h \
+    preamblecache.h \
     lmtoolchain.h \
     lmqtversion.h \
     lmkitmanager.h \
@@ -37,6 +43,12 @@ DEFINES += LMBASE_LIBRARY
 
 SOURCES += \
     lmtargettool.cpp \
+    lmtargetregistry.cpp \
+    sysrootpathtranslator.cpp \
+    compilercache.cpp \
+    toolchainprobecache.cpp \
+    debugindexcache.cpp \
+    preamblecache.cpp \
     lmtoolchain.cpp \
     lmqtversion.cpp \
     lmkitmanager.cpp \
@@ -50,6 +62,15 @@ SOURCES += \
     lmsettingstargetpage.cpp \
     simplecrypt.cpp
 
+equals(TEST, 1) {
+    HEADERS += lmbenchmark.h \
+        compilercachetest.h \
+        preamblecachetest.h
+    SOURCES += lmbenchmark.cpp \
+        compilercachetest.cpp \
+        preamblecachetest.cpp
+}
+
 DISTFILES += \
     lmbaseplugin_dependencies.pri \
     lmbaseplugin.json.in
@@ -63,5 +84,6 @@ FORMS += \
 
 include(wizards/wizards.pri)
 include(device/device.pri)
+include(lxd/lxd.pri)
 
 
@@ -57,6 +57,11 @@ const char LM_SUDO_BINARY[]   = "pkexec";
 
 //Build support
 const char LM_TARGET_TOOLCHAIN_ID[]   = "LinkMotion.ToolChain.ID";
+const char LM_KIT_GENERATOR_DEFAULTED[] = "LinkMotion.Kit.GeneratorDefaulted";
+const char LM_KIT_CONTAINER_NAME[]      = "LinkMotion.Kit.ContainerName";
+const char LM_KIT_TARGET_STAMP[]        = "LinkMotion.Kit.TargetStamp";
+const char LM_KIT_MATERIALIZED[]        = "LinkMotion.Kit.Materialized";
+const char LM_KIT_DEFAULT_MAKE_JOBS[]   = "LinkMotion.Kit.DefaultMakeJobs";
 
 //Qtversion support
 const char LM_QTVERSION_TYPE[]   = "LinkMotion.QtVersion.ID";
@@ -70,10 +75,29 @@ const char LM_DEVICE_TYPE_ID[] = "LinkMotion.DeviceTypeId";
 const int  LM_DESKTOP_PORT_START = 40000;
 const int  LM_DESKTOP_PORT_END = 41000;
 const char LM_CONTAINER_DEVICE_TYPE_ID[] = "LinkMotion.LocalDeviceTypeId.";
-const char LM_CONTAINER_DEPLOY_PUBKEY_SCRIPT[] = "%0/container_publickey_deploy";
 const char LM_TASK_CATEGORY_DEVICE [] = "Task.Category.LinkMotion.ContainerDevice";
-const char LM_DEVICE_SSHIDENTITY[] = "lmdevice_id_rsa";
+const char LM_DEVICE_SSHIDENTITY[] = "lmdevice_id_ecdsa";
+const char LM_DEVICE_SSHKEY_STAMP[] = ".ssh-key-stamp";
 const char LM_LOCAL_DEPLOYCONFIGURATION_ID[] = "LinkMotion.LocalDeployConfigurationId";
+const char LM_DEVICE_TRANSPORT_KEY[] = "LinkMotion.Device.Transport";
+const char LM_DEVICE_ACTION_USE_SSH[] = "LinkMotion.Device.Action.UseSsh";
+const char LM_DEVICE_ACTION_USE_EXEC[] = "LinkMotion.Device.Action.UseExec";
+
+//qmake wrapper answering -query from the cache of the Qt version
+const char LM_QMAKE_WRAPPER_SCRIPT[] = "%0/lmsdk_qmake";
+const char LM_QMAKE_QUERY_CACHE[]    = ".qmake-query";
+
+//make and cmake wrapper passing the job count of the kit on
+const char LM_MAKE_WRAPPER_SCRIPT[] = "%0/lmsdk_make";
+const char LM_MAKE_JOBS_VARIABLE[]  = "LMSDK_MAKE_JOBS";
+
+//host debugger wrapper using a per target gdb index cache
+const char LM_GDB_WRAPPER_SCRIPT[] = "%0/lmsdk_gdb";
+const char LM_GDB_WRAPPER_NAME[]   = "gdb-multiarch";
+const char LM_GDB_INDEX_CACHE[]    = ".gdb-index-cache";
+
+//precompiled Qt headers shared by the code model of all projects on a target
+const char LM_PREAMBLE_CACHE_DIR[] = ".code-model-preamble";
 
 
 
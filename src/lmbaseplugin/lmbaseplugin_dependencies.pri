@@ -9,6 +9,7 @@ QTC_PLUGIN_DEPENDS += \
     projectexplorer \
     qmakeprojectmanager \
     cmakeprojectmanager \
+    cpptools \
     debugger \
     qtsupport \
     remotelinux \
@@ -0,0 +1,242 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#include "lmbenchmark.h"
+#include "lmbaseplugin.h"
+#include "lmkitmanager.h"
+#include "lmtargetregistry.h"
+#include "lmtoolchain.h"
+
+#include <lmbaseplugin/device/container/containerdetection.h>
+#include <lmbaseplugin/device/container/containerdevice.h>
+#include <lmbaseplugin/device/container/containerdevicefactory.h>
+
+#include <projectexplorer/kitmanager.h>
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSignalSpy>
+#include <QTest>
+#include <QDebug>
+
+namespace LmBase {
+namespace Internal {
+
+const char ENV_BENCH_RESULT[]    = "LMSDK_BENCH_RESULT";
+const char ENV_BENCH_SPAWN_LOG[] = "LMSDK_BENCH_SPAWN_LOG";
+
+//the first registry load after a cold start can take a while with many targets
+const int REGISTRY_TIMEOUT = 120000;
+const int DEVICE_TIMEOUT   = 5000;
+
+LinkMotionBenchmark::LinkMotionBenchmark(LinkMotionBasePlugin *plugin)
+    : m_plugin(plugin)
+{
+}
+
+/*!
+ * \brief LinkMotionBenchmark::initTestCase
+ * Waits until the startup triggered by the plugin is done, including
+ * the target probes. The time spent here is part of the startup phase
+ */
+void LinkMotionBenchmark::initTestCase()
+{
+    m_timer.start();
+    QTRY_VERIFY_WITH_TIMEOUT(TargetRegistry::instance()->isLoaded()
+                             && !TargetRegistry::instance()->isRefreshing()
+                             && !LinkMotionKitManager::isDetecting(), REGISTRY_TIMEOUT);
+}
+
+/*!
+ * \brief LinkMotionBenchmark::benchmarkStartup
+ * Records everything that happened before the benchmark started,
+ * the registry wait is the time the first background load still needed
+ */
+void LinkMotionBenchmark::benchmarkStartup()
+{
+    const qint64 registryWait = m_timer.elapsed();
+
+    m_spawnsAtStart = 0;
+    finishPhase(QStringLiteral("startup"),
+                qMax<qint64>(m_plugin->m_initializeTime, 0)
+                + qMax<qint64>(m_plugin->m_kitsLoadedTime, 0)
+                + registryWait);
+
+    QJsonObject phase = m_phases.last().toObject();
+    phase.insert(QStringLiteral("initialize_ms"), m_plugin->m_initializeTime);
+    phase.insert(QStringLiteral("kits_loaded_ms"), m_plugin->m_kitsLoadedTime);
+    phase.insert(QStringLiteral("registry_wait_ms"), registryWait);
+    m_phases.replace(m_phases.size() - 1, phase);
+}
+
+void LinkMotionBenchmark::benchmarkRegistryRefresh()
+{
+    TargetRegistry *registry = TargetRegistry::instance();
+
+    startPhase();
+    registry->refresh();
+    QTRY_VERIFY_WITH_TIMEOUT(!registry->isRefreshing(), REGISTRY_TIMEOUT);
+    finishPhase(QStringLiteral("registry.refresh"));
+}
+
+void LinkMotionBenchmark::benchmarkAutoDetectKits()
+{
+    const QList<LinkMotionTargetTool::Target> targets = TargetRegistry::instance()->targets();
+    foreach (const LinkMotionTargetTool::Target &t, targets) {
+        foreach (ProjectExplorer::Kit *k, LinkMotionKitManager::findKitsUsingTarget(t))
+            ProjectExplorer::KitManager::deregisterKit(k);
+    }
+
+    //the targets are probed in the background
+    startPhase();
+    LinkMotionKitManager::autoDetectKits();
+    QTRY_VERIFY_WITH_TIMEOUT(!LinkMotionKitManager::isDetecting(), REGISTRY_TIMEOUT);
+    finishPhase(QStringLiteral("kits.create"));
+
+    startPhase();
+    LinkMotionKitManager::autoDetectKits();
+    QTRY_VERIFY_WITH_TIMEOUT(!LinkMotionKitManager::isDetecting(), REGISTRY_TIMEOUT);
+    finishPhase(QStringLiteral("kits.unchanged"));
+}
+
+void LinkMotionBenchmark::benchmarkCreateToolChains()
+{
+    const QList<LinkMotionTargetTool::Target> targets = TargetRegistry::instance()->targets();
+
+    startPhase();
+    QList<ProjectExplorer::ToolChain *> toolChains
+            = LinkMotionToolChainFactory::createToolChainsForLMTargets(targets, QList<ProjectExplorer::ToolChain *>());
+    finishPhase(QStringLiteral("toolchains.create"));
+
+    qDeleteAll(toolChains);
+}
+
+void LinkMotionBenchmark::benchmarkDeviceRestore()
+{
+    const QList<LinkMotionTargetTool::Target> containers = TargetRegistry::instance()->deviceContainers();
+    if (containers.isEmpty())
+        QSKIP("No synthetic target matches the host architecture");
+
+    QList<QVariantMap> maps;
+    QList<QWeakPointer<ContainerDetection> > detections;
+    QList<QSharedPointer<QSignalSpy> > destroyedSpies;
+    {
+        QList<ContainerDevice::Ptr> templates;
+        foreach (const LinkMotionTargetTool::Target &t, containers) {
+            const Core::Id id = ContainerDevice::createIdForContainer(t.containerName);
+            templates.append(ContainerDevice::create(id, id));
+            maps.append(templates.last()->toMap());
+
+            const ContainerDetection::Ptr detection = ContainerDetection::forContainer(t.containerName);
+            detections.append(detection);
+            destroyedSpies.append(QSharedPointer<QSignalSpy>(new QSignalSpy(detection.data(), &QObject::destroyed)));
+        }
+    }
+
+    //detections only used by the templates are deleted later, wait for it so
+    //it does not fall into the restore phase. Registered devices keep theirs.
+    for (int i = 0; i < detections.size(); i++) {
+        if (!detections.at(i).isNull())
+            continue;
+        QSignalSpy *spy = destroyedSpies.at(i).data();
+        QVERIFY(spy->count() > 0 || spy->wait(DEVICE_TIMEOUT));
+    }
+
+    ContainerDeviceFactory factory;
+    QList<ProjectExplorer::IDevice::Ptr> restored;
+
+    startPhase();
+    foreach (const QVariantMap &map, maps)
+        restored.append(factory.restore(map));
+    finishPhase(QStringLiteral("devices.restore"));
+
+    QCOMPARE(restored.size(), maps.size());
+}
+
+void LinkMotionBenchmark::cleanupTestCase()
+{
+    QJsonObject result;
+    result.insert(QStringLiteral("targets"), TargetRegistry::instance()->targets().size());
+    result.insert(QStringLiteral("phases"), m_phases);
+
+    const QByteArray json = QJsonDocument(result).toJson();
+    const QString fileName = QString::fromLocal8Bit(qgetenv(ENV_BENCH_RESULT));
+    if (fileName.isEmpty()) {
+        qDebug().noquote()<<json;
+        return;
+    }
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning()<<"Unable to write the benchmark result to"<<fileName;
+        return;
+    }
+    file.write(json);
+    file.commit();
+}
+
+void LinkMotionBenchmark::startPhase()
+{
+    m_spawnsAtStart = spawnCount();
+    m_timer.restart();
+}
+
+void LinkMotionBenchmark::finishPhase(const QString &name, qint64 wallTime)
+{
+    if (wallTime < 0)
+        wallTime = m_timer.elapsed();
+
+    QJsonObject phase;
+    phase.insert(QStringLiteral("name"), name);
+    phase.insert(QStringLiteral("wall_ms"), wallTime);
+    phase.insert(QStringLiteral("spawns"), spawnCount() - m_spawnsAtStart);
+    phase.insert(QStringLiteral("peak_rss_kb"), peakRss());
+    m_phases.append(phase);
+
+    qDebug()<<"Benchmark"<<name<<wallTime<<"ms";
+}
+
+/*!
+ * \brief LinkMotionBenchmark::spawnCount
+ * The stubs append one line to the spawn log for every start
+ */
+int LinkMotionBenchmark::spawnCount()
+{
+    QFile log(QString::fromLocal8Bit(qgetenv(ENV_BENCH_SPAWN_LOG)));
+    if (!log.open(QIODevice::ReadOnly))
+        return 0;
+    return log.readAll().count('\n');
+}
+
+qint64 LinkMotionBenchmark::peakRss()
+{
+    QFile status(QStringLiteral("/proc/self/status"));
+    if (!status.open(QIODevice::ReadOnly))
+        return -1;
+
+    foreach (const QByteArray &line, status.readAll().split('\n')) {
+        if (line.startsWith("VmHWM:"))
+            return line.mid(6).trimmed().split(' ').first().toLongLong();
+    }
+    return -1;
+}
+
+} // namespace Internal
+} // namespace LmBase
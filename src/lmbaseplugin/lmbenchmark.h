@@ -0,0 +1,74 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#ifndef LMBASE_INTERNAL_LMBENCHMARK_H
+#define LMBASE_INTERNAL_LMBENCHMARK_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QJsonArray>
+
+namespace LmBase {
+namespace Internal {
+
+class LinkMotionBasePlugin;
+
+/*!
+ * \brief The LinkMotionBenchmark class
+ * Measures startup and kit autodetection, it is run with
+ * "qtcreator -test lmbaseplugin" against the stub lmsdk-target
+ * from tests/benchmark. Every phase records the wall time, the
+ * number of processes the stubs were started and the peak RSS.
+ *
+ * The results are written as JSON to the file in LMSDK_BENCH_RESULT,
+ * the spawns are counted from the log in LMSDK_BENCH_SPAWN_LOG.
+ */
+class LinkMotionBenchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LinkMotionBenchmark(LinkMotionBasePlugin *plugin);
+
+private slots:
+    void initTestCase ();
+    void benchmarkStartup ();
+    void benchmarkRegistryRefresh ();
+    void benchmarkAutoDetectKits ();
+    void benchmarkCreateToolChains ();
+    void benchmarkDeviceRestore ();
+    void cleanupTestCase ();
+
+private:
+    void startPhase ();
+    void finishPhase (const QString &name, qint64 wallTime = -1);
+
+    static int spawnCount ();
+    static qint64 peakRss ();
+
+private:
+    LinkMotionBasePlugin *m_plugin;
+    QElapsedTimer m_timer;
+    int m_spawnsAtStart = 0;
+    QJsonArray m_phases;
+};
+
+} // namespace Internal
+} // namespace LmBase
+
+#endif // LMBASE_INTERNAL_LMBENCHMARK_H
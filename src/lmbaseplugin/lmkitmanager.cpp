@@ -21,6 +21,9 @@
 #include <lmbaseplugin/lmbaseplugin_constants.h>
 #include <lmbaseplugin/lmqtversion.h>
 #include <lmbaseplugin/lmtargettool.h>
+#include <lmbaseplugin/lmtargetregistry.h>
+#include <lmbaseplugin/compilercache.h>
+#include <lmbaseplugin/debugindexcache.h>
 
 //#include "ubuntuclickdialog.h"
 #include "settings.h"
@@ -36,7 +39,11 @@
 #include <projectexplorer/toolchain.h>
 #include <projectexplorer/toolchainmanager.h>
 #include <projectexplorer/kitinformation.h>
+#include <projectexplorer/environmentkitinformation.h>
 #include <projectexplorer/devicesupport/devicemanager.h>
+#include <projectexplorer/session.h>
+#include <projectexplorer/project.h>
+#include <projectexplorer/target.h>
 #include <debugger/debuggeritemmanager.h>
 #include <debugger/debuggeritem.h>
 #include <debugger/debuggerkitinformation.h>
@@ -48,6 +55,8 @@
 #include <cmakeprojectmanager/cmakekitinformation.h>
 #include <cmakeprojectmanager/cmakeconfigitem.h>
 #include <qtsupport/qtversionmanager.h>
+#include <utils/algorithm.h>
+#include <utils/runextensions.h>
 
 #include <QMessageBox>
 #include <QRegularExpression>
@@ -57,6 +66,13 @@
 #include <QDebug>
 #include <QPair>
 #include <QInputDialog>
+#include <QThread>
+#include <QHash>
+#include <QSet>
+#include <QDataStream>
+#include <QCryptographicHash>
+#include <QSharedPointer>
+#include <QFutureWatcher>
 
 namespace LmBase {
 namespace Internal {
@@ -65,10 +81,98 @@ enum {
     debug = 0
 };
 
-static bool equalKits(ProjectExplorer::Kit *a, ProjectExplorer::Kit *b)
+/*!
+ * \brief The KitToolIndex class
+ * Hash based lookups for the debuggers, Qt versions and CMake tools used by
+ * the Link Motion kits. The index is built once per kit update and kept
+ * alive by Scope objects, items created while it is alive are added to it.
+ */
+class KitToolIndex
+{
+public:
+    class Scope
+    {
+    public:
+        Scope() : m_owned(current ? nullptr : new KitToolIndex) { if (m_owned) current = m_owned; }
+        ~Scope() { if (m_owned) { current = nullptr; delete m_owned; } }
+        KitToolIndex *operator-> () const { return current; }
+    private:
+        KitToolIndex *m_owned;
+    };
+
+    QHash<Utils::FileName, QVariant> debuggers;
+    QHash<QString, LinkMotionQtVersion *> qtVersions;
+    QHash<Utils::FileName, CMakeProjectManager::CMakeTool *> cmakeTools;
+
+private:
+    KitToolIndex()
+    {
+        foreach (const Debugger::DebuggerItem &debugger, Debugger::DebuggerItemManager::debuggers())
+            debuggers.insert(debugger.command(), debugger.id());
+
+        foreach (QtSupport::BaseQtVersion *qtVersion, QtSupport::QtVersionManager::versions()) {
+            if (qtVersion->type() == QLatin1String(Constants::LM_QTVERSION_TYPE))
+                qtVersions.insert(qtVersion->qmakeCommand().toFileInfo().absoluteFilePath(),
+                                  static_cast<LinkMotionQtVersion *>(qtVersion));
+        }
+
+        foreach (CMakeProjectManager::CMakeTool *cmake, CMakeProjectManager::CMakeToolManager::cmakeTools())
+            cmakeTools.insert(cmake->cmakeExecutable(), cmake);
+    }
+
+    static KitToolIndex *current;
+};
+
+KitToolIndex *KitToolIndex::current = nullptr;
+
+static QString kitContainerName(const ProjectExplorer::Kit *k)
+{
+    ProjectExplorer::ToolChain *tc = ProjectExplorer::ToolChainKitInformation::toolChain(k, ProjectExplorer::Constants::CXX_LANGUAGE_ID);
+    if (tc)
+        return tc->typeId() == Constants::LM_TARGET_TOOLCHAIN_ID
+                ? static_cast<LinkMotionToolChain *>(tc)->lmTarget().containerName
+                : QString(); //the user switched the kit to another toolchain
+
+    //the toolchain of a removed target is already gone
+    return k->value(Core::Id(Constants::LM_KIT_CONTAINER_NAME)).toString();
+}
+
+static LinkMotionToolChain *kitToolChain(const ProjectExplorer::Kit *k)
+{
+    ProjectExplorer::ToolChain *tc = ProjectExplorer::ToolChainKitInformation::toolChain(k, ProjectExplorer::Constants::CXX_LANGUAGE_ID);
+    if (!tc || tc->typeId() != Constants::LM_TARGET_TOOLCHAIN_ID)
+        return nullptr;
+    return static_cast<LinkMotionToolChain *>(tc);
+}
+
+/*!
+ * \brief targetStamp
+ * Fingerprint of everything fixKit derives from the target, kits
+ * carrying the current stamp do not need to be fixed again
+ */
+static QByteArray targetStamp(const QString &containerName)
+{
+    const TargetRegistry::TargetInfo info = TargetRegistry::instance()->targetInfo(containerName);
+    const Settings::CompilerCacheSettings cache = Settings::compilerCacheSettings();
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out << info.target.containerName << info.target.architecture
+        << info.target.distribution << info.target.version
+        << info.rootfs << info.rootfsStamp
+        << qint32(info.cpuLimit) << info.hasNinja << info.hasCMake
+        << cache.enabled << qint32(cache.maxSizeGb)
+        << qint32(QThread::idealThreadCount());
+    return QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex();
+}
+
+static bool isKitComplete(const ProjectExplorer::Kit *k, const QString &containerName)
 {
-    return ProjectExplorer::ToolChainKitInformation::toolChain(a, ProjectExplorer::Constants::CXX_LANGUAGE_ID)
-            == ProjectExplorer::ToolChainKitInformation::ToolChainKitInformation::toolChain(b, ProjectExplorer::Constants::CXX_LANGUAGE_ID);
+    //targets without cmake only support qmake projects
+    return QtSupport::QtKitInformation::qtVersion(k)
+            && (!TargetRegistry::instance()->hasCMake(containerName)
+                || CMakeProjectManager::CMakeKitInformation::cmakeTool(k))
+            && Debugger::DebuggerKitInformation::debugger(k);
 }
 
 static Core::Id requiredDeviceType (LinkMotionToolChain *tc)
@@ -101,46 +205,174 @@ static void createOrFindDeviceAndType(ProjectExplorer::Kit *k, LinkMotionToolCha
         ProjectExplorer::DeviceTypeKitInformation::setDeviceTypeId(k,devTypeId);
     }
 }
-LinkMotionKitManager::LinkMotionKitManager()
+
+static QSet<QString> containerNames(const QList<LinkMotionTargetTool::Target> &targets)
 {
+    QSet<QString> names;
+    foreach (const LinkMotionTargetTool::Target &t, targets)
+        names.insert(t.containerName);
+    return names;
 }
 
-QList<LinkMotionToolChainSet> LinkMotionKitManager::linkMotionToolChains()
+/*!
+ * \brief registerToolChains
+ * Registers the toolchains created by the probes and removes all
+ * toolchains of targets that do not exist anymore
+ */
+static void registerToolChains(const QList<LinkMotionTargetTool::Target> &targets,
+                               const QList<ProjectExplorer::ToolChain *> &probed)
 {
-    QList<LinkMotionToolChainSet> allToolchains;
+    QList<ProjectExplorer::ToolChain *> known = ProjectExplorer::ToolChainManager::toolChains([](const ProjectExplorer::ToolChain *tc){
+        return tc->isAutoDetected() && tc->typeId() == Constants::LM_TARGET_TOOLCHAIN_ID;
+    });
+
+    const QSet<QString> names = containerNames(targets);
+    QSet<QPair<QString, Core::Id> > registered;
+    foreach (ProjectExplorer::ToolChain *tc, known) {
+        LinkMotionToolChain *lmTc = static_cast<LinkMotionToolChain *>(tc);
+        if (!names.contains(lmTc->lmTarget().containerName))
+            ProjectExplorer::ToolChainManager::deregisterToolChain(tc);
+        else
+            registered.insert(qMakePair(lmTc->lmTarget().containerName, tc->language()));
+    }
+
+    foreach (ProjectExplorer::ToolChain *tc, probed) {
+        LinkMotionToolChain *lmTc = static_cast<LinkMotionToolChain *>(tc);
+        const QPair<QString, Core::Id> key(lmTc->lmTarget().containerName, tc->language());
 
-    QList<ProjectExplorer::ToolChain *> cxxChains = ProjectExplorer::ToolChainManager::toolChains([](const ProjectExplorer::ToolChain *tc){
-        if(tc) {
-            if (!tc->isAutoDetected())
-                return false;
-            if (tc->typeId() != Constants::LM_TARGET_TOOLCHAIN_ID)
-                return false;
-            if (tc->language() != ProjectExplorer::Constants::C_LANGUAGE_ID)
-            return true;
+        //the target vanished or got a toolchain while it was probed
+        if (!names.contains(key.first) || registered.contains(key)
+                || !ProjectExplorer::ToolChainManager::registerToolChain(tc)) {
+            delete tc;
+            continue;
         }
-        return false;
-    });
+        registered.insert(key);
+    }
+}
 
-    for(ProjectExplorer::ToolChain *cxxTc : cxxChains) {
+/*!
+ * \brief The TargetProbe struct
+ * Result of probing one target in the worker pool. The toolchains
+ * are created there, but only registered on the GUI thread.
+ */
+struct TargetProbe
+{
+    LinkMotionTargetTool::Target target;
+    QList<ProjectExplorer::ToolChain *> toolChains;
+};
 
-        LinkMotionToolChain *lmCxxTc = static_cast<LinkMotionToolChain *>(cxxTc);
+/*!
+ * \brief probeTarget
+ * Runs in the worker pool, does everything for \a target that needs to
+ * enter the container or touches the rootfs: the tool wrappers, the
+ * toolchains including their compiler probes and the qmake query
+ */
+static TargetProbe probeTarget(const LinkMotionTargetTool::Target &target, bool createToolChains)
+{
+    TargetProbe probe;
+    probe.target = target;
 
-        ProjectExplorer::ToolChain *cTc = ProjectExplorer::ToolChainManager::toolChain([&](const ProjectExplorer::ToolChain *tc){
-            if (!tc->isAutoDetected() ||
-                tc->typeId() != Constants::LM_TARGET_TOOLCHAIN_ID ||
-                tc->language() != ProjectExplorer::Constants::C_LANGUAGE_ID)
-                return false;
-            const LinkMotionToolChain *lmCTc =  static_cast<const LinkMotionToolChain *>(tc);
-            if (lmCxxTc->lmTarget().containerName != lmCTc->lmTarget().containerName)
-                return false;
-            return true;
-        });
+    LinkMotionTargetTool::provisionToolWrappers(target);
+
+    if (createToolChains) {
+        probe.toolChains = LinkMotionToolChainFactory::createToolChainsForLMTargets(
+                    QList<LinkMotionTargetTool::Target>() << target,
+                    QList<ProjectExplorer::ToolChain *>());
+    }
+
+    const QString qmake = LinkMotionTargetTool::findOrCreateQMakeWrapper(target);
+    if (!qmake.isEmpty())
+        LinkMotionQtVersion::prefetchQuery(target.containerName, Utils::FileName::fromString(qmake));
+
+    return probe;
+}
+
+/*!
+ * \brief useKit
+ * Materializes \a k for a project target and lets the debug
+ * info of its target be indexed in the background
+ */
+static void useKit(ProjectExplorer::Kit *k)
+{
+    LinkMotionKitManager::materializeKit(k);
+
+    const QString container = kitContainerName(k);
+    if (!container.isEmpty() && TargetRegistry::instance()->isAvailable(container))
+        DebugIndexCache::instance()->prepare(container);
+}
+
+/*!
+ * \brief materializeProjectKits
+ * Materializes the kits of all targets of \a project. A project without
+ * targets shows the kit selection, only the kit it preselects and kits it
+ * would hide for not having a Qt version yet are materialized then. All
+ * other kits are materialized once the page adds a target for them.
+ */
+static void materializeProjectKits(ProjectExplorer::Project *project)
+{
+    if (project->targets().isEmpty()) {
+        ProjectExplorer::Kit *defaultKit = ProjectExplorer::KitManager::defaultKit();
+        foreach (ProjectExplorer::Kit *k, ProjectExplorer::KitManager::kits()) {
+            if (k == defaultKit || !QtSupport::QtKitInformation::qtVersion(k))
+                LinkMotionKitManager::materializeKit(k);
+        }
+        return;
+    }
+
+    foreach (ProjectExplorer::Target *t, project->targets())
+        useKit(t->kit());
+}
+
+static bool detectionRunning = false;
+static bool detectionPending = false;
+
+/*!
+ * \brief removeStaleDevices
+ * Removes all container devices that have no container anymore
+ */
+static void removeStaleDevices(const QList<LinkMotionTargetTool::Target> &targets)
+{
+    const QSet<QString> names = containerNames(targets);
+    ProjectExplorer::DeviceManager *devMgr = ProjectExplorer::DeviceManager::instance();
+    for (int i = devMgr->deviceCount() - 1; i >= 0; --i) {
+        ProjectExplorer::IDevice::ConstPtr dev = devMgr->deviceAt(i);
+        if (!dev->type().toString().startsWith(QLatin1String(Constants::LM_CONTAINER_DEVICE_TYPE_ID)))
+            continue;
+
+        QString containerName = dev->id().suffixAfter(Constants::LM_CONTAINER_DEVICE_TYPE_ID);
+        if (!names.contains(containerName))
+            devMgr->removeDevice(dev->id());
+    }
+}
+
+LinkMotionKitManager::LinkMotionKitManager()
+{
+}
+
+QList<LinkMotionToolChainSet> LinkMotionKitManager::linkMotionToolChains()
+{
+    QList<LinkMotionToolChainSet> allToolchains;
+
+    QList<LinkMotionToolChain *> cxxChains;
+    QHash<QString, LinkMotionToolChain *> cChains;
+    foreach (ProjectExplorer::ToolChain *tc, ProjectExplorer::ToolChainManager::toolChains()) {
+        if (!tc->isAutoDetected() || tc->typeId() != Constants::LM_TARGET_TOOLCHAIN_ID)
+            continue;
+
+        LinkMotionToolChain *lmTc = static_cast<LinkMotionToolChain *>(tc);
+        if (tc->language() == ProjectExplorer::Constants::C_LANGUAGE_ID)
+            cChains.insert(lmTc->lmTarget().containerName, lmTc);
+        else
+            cxxChains.append(lmTc);
+    }
 
+    for (LinkMotionToolChain *lmCxxTc : cxxChains) {
+        LinkMotionToolChain *cTc = cChains.value(lmCxxTc->lmTarget().containerName);
         if (!cTc)
             continue;
 
         LinkMotionToolChainSet set;
-        set.cLangToolchain = static_cast<LinkMotionToolChain *>(cTc);
+        set.cLangToolchain = cTc;
         set.cxxLangToolchain = lmCxxTc;
         allToolchains << set;
     }
@@ -168,21 +400,18 @@ QList<ProjectExplorer::Kit *> LinkMotionKitManager::findKitsUsingTarget (const L
 LinkMotionQtVersion *LinkMotionKitManager::createOrFindQtVersion(LinkMotionToolChain *tc)
 {
     QString qmakePath = LinkMotionTargetTool::findOrCreateQMakeWrapper(tc->lmTarget());
-    if(!QFile::exists(qmakePath)) {
+    if(!QFile::exists(qmakePath))
         return 0;
-    } else {
-        //try to find a already existing Qt Version for this target
-        foreach (QtSupport::BaseQtVersion *qtVersion, QtSupport::QtVersionManager::versions()) {
-            if (qtVersion->type() != QLatin1String(Constants::LM_QTVERSION_TYPE))
-                continue;
 
-            if (qtVersion->qmakeCommand().toFileInfo().absoluteFilePath() == QFileInfo(qmakePath).absoluteFilePath())
-                return static_cast<LinkMotionQtVersion*> (qtVersion);
-        }
-    }
+    //try to find a already existing Qt Version for this target
+    KitToolIndex::Scope index;
+    const QString key = QFileInfo(qmakePath).absoluteFilePath();
+    if (LinkMotionQtVersion *qtVersion = index->qtVersions.value(key))
+        return qtVersion;
 
     LinkMotionQtVersion *qtVersion = new LinkMotionQtVersion(tc->lmTarget().containerName, Utils::FileName::fromString(qmakePath),false);
     QtSupport::QtVersionManager::addVersion(qtVersion);
+    index->qtVersions.insert(key, qtVersion);
     return qtVersion;
 }
 
@@ -191,7 +420,8 @@ CMakeProjectManager::CMakeTool *LinkMotionKitManager::createOrFindCMakeTool(Link
     QString cmakePathStr = LinkMotionTargetTool::findOrCreateToolWrapper(QStringLiteral("cmake"), tc->lmTarget());
     Utils::FileName cmakePath = Utils::FileName::fromString(cmakePathStr);
 
-    CMakeProjectManager::CMakeTool *cmake = CMakeProjectManager::CMakeToolManager::findByCommand(cmakePath);
+    KitToolIndex::Scope index;
+    CMakeProjectManager::CMakeTool *cmake = index->cmakeTools.value(cmakePath);
     if (cmake)
         return cmake;
 
@@ -201,6 +431,7 @@ CMakeProjectManager::CMakeTool *LinkMotionKitManager::createOrFindCMakeTool(Link
         return 0;
     }
 
+    index->cmakeTools.insert(cmakePath, cmake);
     return cmake;
 }
 
@@ -361,87 +592,178 @@ void LinkMotionKitManager::autoCreateKit(UbuntuDevice::Ptr device)
 }
 #endif
 
+/*!
+ * \brief LinkMotionKitManager::autoDetectKits
+ * Updates toolchains, devices and kits from the TargetRegistry. If the
+ * registry was not loaded yet a refresh is requested, the kits are
+ * updated when the registry emits targetsChanged.
+ *
+ * All targets are probed concurrently in the worker pool, only the
+ * registration with the managers happens on the GUI thread once all
+ * probes are done. Calls while a detection is running are folded
+ * into one additional run.
+ */
 void LinkMotionKitManager::autoDetectKits()
 {
-    // having a empty toolchains list will remove all autodetected kits for link motion
-    // exactly what we want in that case
-    QList<LinkMotionToolChainSet> toolchains = linkMotionToolChains();
+    TargetRegistry *registry = TargetRegistry::instance();
+    if (!registry->isLoaded()) {
+        registry->refresh();
+        return;
+    }
+
+    if (detectionRunning) {
+        detectionPending = true;
+        return;
+    }
+
+    const QList<LinkMotionTargetTool::Target> targets = registry->targets();
+    LinkMotionTargetTool::forgetToolWrappers(targets);
+
+    //targets that already have their toolchains do not need new ones
+    QSet<QString> withToolChains;
+    foreach (const LinkMotionToolChainSet &tcSet, linkMotionToolChains())
+        withToolChains.insert(tcSet.cxxLangToolchain->lmTarget().containerName);
+
+    detectionRunning = true;
+
+    QSharedPointer<QList<TargetProbe> > probes(new QList<TargetProbe>);
+    QSharedPointer<int> outstanding(new int(targets.size()));
+
+    auto finish = [targets, probes]() {
+        QList<ProjectExplorer::ToolChain *> toolChains;
+        foreach (const TargetProbe &probe, *probes)
+            toolChains.append(probe.toolChains);
+
+        updateKits(targets, toolChains);
+        detectionRunning = false;
+
+        if (detectionPending) {
+            detectionPending = false;
+            autoDetectKits();
+        }
+    };
+
+    if (targets.isEmpty()) {
+        finish();
+        return;
+    }
+
+    //the watchers die with the KitManager, so no probe is handled after shutdown.
+    //Cancelled or failed probes still count as done, otherwise the detection never ends
+    foreach (const LinkMotionTargetTool::Target &target, targets) {
+        const bool createToolChains = !withToolChains.contains(target.containerName);
+
+        QFutureWatcher<TargetProbe> *watcher = new QFutureWatcher<TargetProbe>(ProjectExplorer::KitManager::instance());
+        connect(watcher, &QFutureWatcher<TargetProbe>::finished, watcher, [watcher, probes, outstanding, finish]() {
+            const QFuture<TargetProbe> future = watcher->future();
+            if (!future.isCanceled() && future.resultCount() > 0)
+                probes->append(future.result());
+            watcher->deleteLater();
+
+            if (--(*outstanding) == 0)
+                finish();
+        });
+        watcher->setFuture(Utils::runAsync(LinkMotionTargetTool::workerPool(), &probeTarget, target, createToolChains));
+    }
+}
+
+/*!
+ * \brief LinkMotionKitManager::isDetecting
+ * Returns true while targets are probed in the background
+ */
+bool LinkMotionKitManager::isDetecting()
+{
+    return detectionRunning;
+}
+
+void LinkMotionKitManager::updateKits(const QList<LinkMotionTargetTool::Target> &targets,
+                                      const QList<ProjectExplorer::ToolChain *> &probedToolChains)
+{
+    registerToolChains(targets, probedToolChains);
+    removeStaleDevices(targets);
+
+    //all lookups of debuggers, Qt versions and CMake tools below use the same index
+    KitToolIndex::Scope index;
 
-    QList<ProjectExplorer::Kit *> existingKits;
+    QHash<QString, LinkMotionToolChainSet> wanted;
+    foreach (const LinkMotionToolChainSet &tcSet, linkMotionToolChains())
+        wanted.insert(tcSet.cxxLangToolchain->lmTarget().containerName, tcSet);
+
+    QHash<QString, QList<ProjectExplorer::Kit *> > existing;
     foreach (ProjectExplorer::Kit *k, ProjectExplorer::KitManager::kits()) {
         if (k->isSdkProvided())
             continue;
 
-        ProjectExplorer::ToolChain *tc = ProjectExplorer::ToolChainKitInformation::toolChain(k, ProjectExplorer::Constants::CXX_LANGUAGE_ID);
-        if (tc && tc->typeId() != Constants::LM_TARGET_TOOLCHAIN_ID)
+        const QString container = kitContainerName(k);
+        if (!container.isEmpty())
+            existing[container].append(k);
+    }
+
+    //kits of removed targets
+    for (auto it = existing.constBegin(); it != existing.constEnd(); ++it) {
+        if (wanted.contains(it.key()))
             continue;
 
-        //@TODO check for ubuntu device information
-        if(debug) qDebug()<<"Found possible Ubuntu Kit: "<<k->displayName();
-        existingKits << k;
-    }
-
-    // create new kits
-    QList<ProjectExplorer::Kit *> newKits;
-    foreach (LinkMotionToolChainSet tcSet, toolchains) {
-        ProjectExplorer::Kit* newKit = createKit(tcSet);
-        newKit->makeSticky();
-        newKits << newKit;
-    }
-
-    //remove already existing kits
-    for (int i = existingKits.count() - 1; i >= 0; --i) {
-        ProjectExplorer::Kit *existingKit = existingKits.at(i);
-        for (int j = 0; j < newKits.count(); ++j) {
-            ProjectExplorer::Kit *newKit = newKits.at(j);
-            if (equalKits(existingKit, newKit)) {
-                // Kit is already registered, nothing to do
-                ProjectExplorer::Kit *oldKit = existingKits.takeAt(i);
-                oldKit->blockNotification();
-                oldKit->makeSticky();
-
-                //make sure kit has all required informations
-                fixKit(oldKit);
-                oldKit->unblockNotification();
-
-                newKits.removeAt(j);
-                ProjectExplorer::KitManager::deleteKit(newKit);
-                j = newKits.count();
-            }
-        }
+        if(debug) qDebug()<<"Removing kits of"<<it.key();
+        foreach (ProjectExplorer::Kit *k, it.value())
+            ProjectExplorer::KitManager::deregisterKit(k);
     }
 
-    //all kits remaining need to be removed if they don't have all informations
-    foreach (ProjectExplorer::Kit *k, existingKits) {
-        ProjectExplorer::ToolChain *tc = ProjectExplorer::ToolChainKitInformation::toolChain(k, ProjectExplorer::Constants::CXX_LANGUAGE_ID);
-        CMakeProjectManager::CMakeTool* cmake = CMakeProjectManager::CMakeKitInformation::cmakeTool(k);
-        if (tc && tc->typeId() == Constants::LM_TARGET_TOOLCHAIN_ID
-                && cmake
-                && cmake->isValid()) {
-            fixKit(k);
-
-            //existing targets are not autodetected anymore
-            k->makeUnSticky();
-            k->setAutoDetected(false);
-        } else {
-            //has not all informations, go away
-            ProjectExplorer::KitManager::deregisterKit(k);
+    for (auto it = wanted.constBegin(); it != wanted.constEnd(); ++it) {
+        const QByteArray stamp = targetStamp(it.key());
+        const QList<ProjectExplorer::Kit *> kits = existing.value(it.key());
+
+        //new kits are placeholders until they are used by a project
+        if (kits.isEmpty()) {
+            if(debug) qDebug()<<"Creating kit for"<<it.key();
+            ProjectExplorer::Kit *kit = createKit(it.value());
+            kit->makeSticky();
+            kit->setUnexpandedDisplayName(tr("Link Motion SDK for %1 (GCC %2)")
+                                          .arg(it.key())
+                                          .arg(it.value().cxxLangToolchain->lmTarget().architecture));
+            ProjectExplorer::KitManager::registerKit(kit);
+            preparePlaceholder(kit);
+            kit->setValue(Core::Id(Constants::LM_KIT_TARGET_STAMP), stamp);
+            continue;
         }
-    }
 
-    foreach (ProjectExplorer::Kit *kit, newKits) {
-        LinkMotionToolChain *tc = static_cast<LinkMotionToolChain *>(ProjectExplorer::ToolChainKitInformation::toolChain(kit, ProjectExplorer::Constants::CXX_LANGUAGE_ID));
-        kit->setUnexpandedDisplayName(tr("Link Motion SDK for %1 (GCC %2)")
-                                      .arg(tc->lmTarget().containerName)
-                                      .arg(tc->lmTarget().architecture));
-        ProjectExplorer::KitManager::registerKit(kit);
-        fixKit(kit);
+        for (int i = 0; i < kits.size(); i++) {
+            ProjectExplorer::Kit *k = kits.at(i);
+            if (k->value(Core::Id(Constants::LM_KIT_TARGET_STAMP)).toByteArray() == stamp
+                    && (!isMaterialized(k) || isKitComplete(k, it.key())))
+                continue;
+
+            if(debug) qDebug()<<"Updating kit"<<k->displayName();
+            k->blockNotification();
+
+            //the first kit is the one we created, copies are owned by the user
+            if (i == 0)
+                k->makeSticky();
+            else
+                k->makeUnSticky();
+
+            //the target was recreated, the kit lost its toolchains
+            if (!ProjectExplorer::ToolChainKitInformation::toolChain(k, ProjectExplorer::Constants::CXX_LANGUAGE_ID)) {
+                ProjectExplorer::ToolChainKitInformation::setToolChain(k, it.value().cLangToolchain);
+                ProjectExplorer::ToolChainKitInformation::setToolChain(k, it.value().cxxLangToolchain);
+            }
+
+            //the kit is materialized again the next time it is used
+            preparePlaceholder(k);
+            k->setValue(Core::Id(Constants::LM_KIT_TARGET_STAMP), stamp);
+            k->unblockNotification();
+        }
     }
 
+    //kits of open projects can not wait until they are selected again
+    foreach (ProjectExplorer::Project *project, ProjectExplorer::SessionManager::projects())
+        materializeProjectKits(project);
+
     static bool cmakeUpdaterSet = false;
     if (!cmakeUpdaterSet) {
 
         cmakeUpdaterSet = true;
+        watchProjects();
 
         auto cmakeUpdater = [](const Core::Id &id){
             CMakeProjectManager::CMakeTool *tool = CMakeProjectManager::CMakeToolManager::findById(id);
@@ -467,57 +789,74 @@ void LinkMotionKitManager::autoDetectKits()
 
 /*!
  * \brief LinkMotionKitManager::createKit
- * Creates a new Kit for the LM toolchain and sets default
- * values
+ * Creates a new Kit for the LM toolchain and sets the values that
+ * are known from the TargetRegistry. Qt version, debugger and CMake
+ * are resolved when the kit is materialized.
  */
 ProjectExplorer::Kit *LinkMotionKitManager::createKit(LinkMotionToolChainSet tcSet)
 {
-    //@TODO find a qt version
     ProjectExplorer::Kit* newKit = new ProjectExplorer::Kit;
     newKit->setAutoDetected(false); //let the user delete that stuff
     //newKit->setIconPath(Utils::FileName::fromString(QLatin1String(Constants::LM_ICON)));
     ProjectExplorer::ToolChainKitInformation::setToolChain(newKit, tcSet.cLangToolchain);
     ProjectExplorer::ToolChainKitInformation::setToolChain(newKit, tcSet.cxxLangToolchain);
 
-    CMakeProjectManager::CMakeTool *cmake = createOrFindCMakeTool(tcSet.cxxLangToolchain);
-    if (cmake) {
-        cmake->setPathMapperFactory(&LinkMotionTargetTool::mapIncludePathsForCMakeFactory);
-        CMakeProjectManager::CMakeKitInformation::setCMakeTool(newKit, cmake->id());
-    }
-
     ProjectExplorer::SysRootKitInformation::setSysRoot(newKit,Utils::FileName::fromString(LinkMotionTargetTool::targetBasePath(tcSet.cxxLangToolchain->lmTarget())));
 
     createOrFindDeviceAndType(newKit, tcSet.cxxLangToolchain);
-
-    //@TODO add gdbserver support
-    QtSupport::QtKitInformation::setQtVersion(newKit, createOrFindQtVersion(tcSet.cxxLangToolchain));
     return newKit;
 }
 
+/*!
+ * \brief LinkMotionKitManager::isMaterialized
+ * Returns true if Qt version, debugger and CMake of \a k were resolved
+ */
+bool LinkMotionKitManager::isMaterialized(const ProjectExplorer::Kit *k)
+{
+    return k->value(Core::Id(Constants::LM_KIT_MATERIALIZED), false).toBool();
+}
+
+/*!
+ * \brief LinkMotionKitManager::materializeKit
+ * Resolves the expensive parts of the placeholder kit \a k, it is
+ * called the first time the kit is used by a project
+ */
+void LinkMotionKitManager::materializeKit(ProjectExplorer::Kit *k)
+{
+    if (!k || isMaterialized(k))
+        return;
+
+    const QString container = kitContainerName(k);
+    if (container.isEmpty() || !TargetRegistry::instance()->isAvailable(container))
+        return;
+
+    if(debug) qDebug()<<"Materializing kit"<<k->displayName();
 
+    k->blockNotification();
+    fixKit(k);
+    k->setValue(Core::Id(Constants::LM_KIT_TARGET_STAMP), targetStamp(container));
+    k->unblockNotification();
+}
 
 /*!
  * \brief LinkMotionKitManager::createOrFindDebugger
  * Tries to find a already existing ubuntu debugger, if it can not find one
  * it is registered and returned
  */
-QVariant LinkMotionKitManager::createOrFindDebugger(const Utils::FileName &path)
+QVariant LinkMotionKitManager::createOrFindDebugger(const Utils::FileName &path, const QString &displayName)
 {
     if(path.isEmpty())
         return QVariant();
 
-    QList<Debugger::DebuggerItem> debuggers = Debugger::DebuggerItemManager::debuggers();
-    foreach(const Debugger::DebuggerItem& debugger,debuggers) {
-        if(debugger.command() == path) {
-            return debugger.id();
-        }
-    }
-
+    KitToolIndex::Scope index;
+    QVariant knownId = index->debuggers.value(path);
+    if (knownId.isValid())
+        return knownId;
 
     Debugger::DebuggerItem debugger;
     debugger.setCommand(path);
     debugger.setEngineType(Debugger::GdbEngineType);
-    debugger.setUnexpandedDisplayName(tr("Link Motion SDK Debugger"));
+    debugger.setUnexpandedDisplayName(displayName.isEmpty() ? tr("Link Motion SDK Debugger") : displayName);
     debugger.setAutoDetected(true);
     //multiarch debugger
     ProjectExplorer::Abi abi(ProjectExplorer::Abi::UnknownArchitecture
@@ -526,7 +865,10 @@ QVariant LinkMotionKitManager::createOrFindDebugger(const Utils::FileName &path)
                              ,ProjectExplorer::Abi::UnknownFormat
                              ,0);
     debugger.setAbi(abi);
-    return Debugger::DebuggerItemManager::registerDebugger(debugger);
+
+    QVariant id = Debugger::DebuggerItemManager::registerDebugger(debugger);
+    index->debuggers.insert(path, id);
+    return id;
 }
 
 /*!
@@ -535,15 +877,17 @@ QVariant LinkMotionKitManager::createOrFindDebugger(const Utils::FileName &path)
  */
 void LinkMotionKitManager::fixKit(ProjectExplorer::Kit *k)
 {
-    k->setAutoDetected(false);
+    preparePlaceholder(k);
 
-    LinkMotionToolChain* tc = static_cast<LinkMotionToolChain *> (ProjectExplorer::ToolChainKitInformation::toolChain(k,  ProjectExplorer::Constants::CXX_LANGUAGE_ID));
+    LinkMotionToolChain* tc = kitToolChain(k);
     if(!tc) {
         return;
     }
 
     //make sure we have the multiarch debugger
-    QVariant dId = createOrFindDebugger(tc->suggestedDebugger());
+    //every target has its own debugger wrapper, using the gdb index cache of the target
+    QVariant dId = createOrFindDebugger(tc->suggestedDebugger(),
+                                        tr("Link Motion SDK Debugger (%1)").arg(tc->lmTarget().containerName));
     const Debugger::DebuggerItem *debugger = Debugger::DebuggerKitInformation::debugger(k);
     if(!debugger) {
         if(dId.isValid())
@@ -553,6 +897,51 @@ void LinkMotionKitManager::fixKit(ProjectExplorer::Kit *k)
             Debugger::DebuggerKitInformation::setDebugger(k,dId);
     }
 
+    k->setSticky(Debugger::DebuggerKitInformation::id(),false);
+
+    //make sure we use a ubuntu Qt version
+    LinkMotionQtVersion *qtVer = createOrFindQtVersion(tc);
+    QtSupport::QtKitInformation::setQtVersion(k, qtVer);
+
+    //make sure we use a link motion cmake, if the target has one
+    CMakeProjectManager::CMakeTool *cmake = TargetRegistry::instance()->hasCMake(tc->lmTarget().containerName)
+            ? createOrFindCMakeTool(tc)
+            : nullptr;
+    if(cmake) {
+        CMakeProjectManager::CMakeConfig  conf{
+            CMakeProjectManager::CMakeConfigItem("QT_QMAKE_EXECUTABLE",  qtVer->remoteQMakeCommand().toUtf8()),
+            CMakeProjectManager::CMakeConfigItem("CMAKE_CXX_COMPILER",  tc->remoteCompilerCommand().toUtf8()),
+            CMakeProjectManager::CMakeConfigItem("CMAKE_C_COMPILER",  tc->remoteCompilerCommand().toUtf8())
+        };
+
+        cmake->setPathMapperFactory(&LinkMotionTargetTool::mapIncludePathsForCMakeFactory);
+        CMakeProjectManager::CMakeKitInformation::setCMakeTool(k, cmake->id());
+        CMakeProjectManager::CMakeConfigurationKitInformation::setConfiguration(k , conf);
+    }
+
+    applyBuildDefaults(k, tc);
+    applyCompilerCache(k, tc);
+
+    k->setValue(Core::Id(Constants::LM_KIT_MATERIALIZED), true);
+}
+
+/*!
+ * \brief LinkMotionKitManager::preparePlaceholder
+ * Sets everything in \a k that is cheap to find out, the values only
+ * depend on the TargetRegistry and do not require entering the target
+ */
+void LinkMotionKitManager::preparePlaceholder(ProjectExplorer::Kit *k)
+{
+    k->setAutoDetected(false);
+    k->setValue(Core::Id(Constants::LM_KIT_MATERIALIZED), false);
+
+    LinkMotionToolChain* tc = kitToolChain(k);
+    if(!tc) {
+        return;
+    }
+
+    k->setValue(Core::Id(Constants::LM_KIT_CONTAINER_NAME), tc->lmTarget().containerName);
+
     if(ProjectExplorer::SysRootKitInformation::sysRoot(k).isEmpty()) {
         ProjectExplorer::SysRootKitInformation::setSysRoot(k,Utils::FileName::fromString(LinkMotionTargetTool::targetBasePath(tc->lmTarget())));
     }
@@ -568,30 +957,145 @@ void LinkMotionKitManager::fixKit(ProjectExplorer::Kit *k)
 
     //values the user can change
     k->setSticky(ProjectExplorer::DeviceKitInformation::id(),false);
-    k->setSticky(Debugger::DebuggerKitInformation::id(),false);
 
     //values the user cannot change
     k->setSticky(ProjectExplorer::SysRootKitInformation::id(),true);
     k->setMutable(ProjectExplorer::SysRootKitInformation::id(),false);
+}
 
-    //make sure we use a ubuntu Qt version
-    LinkMotionQtVersion *qtVer = createOrFindQtVersion(tc);
-    QtSupport::QtKitInformation::setQtVersion(k, qtVer);
+/*!
+ * \brief LinkMotionKitManager::watchProjects
+ * Materializes kits as soon as a project starts using them
+ */
+void LinkMotionKitManager::watchProjects()
+{
+    auto watchProject = [](ProjectExplorer::Project *project) {
+        connect(project, &ProjectExplorer::Project::addedTarget, [](ProjectExplorer::Target *t) {
+            useKit(t->kit());
+        });
+        materializeProjectKits(project);
+    };
 
-    //make sure we use a link motion cmake
-    CMakeProjectManager::CMakeTool *cmake = createOrFindCMakeTool(tc);
-    if(cmake) {
-        CMakeProjectManager::CMakeConfig  conf{
-            CMakeProjectManager::CMakeConfigItem("QT_QMAKE_EXECUTABLE",  qtVer->remoteQMakeCommand().toUtf8()),
-            CMakeProjectManager::CMakeConfigItem("CMAKE_CXX_COMPILER",  tc->remoteCompilerCommand().toUtf8()),
-            CMakeProjectManager::CMakeConfigItem("CMAKE_C_COMPILER",  tc->remoteCompilerCommand().toUtf8())
-        };
+    connect(ProjectExplorer::SessionManager::instance(), &ProjectExplorer::SessionManager::projectAdded,
+            watchProject);
+    foreach (ProjectExplorer::Project *project, ProjectExplorer::SessionManager::projects())
+        watchProject(project);
+}
 
-        cmake->setPathMapperFactory(&LinkMotionTargetTool::mapIncludePathsForCMakeFactory);
-        CMakeProjectManager::CMakeKitInformation::setCMakeTool(k, cmake->id());
-        CMakeProjectManager::CMakeConfigurationKitInformation::setConfiguration(k , conf);
+/*!
+ * \brief LinkMotionKitManager::applyBuildDefaults
+ * Makes CMake use Ninja if the target has it installed and sets the
+ * make job count to what the target can actually run in parallel.
+ * The environment is not forwarded into the target, the make wrapper
+ * passes LMSDK_MAKE_JOBS to the top level make as -j argument. Nested
+ * makes inherit the jobserver from it.
+ */
+void LinkMotionKitManager::applyBuildDefaults(ProjectExplorer::Kit *k, LinkMotionToolChain *tc)
+{
+    const QString container = tc->lmTarget().containerName;
+    TargetRegistry *registry = TargetRegistry::instance();
+
+    //only change the generator once, so the user can switch back
+    const Core::Id generatorDefaulted(Constants::LM_KIT_GENERATOR_DEFAULTED);
+    if (!k->value(generatorDefaulted).toBool()
+            && CMakeProjectManager::CMakeKitInformation::cmakeTool(k)
+            && registry->hasNinja(container)) {
+        CMakeProjectManager::CMakeGeneratorKitInformation::setGenerator(k, QStringLiteral("Ninja"));
+        k->setValue(generatorDefaulted, true);
+    }
+
+    int jobs = QThread::idealThreadCount();
+    const int cpuLimit = registry->cpuLimit(container);
+    if (cpuLimit > 0)
+        jobs = qMin(jobs, cpuLimit);
+
+    const QString jobsVariable = QLatin1String(Constants::LM_MAKE_JOBS_VARIABLE);
+    const Core::Id defaultJobs(Constants::LM_KIT_DEFAULT_MAKE_JOBS);
+    const Utils::EnvironmentItem jobsItem(jobsVariable, QString::number(jobs));
+
+    //MAKEFLAGS set by earlier versions never reached the target
+    static const QRegularExpression oldDefaultFlags(QStringLiteral("^-j\\d+$"));
+    QList<Utils::EnvironmentItem> changes = Utils::filtered(ProjectExplorer::EnvironmentKitInformation::environmentChanges(k),
+                                                            [](const Utils::EnvironmentItem &item) {
+        return item.name != QStringLiteral("MAKEFLAGS") || !oldDefaultFlags.match(item.value).hasMatch();
+    });
+
+    auto it = std::find_if(changes.begin(), changes.end(), [&jobsVariable](const Utils::EnvironmentItem &item) {
+        return item.name == jobsVariable;
+    });
+
+    //never touch a job count the user has set
+    if (it == changes.end()) {
+        changes.append(jobsItem);
+        k->setValue(defaultJobs, jobsItem.value);
+    } else if (it->value == k->value(defaultJobs).toString()) {
+        *it = jobsItem;
+        k->setValue(defaultJobs, jobsItem.value);
+    }
+
+    if (changes != ProjectExplorer::EnvironmentKitInformation::environmentChanges(k))
+        ProjectExplorer::EnvironmentKitInformation::setEnvironmentChanges(k, changes);
+}
+
+/*!
+ * \brief LinkMotionKitManager::applyCompilerCache
+ * Replaces the compiler cache variables in the environment of \a k
+ * with the current settings
+ */
+void LinkMotionKitManager::applyCompilerCache(ProjectExplorer::Kit *k, LinkMotionToolChain *tc)
+{
+    TargetRegistry *registry = TargetRegistry::instance();
+    const bool useCache = registry
+            && CompilerCache::isInstalled(registry->rootfs(tc->lmTarget().containerName));
+
+    QList<Utils::EnvironmentItem> changes = Utils::filtered(ProjectExplorer::EnvironmentKitInformation::environmentChanges(k),
+                                                            [](const Utils::EnvironmentItem &item) {
+        return !CompilerCache::isCacheVariable(item.name);
+    });
+
+    //the build itself runs inside the target and calls the compilers directly,
+    //the qmake wrapper prefixes them with ccache and the cache directory
+    //taken from these variables if LMSDK_CCACHE is set
+    const QList<Utils::EnvironmentItem> cacheChanges = useCache
+            ? CompilerCache::environmentChanges(tc->lmTarget().architecture)
+            : QList<Utils::EnvironmentItem>();
+    changes.append(cacheChanges);
+
+    if (changes != ProjectExplorer::EnvironmentKitInformation::environmentChanges(k))
+        ProjectExplorer::EnvironmentKitInformation::setEnvironmentChanges(k, changes);
+
+    //cmake has to be told to use ccache as compiler launcher
+    if (!CMakeProjectManager::CMakeKitInformation::cmakeTool(k))
+        return;
+
+    const QByteArray launchers[] = { "CMAKE_C_COMPILER_LAUNCHER", "CMAKE_CXX_COMPILER_LAUNCHER" };
+    CMakeProjectManager::CMakeConfig conf = Utils::filtered(CMakeProjectManager::CMakeConfigurationKitInformation::configuration(k),
+                                                            [&launchers](const CMakeProjectManager::CMakeConfigItem &item) {
+        return item.key != launchers[0] && item.key != launchers[1];
+    });
+
+    if (!cacheChanges.isEmpty()) {
+        const QByteArray command = CompilerCache::launcher(tc->lmTarget().architecture)
+                .join(QLatin1Char(';')).toUtf8();
+        for (const QByteArray &launcher : launchers)
+            conf.append(CMakeProjectManager::CMakeConfigItem(launcher, command));
     }
 
+    CMakeProjectManager::CMakeConfigurationKitInformation::setConfiguration(k, conf);
+}
+
+/*!
+ * \brief LinkMotionKitManager::updateCompilerCacheSettings
+ * Applies changed compiler cache settings to all Link Motion kits
+ */
+void LinkMotionKitManager::updateCompilerCacheSettings()
+{
+    foreach (ProjectExplorer::Kit *k, ProjectExplorer::KitManager::kits()) {
+        ProjectExplorer::ToolChain *tc = ProjectExplorer::ToolChainKitInformation::toolChain(k, ProjectExplorer::Constants::CXX_LANGUAGE_ID);
+        if (!tc || tc->typeId() != Constants::LM_TARGET_TOOLCHAIN_ID)
+            continue;
+        applyCompilerCache(k, static_cast<LinkMotionToolChain *>(tc));
+    }
 }
 
 } // namespace Internal
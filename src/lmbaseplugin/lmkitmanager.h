@@ -44,15 +44,27 @@ public:
 
     //static void autoCreateKit  ( UbuntuDevice::Ptr device );
     static void autoDetectKits ();
+    static bool isDetecting ();
     static ProjectExplorer::Kit *createKit (LinkMotionToolChainSet tcSet);
-    static QVariant createOrFindDebugger(const Utils::FileName &path);
+    static QVariant createOrFindDebugger(const Utils::FileName &path, const QString &displayName = QString());
     static void fixKit (ProjectExplorer::Kit* k);
+    static void materializeKit (ProjectExplorer::Kit *k);
+    static bool isMaterialized (const ProjectExplorer::Kit *k);
+    static void updateCompilerCacheSettings ();
     static QList<LinkMotionToolChainSet> linkMotionToolChains();
     static QList<ProjectExplorer::Kit *> findKitsUsingTarget (const LinkMotionTargetTool::Target &target);
     static LinkMotionQtVersion *createOrFindQtVersion(LinkMotionToolChain* tc);
     static CMakeProjectManager::CMakeTool *createOrFindCMakeTool(LinkMotionToolChain* tc);
     static CMakeProjectManager::CMakeTool *createCMakeTool(LinkMotionToolChain *tc);
     static CMakeProjectManager::CMakeTool *createCMakeTool(const LinkMotionTargetTool::Target &target);
+
+private:
+    static void updateKits (const QList<LinkMotionTargetTool::Target> &targets,
+                            const QList<ProjectExplorer::ToolChain *> &probedToolChains);
+    static void preparePlaceholder (ProjectExplorer::Kit *k);
+    static void watchProjects ();
+    static void applyBuildDefaults (ProjectExplorer::Kit *k, LinkMotionToolChain *tc);
+    static void applyCompilerCache (ProjectExplorer::Kit *k, LinkMotionToolChain *tc);
 };
 
 } // namespace Internal
@@ -20,21 +20,34 @@
 #include "lmqtversion.h"
 #include "lmbaseplugin_constants.h"
 #include "settings.h"
+#include "sysrootpathtranslator.h"
 
 #include <lmbaseplugin/lmtargettool.h>
+#include <lmbaseplugin/lmtargetregistry.h>
 #include <lmbaseplugin/lmbaseplugin.h>
 //#include <ubuntu/device/container/containerdevice.h>
 #include <qtsupport/qtsupportconstants.h>
+#include <qtsupport/qtversionmanager.h>
 
 #include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
 #include <QFileInfo>
+#include <QSaveFile>
 #include <QDebug>
 #include <QDir>
 
 namespace LmBase {
 namespace Internal {
 
-const char CONTAINER_NAME[] = "LinkMotion.QtVersion.ContainerName";
+enum {
+    debug = 0
+};
+
+const char CONTAINER_NAME[]    = "LinkMotion.QtVersion.ContainerName";
+const char QUERY_FINGERPRINT[] = "LinkMotion.QtVersion.QueryFingerprint";
+const char QUERY_RESULT[]      = "LinkMotion.QtVersion.QueryResult";
+const char QUERY_ABIS[]        = "LinkMotion.QtVersion.QtAbis";
 
 LinkMotionQtVersion::LinkMotionQtVersion()
     : BaseQtVersion()
@@ -54,12 +67,53 @@ void LinkMotionQtVersion::fromMap(const QVariantMap &map)
 {
     BaseQtVersion::fromMap(map);
     m_containerName = map.value(QLatin1String(CONTAINER_NAME),QString()).toString();
+
+    m_queryCache = QueryCache();
+
+    QHash<QString, QString> versionInfo;
+    const QVariantMap queryResult = map.value(QLatin1String(QUERY_RESULT)).toMap();
+    for (auto it = queryResult.constBegin(); it != queryResult.constEnd(); ++it)
+        versionInfo.insert(it.key(), it.value().toString());
+
+    //only trust the stored results if the target was not upgraded in the meantime
+    const QString fingerprint = map.value(QLatin1String(QUERY_FINGERPRINT)).toString();
+    if (!fingerprint.isEmpty() && fingerprint == queryFingerprint(m_containerName, remoteQMakeCommand(), versionInfo)) {
+        foreach (const QString &abiString, map.value(QLatin1String(QUERY_ABIS)).toStringList()) {
+            const ProjectExplorer::Abi abi = ProjectExplorer::Abi::fromString(abiString);
+            if (abi.isValid())
+                m_queryCache.abis.append(abi);
+        }
+
+        if (!m_queryCache.abis.isEmpty()) {
+            m_queryCache.fingerprint = fingerprint;
+            m_queryCache.versionInfo = versionInfo;
+        }
+    }
+
+    if (debug && m_queryCache.fingerprint.isEmpty())
+        qDebug()<<"Qt version of"<<m_containerName<<"needs to be queried again";
+
+    updateQueryCacheFile();
 }
 
 QVariantMap LinkMotionQtVersion::toMap() const
 {
     QVariantMap map = BaseQtVersion::toMap();
     map.insert(QLatin1String(CONTAINER_NAME), m_containerName);
+
+    if (!m_queryCache.fingerprint.isEmpty()) {
+        QVariantMap queryResult;
+        for (auto it = m_queryCache.versionInfo.constBegin(); it != m_queryCache.versionInfo.constEnd(); ++it)
+            queryResult.insert(it.key(), it.value());
+
+        QStringList abis;
+        foreach (const ProjectExplorer::Abi &abi, m_queryCache.abis)
+            abis.append(abi.toString());
+
+        map.insert(QLatin1String(QUERY_FINGERPRINT), m_queryCache.fingerprint);
+        map.insert(QLatin1String(QUERY_RESULT), queryResult);
+        map.insert(QLatin1String(QUERY_ABIS), abis);
+    }
     return map;
 }
 
@@ -73,9 +127,27 @@ QString LinkMotionQtVersion::type() const
     return QLatin1String(Constants::LM_QTVERSION_TYPE);
 }
 
+/*!
+ * \brief LinkMotionQtVersion::detectQtAbis
+ * Returns the stored ABIs if the target did not change, otherwise the
+ * QtCore of the target is inspected and the results of this and of the
+ * qmake query are remembered for the next start
+ */
 QList<ProjectExplorer::Abi> LinkMotionQtVersion::detectQtAbis() const
 {
-    return qtAbisFromLibrary(qtCorePaths());
+    if (!m_queryCache.fingerprint.isEmpty())
+        return m_queryCache.abis;
+
+    const QList<ProjectExplorer::Abi> abis = qtAbisFromLibrary(qtCorePaths());
+    const QHash<QString, QString> info = versionInfo();
+    const QString fingerprint = queryFingerprint(m_containerName, remoteQMakeCommand(), info);
+    if (!fingerprint.isEmpty() && !abis.isEmpty()) {
+        m_queryCache.fingerprint = fingerprint;
+        m_queryCache.versionInfo = info;
+        m_queryCache.abis = abis;
+        updateQueryCacheFile();
+    }
+    return abis;
 }
 
 QString LinkMotionQtVersion::description() const
@@ -123,23 +195,170 @@ bool LinkMotionQtVersion::needsQmlDump() const
     return false;
 }
 
-void LinkMotionQtVersion::addPathToEnv(Utils::Environment &env) const
+/*!
+ * \brief LinkMotionQtVersion::qmakeWrapperScript
+ * Returns the script used as qmake wrapper, or a empty
+ * string if it is not installed
+ */
+QString LinkMotionQtVersion::qmakeWrapperScript()
+{
+    //the wrappers are provisioned from the worker threads
+    static const QString script = [](){
+        QFileInfo info(QString::fromLatin1(Constants::LM_QMAKE_WRAPPER_SCRIPT).arg(Constants::LM_SCRIPTPATH));
+        return info.isExecutable() ? info.absoluteFilePath() : QString();
+    }();
+    return script;
+}
+
+/*!
+ * \brief LinkMotionQtVersion::invalidateQueryCache
+ * Drops the stored qmake properties and ABIs of all Qt versions
+ * of \a containerName, used after the target was upgraded
+ */
+void LinkMotionQtVersion::invalidateQueryCache(const QString &containerName)
+{
+    foreach (QtSupport::BaseQtVersion *version, QtSupport::QtVersionManager::versions()) {
+        if (version->type() != QLatin1String(Constants::LM_QTVERSION_TYPE))
+            continue;
+
+        LinkMotionQtVersion *lmVersion = static_cast<LinkMotionQtVersion *>(version);
+        if (lmVersion->m_containerName != containerName)
+            continue;
+
+        lmVersion->m_queryCache = QueryCache();
+        lmVersion->updateQueryCacheFile();
+    }
+}
+
+/*!
+ * \brief LinkMotionQtVersion::prefetchQuery
+ * Runs "qmake -query" for the wrapper \a qmakePath of \a containerName and
+ * stores the results next to it, so the Qt version created later on the GUI
+ * thread does not need to enter the container. Can be used from any thread.
+ */
+void LinkMotionQtVersion::prefetchQuery(const QString &containerName, const Utils::FileName &qmakePath)
+{
+    if (qmakePath.parentDir().appendPath(QLatin1String(Constants::LM_QMAKE_QUERY_CACHE)).exists())
+        return;
+
+    Utils::Environment env = Utils::Environment::systemEnvironment();
+    addPathToEnv(qmakePath, env);
+
+    QHash<QString, QString> versionInfo;
+    QString error;
+    if (!queryQMakeVariables(qmakePath, env, &versionInfo, &error)) {
+        if (debug) qDebug()<<"Prefetching the qmake query of"<<containerName<<"failed:"<<error;
+        return;
+    }
+
+    const QString remoteQMake = QStringLiteral("/usr/bin/%1").arg(qmakePath.fileName());
+    if (!queryFingerprint(containerName, remoteQMake, versionInfo).isEmpty())
+        writeQueryCacheFile(qmakePath, versionInfo);
+}
+
+/*!
+ * \brief LinkMotionQtVersion::queryFingerprint
+ * Hashes path, size and modification time of the qmake and the QtCore
+ * library inside the target, the library location is taken from
+ * \a versionInfo. Returns a empty string if one of them does not exist.
+ */
+QString LinkMotionQtVersion::queryFingerprint(const QString &containerName, const QString &remoteQMake,
+                                              const QHash<QString, QString> &versionInfo)
+{
+    TargetRegistry *registry = TargetRegistry::instance();
+    if (!registry)
+        return QString();
+
+    const QString rootfs = registry->rootfs(containerName);
+    const QString libs = versionInfo.value(QStringLiteral("QT_INSTALL_LIBS"));
+    const QString major = versionInfo.value(QStringLiteral("QT_VERSION")).section(QLatin1Char('.'), 0, 0);
+    if (rootfs.isEmpty() || libs.isEmpty() || major.isEmpty())
+        return QString();
+
+    SysrootPathTranslator::Ptr translator = SysrootPathTranslator::forSysroot(Utils::FileName::fromString(rootfs));
+    const QStringList files {
+        remoteQMake,
+        QStringLiteral("%1/libQt%2Core.so.%2").arg(translator->toContainer(libs)).arg(major)
+    };
+
+    QByteArray data;
+    foreach (const QString &file, files) {
+        const QFileInfo info = translator->resolve(file);
+        if (!info.exists())
+            return QString();
+
+        data.append(info.filePath().toUtf8());
+        data.append(QByteArray::number(info.size()));
+        data.append(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    }
+    return QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex());
+}
+
+/*!
+ * \brief LinkMotionQtVersion::writeQueryCacheFile
+ * Writes \a versionInfo next to the qmake wrapper \a qmakePath
+ * in the format of "qmake -query"
+ */
+void LinkMotionQtVersion::writeQueryCacheFile(const Utils::FileName &qmakePath, const QHash<QString, QString> &versionInfo)
+{
+    const QString fileName = qmakePath.parentDir().appendPath(QLatin1String(Constants::LM_QMAKE_QUERY_CACHE)).toString();
+
+    QStringList keys = versionInfo.keys();
+    keys.sort();
+
+    QByteArray content;
+    foreach (const QString &key, keys)
+        content.append(QStringLiteral("%1:%2\n").arg(key).arg(versionInfo.value(key)).toUtf8());
+
+    QFile existing(fileName);
+    if (existing.open(QIODevice::ReadOnly) && existing.readAll() == content)
+        return;
+    existing.close();
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning()<<"Unable to write"<<fileName;
+        return;
+    }
+    file.write(content);
+    file.commit();
+}
+
+/*!
+ * \brief LinkMotionQtVersion::updateQueryCacheFile
+ * Writes the stored qmake properties next to the qmake wrapper,
+ * or removes the file if there are none
+ */
+void LinkMotionQtVersion::updateQueryCacheFile() const
+{
+    if (qmakeCommand().isEmpty())
+        return;
+
+    if (m_queryCache.fingerprint.isEmpty()) {
+        QFile::remove(qmakeCommand().parentDir().appendPath(QLatin1String(Constants::LM_QMAKE_QUERY_CACHE)).toString());
+        return;
+    }
+
+    writeQueryCacheFile(qmakeCommand(), m_queryCache.versionInfo);
+}
+
+void LinkMotionQtVersion::addPathToEnv(const Utils::FileName &qmakePath, Utils::Environment &env)
 {
     QString path = env.value(QStringLiteral("PATH"));
-    path.prepend(qmakeCommand().parentDir().toString()+":");
+    path.prepend(qmakePath.parentDir().toString()+":");
     env.set(QStringLiteral("PATH"), path);
 }
 
 void LinkMotionQtVersion::addToEnvironment(const ProjectExplorer::Kit *k, Utils::Environment &env) const
 {
     QtSupport::BaseQtVersion::addToEnvironment(k, env);
-    addPathToEnv(env);
+    addPathToEnv(qmakeCommand(), env);
 }
 
 Utils::Environment LinkMotionQtVersion::qmakeRunEnvironment() const
 {
     auto env = Utils::Environment::systemEnvironment();
-    addPathToEnv(env);
+    addPathToEnv(qmakeCommand(), env);
     return env;
 }
 
@@ -172,11 +391,16 @@ QtSupport::BaseQtVersion *LinkMotionQtVersionFactory::create(const Utils::FileNa
     if(!qmakeInfo.absolutePath().contains(Settings::settingsPath().toString()))
         return 0;
 
-    if(!qmakeInfo.isSymLink() || qmakeInfo.symLinkTarget() != LinkMotionBasePlugin::lmTargetWrapper())
+    if(!qmakeInfo.isSymLink())
+        return 0;
+
+    const QString linkTarget = qmakeInfo.symLinkTarget();
+    if (linkTarget != LinkMotionBasePlugin::lmTargetWrapper() && linkTarget != LinkMotionQtVersion::qmakeWrapperScript())
         return 0;
 
     QString containerName = qmakePath.toFileInfo().dir().dirName();
-    if (!LinkMotionTargetTool::targetExists(containerName))
+    TargetRegistry *registry = TargetRegistry::instance();
+    if (!registry || !registry->isAvailable(containerName))
         return 0;
 
     return new LinkMotionQtVersion(containerName, qmakePath,isAutoDetected,autoDetectionSource);
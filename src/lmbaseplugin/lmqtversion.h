@@ -26,6 +26,13 @@
 namespace LmBase {
 namespace Internal {
 
+/*!
+ * \brief The LinkMotionQtVersion class
+ * Qt version of a target. The qmake properties and the Qt ABIs are stored
+ * together with a fingerprint of the qmake and QtCore of the target, as long
+ * as the fingerprint matches the qmake wrapper answers "qmake -query" from
+ * the stored properties and the container is not entered.
+ */
 class LinkMotionQtVersion : public QtSupport::BaseQtVersion
 {
 public:
@@ -56,11 +63,26 @@ public:
     virtual bool hasQmlDumpWithRelocatableFlag() const override;
     virtual bool needsQmlDump() const override;
 
+    static QString qmakeWrapperScript ();
+    static void invalidateQueryCache (const QString &containerName);
+    static void prefetchQuery (const QString &containerName, const Utils::FileName &qmakePath);
+
 private:
-    void addPathToEnv (Utils::Environment &env) const;
+    struct QueryCache {
+        QString fingerprint;
+        QHash<QString, QString> versionInfo;
+        QList<ProjectExplorer::Abi> abis;
+    };
+
+    static void addPathToEnv (const Utils::FileName &qmakePath, Utils::Environment &env);
+    static QString queryFingerprint (const QString &containerName, const QString &remoteQMake,
+                                     const QHash<QString, QString> &versionInfo);
+    static void writeQueryCacheFile (const Utils::FileName &qmakePath, const QHash<QString, QString> &versionInfo);
+    void updateQueryCacheFile () const;
 
 private:
     QString m_containerName;
+    mutable QueryCache m_queryCache;
 };
 
 class LinkMotionQtVersionFactory : public QtSupport::QtVersionFactory
@@ -21,6 +21,9 @@
 
 #include <lmbaseplugin/lmtargettool.h>
 #include <lmbaseplugin/lmtargetdialog.h>
+#include <lmbaseplugin/lmtargetregistry.h>
+#include <lmbaseplugin/lmkitmanager.h>
+#include <lmbaseplugin/compilercache.h>
 #include "settings.h"
 
 #include <QFileDialog>
@@ -53,6 +56,11 @@ LinkMotionSettingsTargetWidget::LinkMotionSettingsTargetWidget(QWidget *parent)
     ui->lineEditUser->setText(creds.user);
     ui->lineEditPass->setText(creds.pass);
 
+    Settings::CompilerCacheSettings cache = Settings::compilerCacheSettings();
+    ui->groupBoxCompilerCache->setChecked(cache.enabled);
+    ui->spinBoxCacheSize->setValue(cache.maxSizeGb);
+    showCompilerCacheStatistics();
+
     m_deleteMapper = new QSignalMapper(this);
     connect(m_deleteMapper, SIGNAL(mapped(int)),this, SLOT(on_deleteTarget(int)));
     m_maintainMapper = new QSignalMapper(this);
@@ -70,6 +78,9 @@ LinkMotionSettingsTargetWidget::LinkMotionSettingsTargetWidget(QWidget *parent)
     ui->treeWidgetClickTargets->header()->setSectionResizeMode(4, QHeaderView::ResizeToContents);
     ui->treeWidgetClickTargets->header()->setSectionResizeMode(5, QHeaderView::ResizeToContents);
     ui->treeWidgetClickTargets->header()->setSectionResizeMode(6, QHeaderView::ResizeToContents);
+
+    connect(TargetRegistry::instance(), &TargetRegistry::targetsChanged,
+            this, &LinkMotionSettingsTargetWidget::listExistingClickTargets);
     listExistingClickTargets();
 }
 
@@ -85,7 +96,14 @@ void LinkMotionSettingsTargetWidget::apply() {
     creds.pass = ui->lineEditPass->text();
     Settings::setImageServerCredentials(creds);
 
+    Settings::CompilerCacheSettings cache;
+    cache.enabled   = ui->groupBoxCompilerCache->isChecked();
+    cache.maxSizeGb = ui->spinBoxCacheSize->value();
+    Settings::setCompilerCacheSettings(cache);
+
     Settings::flushSettings();
+
+    LinkMotionKitManager::updateCompilerCacheSettings();
 }
 
 LinkMotionSettingsTargetWidget::~LinkMotionSettingsTargetWidget()
@@ -99,7 +117,6 @@ void LinkMotionSettingsTargetWidget::on_pushButtonCreateClickTarget_clicked()
     apply();
 
     Internal::LinkMotionTargetDialog::createTargetModal(true, this);
-    listExistingClickTargets();
 }
 
 void LinkMotionSettingsTargetWidget::on_deleteTarget(const int index)
@@ -110,7 +127,6 @@ void LinkMotionSettingsTargetWidget::on_deleteTarget(const int index)
     if(debug) qDebug()<<"Destroying target "<< m_availableTargets.at(index);
 
     Internal::LinkMotionTargetDialog::maintainTargetModal(m_availableTargets.at(index),LinkMotionTargetTool::Delete);
-    listExistingClickTargets();
 }
 
 void LinkMotionSettingsTargetWidget::on_maintainTarget(const int index)
@@ -129,14 +145,50 @@ void LinkMotionSettingsTargetWidget::on_upgradeTarget(const int index)
 
 /**
  * @brief UbuntuSettingsClickWidget::listExistingClickTargets
- * Lists all existing link motion targets
+ * Lists all existing link motion targets known to the TargetRegistry,
+ * the list is updated whenever the registry changes
  */
 void LinkMotionSettingsTargetWidget::listExistingClickTargets()
 {
-    //this should hopefully also delete all mapped pushbuttons
-    ui->treeWidgetClickTargets->clear();
+    TargetRegistry *registry = TargetRegistry::instance();
+    if (!registry->isLoaded()) {
+        //this should hopefully also delete all mapped pushbuttons
+        ui->treeWidgetClickTargets->clear();
+        ui->treeWidgetClickTargets->setEnabled(false);
+        m_availableTargets.clear();
+        registry->refresh();
+        return;
+    }
+
+    showTargets(registry->targets());
+}
+
+/*!
+ * \brief LinkMotionSettingsTargetWidget::showCompilerCacheStatistics
+ * Shows the hit rate and size of the compiler cache of each architecture
+ */
+void LinkMotionSettingsTargetWidget::showCompilerCacheStatistics()
+{
+    QStringList lines;
+    foreach (const CompilerCache::Statistics &stats, CompilerCache::allStatistics()) {
+        lines.append(tr("%1: %2 hits, %3 misses (%4%), %5 MB used")
+                     .arg(stats.architecture)
+                     .arg(stats.hits)
+                     .arg(stats.misses)
+                     .arg(stats.hitRate(), 0, 'f', 1)
+                     .arg(stats.sizeKiB / 1024));
+    }
 
-    QList<LinkMotionTargetTool::Target> items = LinkMotionTargetTool::listAvailableTargets();
+    if (lines.isEmpty())
+        lines.append(tr("The compiler cache was not used yet"));
+
+    ui->labelCacheStats->setText(lines.join(QLatin1Char('\n')));
+}
+
+void LinkMotionSettingsTargetWidget::showTargets(const QList<LinkMotionTargetTool::Target> &items)
+{
+    ui->treeWidgetClickTargets->clear();
+    ui->treeWidgetClickTargets->setEnabled(true);
     m_availableTargets = items;
 
     QAbstractItemModel* model = ui->treeWidgetClickTargets->model();
@@ -49,6 +49,8 @@ protected slots:
 
 private:
     void listExistingClickTargets ();
+    void showTargets (const QList<LinkMotionTargetTool::Target> &targets);
+    void showCompilerCacheStatistics ();
 
 private:
     Ui::LinkMotionSettingsTargetWidget *ui = Q_NULLPTR;
@@ -21,6 +21,11 @@
 #include <lmbaseplugin/lmbaseplugin_constants.h>
 #include <lmbaseplugin/lmtoolchain.h>
 #include <lmbaseplugin/lmkitmanager.h>
+#include <lmbaseplugin/lmqtversion.h>
+#include <lmbaseplugin/lmtargetregistry.h>
+#include <lmbaseplugin/toolchainprobecache.h>
+#include <lmbaseplugin/debugindexcache.h>
+#include <lmbaseplugin/preamblecache.h>
 #include <lmbaseplugin/wizards/createtargetwizard.h>
 
 #include <projectexplorer/projectexplorer.h>
@@ -28,6 +33,9 @@
 #include <projectexplorer/kitmanager.h>
 #include <projectexplorer/kitinformation.h>
 #include <projectexplorer/devicesupport/devicemanager.h>
+#include <debugger/debuggeritemmanager.h>
+#include <debugger/debuggeritem.h>
+#include <debugger/debuggerkitinformation.h>
 #include <cmakeprojectmanager/cmaketoolmanager.h>
 #include <cmakeprojectmanager/cmakekitinformation.h>
 #include <qtsupport/qtversionmanager.h>
@@ -54,11 +62,9 @@ bool LinkMotionTargetDialog::doCreateTarget (bool redetectKits, const LinkMotion
     bool success = (runProcessModal(params, parent) == 0);
 
     if(success) {
-        LinkMotionToolChain* tc = new LinkMotionToolChain(t, ProjectExplorer::Constants::C_LANGUAGE_ID, ProjectExplorer::ToolChain::AutoDetection);
-        ProjectExplorer::ToolChainManager::registerToolChain(tc);
-
-        tc = new LinkMotionToolChain(t, ProjectExplorer::Constants::CXX_LANGUAGE_ID, ProjectExplorer::ToolChain::AutoDetection);
-                ProjectExplorer::ToolChainManager::registerToolChain(tc);
+        //the registry picks up the new target, toolchains and kits
+        //are created as soon as it emits targetsChanged
+        TargetRegistry::instance()->refresh();
 
         if(redetectKits)
             LinkMotionKitManager::autoDetectKits();
@@ -83,6 +89,30 @@ bool LinkMotionTargetDialog::createTargetModal(bool redetectKits, const QString
     return doCreateTarget(redetectKits, t, parent);
 }
 
+/*!
+ * \brief removeTargetDebugger
+ * Deregisters the debugger registered for \a target, unless a remaining
+ * kit still uses it. Without the gdb index wrapper all targets share
+ * the same gdb-multiarch entry, named after the first one.
+ */
+static void removeTargetDebugger(const LinkMotionTargetTool::Target &target)
+{
+    const QString displayName = LinkMotionKitManager::tr("Link Motion SDK Debugger (%1)").arg(target.containerName);
+    foreach (const Debugger::DebuggerItem &debugger, Debugger::DebuggerItemManager::debuggers()) {
+        if (!debugger.isAutoDetected() || debugger.unexpandedDisplayName() != displayName)
+            continue;
+
+        const QVariant id = debugger.id();
+        const bool used = !ProjectExplorer::KitManager::kits([&id](const ProjectExplorer::Kit *k) {
+            const Debugger::DebuggerItem *item = Debugger::DebuggerKitInformation::debugger(k);
+            return item && item->id() == id;
+        }).isEmpty();
+
+        if (!used)
+            Debugger::DebuggerItemManager::deregisterDebugger(id);
+    }
+}
+
 int LinkMotionTargetDialog::maintainTargetModal(const LinkMotionTargetTool::Target &target, const LinkMotionTargetTool::MaintainMode &mode)
 {
     return maintainTargetModal(QList<LinkMotionTargetTool::Target>()<<target,mode);
@@ -141,6 +171,8 @@ int LinkMotionTargetDialog::maintainTargetModal(const QList<LinkMotionTargetTool
                 ProjectExplorer::KitManager::saveKits();
             }
 
+            removeTargetDebugger(target);
+
             //make sure no help files are still opened
             Core::HelpManager::unregisterDocumentation(docToRemove);
         }
@@ -151,6 +183,22 @@ int LinkMotionTargetDialog::maintainTargetModal(const QList<LinkMotionTargetTool
     }
 
     int code = runProcessModal(paramList);
+
+    //containers might be gone or changed, let the registry find out
+    TargetRegistry::instance()->refresh();
+
+    //the compilers, qmake and Qt libraries might have been replaced, the
+    //caches are dropped now and rebuilt when the refresh finished, their
+    //stamps depend on the upgraded image
+    if(mode == LinkMotionTargetTool::Upgrade) {
+        foreach(const LinkMotionTargetTool::Target &target, targetList) {
+            LinkMotionQtVersion::invalidateQueryCache(target.containerName);
+            ToolChainProbeCache::instance()->invalidate(target.containerName);
+            DebugIndexCache::instance()->invalidate(target.containerName);
+            PreambleCache::instance()->invalidate(target.containerName);
+        }
+    }
+
     if(mode == LinkMotionTargetTool::Delete) {
         //redetect documentation
         QtSupport::QtVersionManager::triggerDocumentationUpdate();
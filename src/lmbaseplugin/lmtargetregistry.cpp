@@ -0,0 +1,439 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#include "lmtargetregistry.h"
+#include "settings.h"
+#include <lmbaseplugin/lxd/lxdclient.h>
+
+#include <utils/fileutils.h>
+#include <utils/runextensions.h>
+
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <QDebug>
+
+namespace LmBase {
+namespace Internal {
+
+enum {
+    debug = 0
+};
+
+const char TARGET_CACHE_FILENAME[] = "targets.cache";
+const quint32 TARGET_CACHE_MAGIC   = 0x4c4d5452; // "LMTR"
+const quint32 TARGET_CACHE_VERSION = 3;
+
+TargetRegistry *TargetRegistry::m_instance = nullptr;
+
+TargetRegistry::TargetRegistry(QObject *parent)
+    : QObject(parent)
+{
+    Q_ASSERT_X(!m_instance, Q_FUNC_INFO, "There can be only one TargetRegistry instance");
+    m_instance = this;
+}
+
+TargetRegistry::~TargetRegistry()
+{
+    m_instance = nullptr;
+}
+
+TargetRegistry *TargetRegistry::instance()
+{
+    return m_instance;
+}
+
+/*!
+ * \brief TargetRegistry::isLoaded
+ * Returns true as soon as the target list was queried once
+ */
+bool TargetRegistry::isLoaded() const
+{
+    QReadLocker lock(&m_lock);
+    return m_loaded;
+}
+
+bool TargetRegistry::isRefreshing() const
+{
+    return m_refreshing;
+}
+
+QList<LinkMotionTargetTool::Target> TargetRegistry::targets() const
+{
+    QReadLocker lock(&m_lock);
+    QList<LinkMotionTargetTool::Target> result;
+    foreach (const TargetInfo &info, m_data.targets)
+        result.append(info.target);
+    return result;
+}
+
+/*!
+ * \brief TargetRegistry::deviceContainers
+ * Returns all targets that can be used as a device on the host
+ */
+QList<LinkMotionTargetTool::Target> TargetRegistry::deviceContainers() const
+{
+    QList<LinkMotionTargetTool::Target> result;
+    foreach (const LinkMotionTargetTool::Target &t, targets()) {
+        if (LinkMotionTargetTool::compatibleWithHostArchitecture(t.architecture))
+            result.append(t);
+    }
+    return result;
+}
+
+bool TargetRegistry::contains(const QString &containerName) const
+{
+    QReadLocker lock(&m_lock);
+    return m_data.targets.contains(containerName);
+}
+
+/*!
+ * \brief TargetRegistry::isAvailable
+ * Returns true if \a containerName can be used. As long as the registry is not
+ * loaded all targets are assumed to be available, items using a removed target
+ * are cleaned up as soon as the targets are known
+ */
+bool TargetRegistry::isAvailable(const QString &containerName) const
+{
+    QReadLocker lock(&m_lock);
+    return !m_loaded || m_data.targets.contains(containerName);
+}
+
+bool TargetRegistry::target(const QString &containerName, LinkMotionTargetTool::Target *target) const
+{
+    QReadLocker lock(&m_lock);
+    auto it = m_data.targets.constFind(containerName);
+    if (it == m_data.targets.constEnd())
+        return false;
+    if (target)
+        *target = it->target;
+    return true;
+}
+
+TargetRegistry::TargetInfo TargetRegistry::targetInfo(const QString &containerName) const
+{
+    QReadLocker lock(&m_lock);
+    return m_data.targets.value(containerName);
+}
+
+QString TargetRegistry::rootfs(const QString &containerName) const
+{
+    QReadLocker lock(&m_lock);
+    return m_data.targets.value(containerName).rootfs;
+}
+
+QString TargetRegistry::defaultUser(const QString &containerName) const
+{
+    QReadLocker lock(&m_lock);
+    return m_data.targets.value(containerName).defaultUser;
+}
+
+int TargetRegistry::cpuLimit(const QString &containerName) const
+{
+    QReadLocker lock(&m_lock);
+    return m_data.targets.value(containerName).cpuLimit;
+}
+
+bool TargetRegistry::hasNinja(const QString &containerName) const
+{
+    QReadLocker lock(&m_lock);
+    return m_data.targets.value(containerName).hasNinja;
+}
+
+bool TargetRegistry::hasCMake(const QString &containerName) const
+{
+    QReadLocker lock(&m_lock);
+    return m_data.targets.value(containerName).hasCMake;
+}
+
+QString TargetRegistry::hostArchitecture() const
+{
+    QReadLocker lock(&m_lock);
+    return m_data.hostArchitecture;
+}
+
+/*!
+ * \brief TargetRegistry::load
+ * Restores the targets from the cache file. If the cached data does not match
+ * the containers on disk anymore it is still used, but a refresh is started
+ * to revalidate it in the background
+ */
+void TargetRegistry::load()
+{
+    Snapshot cached;
+    if (!readCache(&cached)) {
+        refresh();
+        return;
+    }
+
+    const bool upToDate = isUpToDate(cached);
+    {
+        QWriteLocker lock(&m_lock);
+        m_data = cached;
+        m_loaded = true;
+    }
+
+    if (debug) qDebug()<<"Target registry restored from cache, up to date:"<<upToDate;
+
+    emit targetsChanged();
+
+    if (!upToDate)
+        refresh();
+}
+
+/*!
+ * \brief TargetRegistry::refresh
+ * Queries the targets from lmsdk-target in the background and emits
+ * targetsChanged if anything changed. Calls while a refresh is running
+ * are folded into one additional refresh.
+ */
+void TargetRegistry::refresh()
+{
+    if (m_refreshing) {
+        m_refreshPending = true;
+        return;
+    }
+
+    Snapshot previous;
+    {
+        QReadLocker lock(&m_lock);
+        previous = m_data;
+    }
+
+    m_refreshing = true;
+    Utils::onResultReady(Utils::runAsync(LinkMotionTargetTool::workerPool(), &TargetRegistry::querySnapshot, previous),
+                         this, &TargetRegistry::applySnapshot);
+}
+
+/*!
+ * \brief TargetRegistry::querySnapshot
+ * Runs in the worker pool and collects all information about the
+ * available targets. Metadata of targets whose rootfs did not change
+ * since \a previous was taken is reused instead of asking lmsdk-target again.
+ */
+TargetRegistry::Snapshot TargetRegistry::querySnapshot(const TargetRegistry::Snapshot &previous)
+{
+    Snapshot snap;
+    snap.hostArchitecture = LinkMotionTargetTool::hostArchitecture();
+
+    const bool useLxd = LxdClient::isAvailable();
+    LxdClient lxd;
+
+    foreach (const LinkMotionTargetTool::Target &t, LinkMotionTargetTool::listAvailableTargets()) {
+        TargetInfo info;
+        info.target = t;
+
+        const TargetInfo known = previous.targets.value(t.containerName);
+        if (known.rootfsStamp >= 0 && fileStamp(known.rootfs) == known.rootfsStamp) {
+            info.rootfs = known.rootfs;
+            info.defaultUser = known.defaultUser;
+        } else {
+            info.rootfs = LinkMotionTargetTool::queryTargetBasePath(t.containerName);
+            info.defaultUser = LinkMotionTargetTool::queryTargetDefaultUser(t.containerName);
+        }
+        info.rootfsStamp = fileStamp(info.rootfs);
+        info.hasNinja = QFileInfo(info.rootfs + QStringLiteral("/usr/bin/ninja")).isExecutable();
+        info.hasCMake = QFileInfo(info.rootfs + QStringLiteral("/usr/bin/cmake")).isExecutable();
+
+        //the limits can be changed without touching the rootfs, always query them
+        if (!useLxd || !lxd.containerCpuLimit(t.containerName, &info.cpuLimit))
+            info.cpuLimit = known.cpuLimit;
+
+        snap.targets.insert(t.containerName, info);
+    }
+
+    snap.containersStamp = fileStamp(containersDirectory(snap));
+    return snap;
+}
+
+bool TargetRegistry::equalSnapshots(const TargetRegistry::Snapshot &a, const TargetRegistry::Snapshot &b)
+{
+    if (a.hostArchitecture != b.hostArchitecture
+            || a.targets.keys() != b.targets.keys())
+        return false;
+
+    for (auto it = a.targets.constBegin(); it != a.targets.constEnd(); ++it) {
+        const TargetInfo &left  = it.value();
+        const TargetInfo &right = b.targets.value(it.key());
+        if (left.rootfs != right.rootfs
+                || left.defaultUser != right.defaultUser
+                || left.cpuLimit != right.cpuLimit
+                || left.hasNinja != right.hasNinja
+                || left.hasCMake != right.hasCMake
+                || left.target.architecture != right.target.architecture
+                || left.target.distribution != right.target.distribution
+                || left.target.version != right.target.version)
+            return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief TargetRegistry::isUpToDate
+ * Checks if \a snapshot still matches the containers on disk. This only
+ * stats the container directories and never calls lmsdk-target
+ */
+bool TargetRegistry::isUpToDate(const TargetRegistry::Snapshot &snapshot)
+{
+    const QString containersDir = containersDirectory(snapshot);
+    if (containersDir.isEmpty() || fileStamp(containersDir) != snapshot.containersStamp)
+        return false;
+
+    foreach (const TargetInfo &info, snapshot.targets) {
+        if (info.rootfsStamp < 0 || fileStamp(info.rootfs) != info.rootfsStamp)
+            return false;
+    }
+    return true;
+}
+
+qint64 TargetRegistry::fileStamp(const QString &path)
+{
+    if (path.isEmpty())
+        return -1;
+
+    QFileInfo info(path);
+    if (!info.exists())
+        return -1;
+    return info.lastModified().toMSecsSinceEpoch();
+}
+
+/*!
+ * \brief TargetRegistry::containersDirectory
+ * Returns the directory that contains all containers, it is
+ * modified whenever a container is created or destroyed
+ */
+QString TargetRegistry::containersDirectory(const TargetRegistry::Snapshot &snapshot)
+{
+    foreach (const TargetInfo &info, snapshot.targets) {
+        if (!info.rootfs.isEmpty())
+            return Utils::FileName::fromString(info.rootfs).parentDir().parentDir().toString();
+    }
+    return QString();
+}
+
+QString TargetRegistry::cacheFileName()
+{
+    return Settings::settingsPath()
+            .appendPath(QLatin1String(TARGET_CACHE_FILENAME))
+            .toString();
+}
+
+bool TargetRegistry::readCache(TargetRegistry::Snapshot *snapshot)
+{
+    QFile file(cacheFileName());
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_6);
+
+    quint32 magic = 0, version = 0, count = 0;
+    in >> magic >> version;
+    if (magic != TARGET_CACHE_MAGIC || version != TARGET_CACHE_VERSION) {
+        if (debug) qDebug()<<"Ignoring target cache with unknown format version"<<version;
+        return false;
+    }
+
+    Snapshot snap;
+    in >> snap.hostArchitecture >> snap.containersStamp >> count;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+        TargetInfo info;
+        in >> info.target.containerName
+           >> info.target.architecture
+           >> info.target.distribution
+           >> info.target.version
+           >> info.rootfs
+           >> info.defaultUser
+           >> info.rootfsStamp
+           >> info.cpuLimit
+           >> info.hasNinja
+           >> info.hasCMake;
+        snap.targets.insert(info.target.containerName, info);
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        qWarning()<<"Target cache"<<file.fileName()<<"is corrupt";
+        return false;
+    }
+
+    *snapshot = snap;
+    return true;
+}
+
+void TargetRegistry::writeCache(const TargetRegistry::Snapshot &snapshot)
+{
+    QSaveFile file(cacheFileName());
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning()<<"Unable to write the target cache"<<file.fileName();
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_6);
+    out << TARGET_CACHE_MAGIC << TARGET_CACHE_VERSION;
+    out << snapshot.hostArchitecture << snapshot.containersStamp << quint32(snapshot.targets.size());
+    foreach (const TargetInfo &info, snapshot.targets) {
+        out << info.target.containerName
+            << info.target.architecture
+            << info.target.distribution
+            << info.target.version
+            << info.rootfs
+            << info.defaultUser
+            << info.rootfsStamp
+            << qint32(info.cpuLimit)
+            << info.hasNinja
+            << info.hasCMake;
+    }
+
+    if (!file.commit())
+        qWarning()<<"Unable to write the target cache"<<file.fileName();
+}
+
+void TargetRegistry::applySnapshot(const TargetRegistry::Snapshot &snapshot)
+{
+    bool changed = false;
+    {
+        QWriteLocker lock(&m_lock);
+        changed = !m_loaded || !equalSnapshots(m_data, snapshot);
+        m_data = snapshot;
+        m_loaded = true;
+    }
+
+    m_refreshing = false;
+    if (debug) qDebug()<<"Target registry refreshed, changed:"<<changed;
+
+    //always rewritten, the stamps might have changed even if the data did not
+    writeCache(snapshot);
+
+    if (changed)
+        emit targetsChanged();
+
+    if (m_refreshPending) {
+        m_refreshPending = false;
+        refresh();
+    } else {
+        emit refreshFinished();
+    }
+}
+
+} // namespace Internal
+} // namespace LmBase
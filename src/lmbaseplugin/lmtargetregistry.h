@@ -0,0 +1,116 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#ifndef LMBASE_INTERNAL_TARGETREGISTRY_H
+#define LMBASE_INTERNAL_TARGETREGISTRY_H
+
+#include "lmtargettool.h"
+
+#include <QObject>
+#include <QList>
+#include <QMap>
+#include <QReadWriteLock>
+
+namespace LmBase {
+namespace Internal {
+
+/*!
+ * \brief The TargetRegistry class
+ * Owns the list of available targets and their metadata. The data is
+ * only queried from lmsdk-target when refresh() is called, all other
+ * functions are pure in-memory lookups and can be used from any thread.
+ * The data is persisted in the settings directory, so a IDE start
+ * does not need to query anything as long as the containers did not change.
+ */
+class TargetRegistry : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct TargetInfo {
+        LinkMotionTargetTool::Target target;
+        QString rootfs;
+        QString defaultUser;
+        qint64  rootfsStamp = -1;
+        int     cpuLimit = 0; //0 means not limited
+        bool    hasNinja = false;
+        bool    hasCMake = false;
+    };
+
+    explicit TargetRegistry(QObject *parent = 0);
+    ~TargetRegistry();
+
+    static TargetRegistry *instance ();
+
+    bool isLoaded () const;
+    bool isRefreshing () const;
+
+    QList<LinkMotionTargetTool::Target> targets () const;
+    QList<LinkMotionTargetTool::Target> deviceContainers () const;
+    bool contains (const QString &containerName) const;
+    bool isAvailable (const QString &containerName) const;
+    bool target (const QString &containerName, LinkMotionTargetTool::Target *target) const;
+    TargetInfo targetInfo (const QString &containerName) const;
+    QString rootfs (const QString &containerName) const;
+    QString defaultUser (const QString &containerName) const;
+    int cpuLimit (const QString &containerName) const;
+    bool hasNinja (const QString &containerName) const;
+    bool hasCMake (const QString &containerName) const;
+    QString hostArchitecture () const;
+
+    void load ();
+
+public slots:
+    void refresh ();
+
+signals:
+    void targetsChanged ();
+    //the registry is current again, no further refresh is pending
+    void refreshFinished ();
+
+private:
+    struct Snapshot {
+        QString hostArchitecture;
+        qint64  containersStamp = -1;
+        QMap<QString, TargetInfo> targets;
+    };
+
+    static Snapshot querySnapshot (const Snapshot &previous);
+    static bool equalSnapshots (const Snapshot &a, const Snapshot &b);
+    static bool isUpToDate (const Snapshot &snapshot);
+    static qint64 fileStamp (const QString &path);
+    static QString containersDirectory (const Snapshot &snapshot);
+    static QString cacheFileName ();
+    static bool readCache (Snapshot *snapshot);
+    static void writeCache (const Snapshot &snapshot);
+    void applySnapshot (const Snapshot &snapshot);
+
+private:
+    static TargetRegistry *m_instance;
+
+    mutable QReadWriteLock m_lock;
+    Snapshot m_data;
+    bool m_loaded = false;
+    bool m_refreshing = false;
+    bool m_refreshPending = false;
+};
+
+} // namespace Internal
+} // namespace LmBase
+
+#endif // LMBASE_INTERNAL_TARGETREGISTRY_H
@@ -23,9 +23,16 @@
 #include <lmbaseplugin/lmtoolchain.h>
 #include <lmbaseplugin/lmshared.h>
 #include <lmbaseplugin/settings.h>
+#include <lmbaseplugin/lmtargetregistry.h>
+#include <lmbaseplugin/sysrootpathtranslator.h>
+#include <lmbaseplugin/lxd/lxdclient.h>
+#include <lmbaseplugin/lmqtversion.h>
+#include <lmbaseplugin/debugindexcache.h>
 
 #include <QRegularExpression>
 #include <QDir>
+#include <QSet>
+#include <QHash>
 #include <QMessageBox>
 #include <QInputDialog>
 #include <QProcess>
@@ -39,6 +46,9 @@
 #include <QJsonParseError>
 #include <QCollator>
 #include <QTextStream>
+#include <QThreadPool>
+#include <QMutex>
+#include <QMutexLocker>
 
 #include <coreplugin/icore.h>
 #include <projectexplorer/projectexplorer.h>
@@ -50,6 +60,7 @@
 #include <utils/qtcprocess.h>
 #include <utils/environment.h>
 #include <utils/consoleprocess.h>
+#include <utils/runextensions.h>
 
 #include <QDebug>
 
@@ -64,6 +75,51 @@ const char DESTROY_TARGET_ARGS[] = "destroy %1";
 const char UPGRADE_TARGET_ARGS[] = "upgrade %0";
 const char TARGET_OPEN_TERMINAL[]       = "%0 maint %1";
 
+const int TARGET_TOOL_TIMEOUT  = 3000;
+const int TARGET_TOOL_MAX_JOBS = 4;
+
+//all tools that get a lmsdk-wrapper link next to the rootfs of a target
+static const char *TOOL_WRAPPERS[] = {
+    "gcc", "g++", "qmake", "make", "cmake", "gdb", "moc", "rcc", "ninja"
+};
+
+struct ToolWrapperManifest {
+    QString baseDir;
+    QHash<QString, QString> wrappers; //tool name -> wrapper path
+};
+
+//the caches are shared between the GUI thread and the worker pool
+static QMutex cacheMutex;
+static QString hostArchCache;
+static QHash<QString, ToolWrapperManifest> wrapperManifests;
+
+/**
+ * @brief runTargetTool
+ * Runs lmsdk-target synchronously with \a args and stores the standard
+ * output in \a output. This blocks for up to TARGET_TOOL_TIMEOUT ms, so it
+ * should only be used from the LinkMotionTargetTool::workerPool()
+ */
+static bool runTargetTool (const QStringList &args, QByteArray *output = nullptr)
+{
+    QProcess sdkTool;
+    sdkTool.setReadChannel(QProcess::StandardOutput);
+    sdkTool.setProgram(Internal::LinkMotionBasePlugin::lmTargetTool());
+    sdkTool.setArguments(args);
+    sdkTool.start(QIODevice::ReadOnly);
+    if (!sdkTool.waitForFinished(TARGET_TOOL_TIMEOUT)) {
+        qWarning()<<"lmsdk-target"<<args<<"did not return in time.";
+        return false;
+    }
+
+    if (sdkTool.exitCode() != 0
+            || sdkTool.exitStatus() != QProcess::NormalExit)
+        return false;
+
+    if (output)
+        *output = sdkTool.readAllStandardOutput();
+    return true;
+}
+
 /**
  * @brief LmTargetTool::LmTargetTool
  * Implements functionality needed for executing the target
@@ -238,48 +294,49 @@ bool LmTargetTool::getTargetFromUser(Target *target, const QString &framework)
 }
 #endif
 
+/*!
+ * \brief LinkMotionTargetTool::targetBasePath
+ * Returns the rootfs of \a targetName, the TargetRegistry is asked first,
+ * lmsdk-target is only called for targets the registry does not know yet
+ */
 QString LinkMotionTargetTool::targetBasePath(const QString &targetName)
 {
-    static QMap<QString, QString> basePathCache;
-    if (basePathCache.contains(targetName))
-        return basePathCache.value(targetName);
-
-    QProcess sdkTool;
-    sdkTool.setReadChannel(QProcess::StandardOutput);
-    sdkTool.setProgram(Internal::LinkMotionBasePlugin::lmTargetTool());
-    sdkTool.setArguments(QStringList()<<QStringLiteral("rootfs")<<targetName);
-    sdkTool.start(QIODevice::ReadOnly);
-    if (!sdkTool.waitForFinished(3000)
-            || sdkTool.exitCode() != 0
-            || sdkTool.exitStatus() != QProcess::NormalExit)
-        return QString();
-
-    QTextStream in(&sdkTool);
-    QString basePath = in.readAll().trimmed();
-    basePathCache.insert(targetName, basePath);
-    return basePath;
+    Internal::TargetRegistry *registry = Internal::TargetRegistry::instance();
+    if (registry && registry->contains(targetName))
+        return registry->rootfs(targetName);
+    return queryTargetBasePath(targetName);
 }
 
 QString LinkMotionTargetTool::targetDefaultUser(const QString &targetName)
 {
-    static QMap<QString, QString> usernameCache;
-    if (usernameCache.contains(targetName))
-        return usernameCache.value(targetName);
+    Internal::TargetRegistry *registry = Internal::TargetRegistry::instance();
+    if (registry && registry->contains(targetName))
+        return registry->defaultUser(targetName);
+    return queryTargetDefaultUser(targetName);
+}
 
-    QProcess sdkTool;
-    sdkTool.setReadChannel(QProcess::StandardOutput);
-    sdkTool.setProgram(Internal::LinkMotionBasePlugin::lmTargetTool());
-    sdkTool.setArguments(QStringList()<<QStringLiteral("username")<<targetName);
-    sdkTool.start(QIODevice::ReadOnly);
-    if (!sdkTool.waitForFinished(3000)
-            || sdkTool.exitCode() != 0
-            || sdkTool.exitStatus() != QProcess::NormalExit)
+/*!
+ * \brief LinkMotionTargetTool::queryTargetBasePath
+ * Asks lmsdk-target for the rootfs of \a targetName, the result is not cached
+ */
+QString LinkMotionTargetTool::queryTargetBasePath(const QString &targetName)
+{
+    QByteArray output;
+    if (!runTargetTool(QStringList()<<QStringLiteral("rootfs")<<targetName, &output))
         return QString();
+    return QString::fromLocal8Bit(output).trimmed();
+}
 
-    QTextStream in(&sdkTool);
-    QString username = in.readAll().trimmed();
-    usernameCache.insert(targetName, username);
-    return username;
+/*!
+ * \brief LinkMotionTargetTool::queryTargetDefaultUser
+ * Asks lmsdk-target for the default user of \a targetName, the result is not cached
+ */
+QString LinkMotionTargetTool::queryTargetDefaultUser(const QString &targetName)
+{
+    QByteArray output;
+    if (!runTargetTool(QStringList()<<QStringLiteral("username")<<targetName, &output))
+        return QString();
+    return QString::fromLocal8Bit(output).trimmed();
 }
 
 QString LinkMotionTargetTool::targetBasePath(const LinkMotionTargetTool::Target &target)
@@ -311,7 +368,8 @@ bool LinkMotionTargetTool::parseContainerName(const QString &name, LinkMotionTar
 
 /*!
  * \brief LmTargetTool::targetExists
- * checks if the target is still available
+ * checks if the target is still available, this asks LXD or lmsdk-target
+ * directly. Use TargetRegistry::isAvailable for frequent checks.
  */
 bool LinkMotionTargetTool::targetExists(const LinkMotionTargetTool::Target &target)
 {
@@ -320,34 +378,29 @@ bool LinkMotionTargetTool::targetExists(const LinkMotionTargetTool::Target &targ
 
 bool LinkMotionTargetTool::targetExists(const QString &targetName)
 {
-    QProcess proc;
-    proc.start(Internal::LinkMotionBasePlugin::lmTargetTool(),
-               QStringList()<<QStringLiteral("exists")<<targetName);
-    if(!proc.waitForFinished(3000)) {
-        qWarning()<<"usdk-target did not return in time.";
-        return false;
+    if (Internal::LxdClient::isAvailable()) {
+        bool exists = false;
+        if (Internal::LxdClient().containerExists(targetName, &exists))
+            return exists;
     }
-
-    return (proc.exitCode() == 0);
+    return runTargetTool(QStringList()<<QStringLiteral("exists")<<targetName);
 }
 
 /**
  * @brief LmTargetTool::listAvailableTargets
  * @return all currently existing chroot targets in the system
+ *
+ * This intentionally still asks lmsdk-target instead of LXD: the distribution,
+ * version and architecture of a target are SDK metadata LXD does not know about.
  */
 QList<LinkMotionTargetTool::Target> LinkMotionTargetTool::listAvailableTargets(const QString &)
 {
-    QProcess sdkTool;
-    sdkTool.setProgram(Internal::LinkMotionBasePlugin::lmTargetTool());
-    sdkTool.setArguments(QStringList()<<QStringLiteral("list"));
-    sdkTool.start(QIODevice::ReadOnly);
-    if (!sdkTool.waitForFinished(3000)
-            || sdkTool.exitCode() != 0
-            || sdkTool.exitStatus() != QProcess::NormalExit)
+    QByteArray output;
+    if (!runTargetTool(QStringList()<<QStringLiteral("list"), &output))
         return QList<Target>();
 
     QJsonParseError err;
-    QJsonDocument doc = QJsonDocument::fromJson(sdkTool.readAllStandardOutput(), &err);
+    QJsonDocument doc = QJsonDocument::fromJson(output, &err);
     if (err.error != QJsonParseError::NoError || !doc.isArray())
         return QList<Target>();
 
@@ -439,19 +492,71 @@ const LinkMotionTargetTool::Target *LinkMotionTargetTool::lmTargetFromTarget(Pro
 
 bool LinkMotionTargetTool::setTargetUpgradesEnabled(const Target &target, const bool set)
 {
-    QProcess sdkTool;
-    sdkTool.setProgram(Internal::LinkMotionBasePlugin::lmTargetTool());
-    sdkTool.setArguments(QStringList{
+    return runTargetTool(QStringList{
         QStringLiteral("set"),
         target.containerName,
         set ? QStringLiteral("upgrades-enabled") : QStringLiteral("upgrades-disabled")
     });
-    sdkTool.start(QIODevice::ReadOnly);
-    if (!sdkTool.waitForFinished(3000)
-            || sdkTool.exitCode() != 0
-            || sdkTool.exitStatus() != QProcess::NormalExit)
-        return false;
-    return true;
+}
+
+/*!
+ * \brief LinkMotionTargetTool::workerPool
+ * All asynchronous queries to lmsdk-target are executed in this pool,
+ * it is limited to TARGET_TOOL_MAX_JOBS concurrent processes
+ */
+QThreadPool *LinkMotionTargetTool::workerPool()
+{
+    static QThreadPool *pool = [](){
+        QThreadPool *p = new QThreadPool(QCoreApplication::instance());
+        p->setMaxThreadCount(TARGET_TOOL_MAX_JOBS);
+        return p;
+    }();
+    return pool;
+}
+
+QFuture<QList<LinkMotionTargetTool::Target> > LinkMotionTargetTool::listAvailableTargetsAsync()
+{
+    return Utils::runAsync(workerPool(), [](){
+        return listAvailableTargets();
+    });
+}
+
+QFuture<QList<LinkMotionTargetTool::Target> > LinkMotionTargetTool::listPossibleDeviceContainersAsync()
+{
+    return Utils::runAsync(workerPool(), &LinkMotionTargetTool::listPossibleDeviceContainers);
+}
+
+QFuture<QString> LinkMotionTargetTool::targetBasePathAsync(const QString &targetName)
+{
+    return Utils::runAsync(workerPool(), [targetName](){
+        return targetBasePath(targetName);
+    });
+}
+
+QFuture<QString> LinkMotionTargetTool::targetDefaultUserAsync(const QString &targetName)
+{
+    return Utils::runAsync(workerPool(), [targetName](){
+        return targetDefaultUser(targetName);
+    });
+}
+
+QFuture<bool> LinkMotionTargetTool::targetExistsAsync(const QString &targetName)
+{
+    return Utils::runAsync(workerPool(), [targetName](){
+        return targetExists(targetName);
+    });
+}
+
+QFuture<bool> LinkMotionTargetTool::setTargetUpgradesEnabledAsync(const Target &target, const bool set)
+{
+    return Utils::runAsync(workerPool(), [target, set](){
+        return setTargetUpgradesEnabled(target, set);
+    });
+}
+
+QFuture<QString> LinkMotionTargetTool::hostArchitectureAsync()
+{
+    return Utils::runAsync(workerPool(), &LinkMotionTargetTool::hostArchitecture);
 }
 
 QString LinkMotionTargetTool::findOrCreateGccWrapper (const LinkMotionTargetTool::Target &target, const Core::Id &language)
@@ -513,32 +618,18 @@ CMakeProjectManager::CMakeTool::PathMapper LinkMotionTargetTool::mapIncludePaths
         if (!canMap)
             return in;
 
-
-        QString tmp = in.toString();
-        QString replace = QString::fromLatin1("\\1%1/\\2").arg(ProjectExplorer::SysRootKitInformation::sysRoot(t->kit()).toUserOutput());
-        QStringList pathsToMap = {
-            QLatin1String("var"),QLatin1String("bin"),QLatin1String("boot"),QLatin1String("dev"),
-            QLatin1String("etc"),QLatin1String("lib"),QLatin1String("lib64"),QLatin1String("media"),
-            QLatin1String("mnt"),QLatin1String("opt"),QLatin1String("proc"),QLatin1String("root"),
-            QLatin1String("run"),QLatin1String("sbin"),QLatin1String("srv"),QLatin1String("sys"),
-            QLatin1String("usr")
-        };
-
-        for (const QString &path : pathsToMap) {
-            QRegularExpression exp(QString::fromLatin1("(^|[^\\w+]|\\s+|[-=]\\w)\\/(%1)").arg(path));
-            tmp.replace(exp,replace);
-        }
-
-        return Utils::FileName::fromString(tmp);
+        return Internal::SysrootPathTranslator::forSysroot(ProjectExplorer::SysRootKitInformation::sysRoot(t->kit()))
+                ->toHost(in);
     };
 }
 
 QString LinkMotionTargetTool::hostArchitecture()
 {
-    static QString hostArch;
-
-    if(!hostArch.isEmpty())
-        return hostArch;
+    {
+        QMutexLocker lock(&cacheMutex);
+        if(!hostArchCache.isEmpty())
+            return hostArchCache;
+    }
 
     //change to uname -m to support other platforms besides Ubuntu
 
@@ -546,14 +637,15 @@ QString LinkMotionTargetTool::hostArchitecture()
     proc.setProgram(QStringLiteral("uname"));
     proc.setArguments(QStringList()<<QStringLiteral("-m"));
     proc.start(QIODevice::ReadOnly);
-    if (!proc.waitForFinished(3000) || proc.exitCode() != 0 || proc.exitStatus() != QProcess::NormalExit) {
+    if (!proc.waitForFinished(TARGET_TOOL_TIMEOUT) || proc.exitCode() != 0 || proc.exitStatus() != QProcess::NormalExit) {
         qWarning()<<"Could not determine the host architecture";
         return QString();
     }
 
     QTextStream in(&proc);
-    hostArch = in.readAll().simplified();
-    return hostArch;
+    QMutexLocker lock(&cacheMutex);
+    hostArchCache = in.readAll().simplified();
+    return hostArchCache;
 }
 
 bool LinkMotionTargetTool::compatibleWithHostArchitecture(const QString &targetArch)
@@ -566,25 +658,147 @@ bool LinkMotionTargetTool::compatibleWithHostArchitecture(const QString &targetA
             (QStringLiteral("x86_64") == arch && targetArch == QStringLiteral("i386")));
 }
 
-QString LinkMotionTargetTool::findOrCreateToolWrapper (const QString &tool, const LinkMotionTargetTool::Target &target)
+/*!
+ * \brief wrapperTargetForTool
+ * qmake is routed through the wrapper that answers -query from the
+ * Qt version cache, make and cmake through the wrapper passing on the
+ * job count, the host debugger through the wrapper using the gdb index
+ * cache, all other tools directly use lmsdk-wrapper
+ */
+static QString wrapperTargetForTool (const QString &tool)
 {
-    QString baseDir = Utils::FileName::fromString(targetBasePath(target)).parentDir().toString();
-    QString toolWrapper = (Utils::FileName::fromString(baseDir).appendPath(tool).toString());
-    QString toolTarget  = Internal::LinkMotionBasePlugin::lmTargetWrapper();
-
-    QFileInfo symlinkInfo(toolWrapper);
-
-    if(!symlinkInfo.exists() || toolTarget != symlinkInfo.symLinkTarget()) {
-        //in case of a broken link QFile::exists also will return false
-        //lets try to delete it and ignore the error in case the file
-        //simply does not exist
-        QFile::remove(toolWrapper);
-        if(!QFile::link(toolTarget,toolWrapper)) {
-            qWarning()<<"Unable to create link for the tool wrapper: "<<toolWrapper;
-            return QString();
+    const QString qmakeWrapper = Internal::LinkMotionQtVersion::qmakeWrapperScript();
+    if (!qmakeWrapper.isEmpty() && tool == QStringLiteral("qmake"))
+        return qmakeWrapper;
+
+    const QString makeWrapper = Internal::LinkMotionToolChain::makeWrapperScript();
+    if (!makeWrapper.isEmpty() && (tool == QStringLiteral("make") || tool == QStringLiteral("cmake")))
+        return makeWrapper;
+
+    const QString debuggerWrapper = Internal::DebugIndexCache::debuggerScript();
+    if (!debuggerWrapper.isEmpty() && tool == QLatin1String(Constants::LM_GDB_WRAPPER_NAME))
+        return debuggerWrapper;
+
+    return Internal::LinkMotionBasePlugin::lmTargetWrapper();
+}
+
+/*!
+ * \brief linkToolWrapper
+ * Makes sure \a wrapper is a link to the wrapper for \a tool, \a currentTarget
+ * is the current target of the link if there is one
+ */
+static bool linkToolWrapper (const QString &tool, const QString &wrapper, const QString &currentTarget)
+{
+    const QString toolTarget = wrapperTargetForTool(tool);
+    if (currentTarget == toolTarget)
+        return true;
+
+    //in case of a broken link QFile::exists also will return false
+    //lets try to delete it and ignore the error in case the file
+    //simply does not exist
+    QFile::remove(wrapper);
+    if(!QFile::link(toolTarget,wrapper)) {
+        qWarning()<<"Unable to create link for the tool wrapper: "<<wrapper;
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief LinkMotionTargetTool::provisionToolWrappers
+ * Creates or validates the wrapper links of all tools for \a target. The
+ * directory is read only once, links are only touched if they are missing
+ * or broken. Afterwards findOrCreateToolWrapper is a plain lookup.
+ */
+bool LinkMotionTargetTool::provisionToolWrappers(const LinkMotionTargetTool::Target &target)
+{
+    const QString rootfs = targetBasePath(target);
+    if (rootfs.isEmpty())
+        return false;
+
+    ToolWrapperManifest manifest;
+    manifest.baseDir = Utils::FileName::fromString(rootfs).parentDir().toString();
+
+    QHash<QString, QString> existingLinks;
+    const QFileInfoList entries = QDir(manifest.baseDir).entryInfoList(QDir::Files | QDir::System | QDir::NoDotAndDotDot);
+    foreach (const QFileInfo &entry, entries) {
+        if (entry.isSymLink())
+            existingLinks.insert(entry.fileName(), entry.symLinkTarget());
+    }
+
+    bool success = true;
+    for (const char *toolName : TOOL_WRAPPERS) {
+        const QString tool = QLatin1String(toolName);
+        const QString wrapper = Utils::FileName::fromString(manifest.baseDir).appendPath(tool).toString();
+        if (!linkToolWrapper(tool, wrapper, existingLinks.value(tool))) {
+            success = false;
+            continue;
         }
+        manifest.wrappers.insert(tool, wrapper);
+    }
 
+    QMutexLocker lock(&cacheMutex);
+    wrapperManifests.insert(target.containerName, manifest);
+    return success;
+}
+
+/*!
+ * \brief LinkMotionTargetTool::provisionToolWrappers
+ * Provisions the wrappers for all \a targets and forgets about
+ * the wrappers of targets that do not exist anymore
+ */
+void LinkMotionTargetTool::provisionToolWrappers(const QList<LinkMotionTargetTool::Target> &targets)
+{
+    foreach (const Target &t, targets)
+        provisionToolWrappers(t);
+
+    forgetToolWrappers(targets);
+}
+
+/*!
+ * \brief LinkMotionTargetTool::forgetToolWrappers
+ * Drops the known wrappers of all targets that are not in \a remaining
+ */
+void LinkMotionTargetTool::forgetToolWrappers(const QList<LinkMotionTargetTool::Target> &remaining)
+{
+    QSet<QString> names;
+    foreach (const Target &t, remaining)
+        names.insert(t.containerName);
+
+    QMutexLocker lock(&cacheMutex);
+    for (auto it = wrapperManifests.begin(); it != wrapperManifests.end();) {
+        if (!names.contains(it.key()))
+            it = wrapperManifests.erase(it);
+        else
+            ++it;
     }
+}
+
+QString LinkMotionTargetTool::findOrCreateToolWrapper (const QString &tool, const LinkMotionTargetTool::Target &target)
+{
+    auto lookup = [&]() {
+        QMutexLocker lock(&cacheMutex);
+        return wrapperManifests.value(target.containerName).wrappers.value(tool);
+    };
+
+    QString toolWrapper = lookup();
+    if (!toolWrapper.isEmpty())
+        return toolWrapper;
+
+    //the target was not provisioned yet
+    provisionToolWrappers(target);
+    toolWrapper = lookup();
+    if (!toolWrapper.isEmpty())
+        return toolWrapper;
+
+    //a tool that is not part of the default set
+    QString baseDir = Utils::FileName::fromString(targetBasePath(target)).parentDir().toString();
+    toolWrapper = Utils::FileName::fromString(baseDir).appendPath(tool).toString();
+    if (!linkToolWrapper(tool, toolWrapper, QFileInfo(toolWrapper).symLinkTarget()))
+        return QString();
+
+    QMutexLocker lock(&cacheMutex);
+    wrapperManifests[target.containerName].wrappers.insert(tool, toolWrapper);
     return toolWrapper;
 }
 
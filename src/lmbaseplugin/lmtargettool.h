@@ -23,6 +23,7 @@
 #include <QList>
 #include <QString>
 #include <QDialog>
+#include <QFuture>
 #include <QFutureInterface>
 #include <QQueue>
 #include <projectexplorer/processparameters.h>
@@ -40,6 +41,7 @@ class QAction;
 class QTimer;
 class QNetworkAccessManager;
 class QNetworkReply;
+class QThreadPool;
 
 namespace ProjectExplorer {
     class Project;
@@ -81,6 +83,8 @@ public:
     static QString targetBasePath (const Target& target);
     static QString targetBasePath (const QString &targetName);
     static QString targetDefaultUser (const QString &targetName);
+    static QString queryTargetBasePath (const QString &targetName);
+    static QString queryTargetDefaultUser (const QString &targetName);
 
     static bool parseContainerName (const QString &name, Target *target, QStringList *allExt = 0);
     //static bool getTargetFromUser (Target* target, const QString &framework=QString());
@@ -88,6 +92,9 @@ public:
     static QString getMostRecentFramework ( const QString &subFramework, const Target *target );
     static QString findOrCreateGccWrapper(const LinkMotionTargetTool::Target &target, const Core::Id &language);
     static QString findOrCreateToolWrapper(const QString &tool, const LinkMotionTargetTool::Target &target);
+    static bool provisionToolWrappers(const LinkMotionTargetTool::Target &target);
+    static void provisionToolWrappers(const QList<LinkMotionTargetTool::Target> &targets);
+    static void forgetToolWrappers(const QList<LinkMotionTargetTool::Target> &remaining);
     static QString findOrCreateQMakeWrapper(const LinkMotionTargetTool::Target &target);
     static QString findOrCreateMakeWrapper(const LinkMotionTargetTool::Target &target);
     static CMakeProjectManager::CMakeTool::PathMapper mapIncludePathsForCMakeFactory(const ProjectExplorer::Target *t);
@@ -101,6 +108,17 @@ public:
     static const Target *lmTargetFromTarget(ProjectExplorer::Target *t);
     static bool          setTargetUpgradesEnabled (const Target& target, const bool set = true);
 
+    //non blocking variants of the queries above, they are executed in the
+    //workerPool() and never block the GUI thread while lmsdk-target is running
+    static QFuture<QList<Target> > listAvailableTargetsAsync ();
+    static QFuture<QList<Target> > listPossibleDeviceContainersAsync ();
+    static QFuture<QString>        targetBasePathAsync (const QString &targetName);
+    static QFuture<QString>        targetDefaultUserAsync (const QString &targetName);
+    static QFuture<bool>           targetExistsAsync (const QString &targetName);
+    static QFuture<bool>           setTargetUpgradesEnabledAsync (const Target& target, const bool set = true);
+    static QFuture<QString>        hostArchitectureAsync ();
+    static QThreadPool *workerPool ();
+
     static ProjectExplorer::ProcessParameters prepareToRunInTarget (ProjectExplorer::Kit *target, const QString &cmd,
                                                                     const QStringList &args, const QString &wd,
                                                                     const QMap<QString, QString> &envMap = QMap<QString, QString>() );
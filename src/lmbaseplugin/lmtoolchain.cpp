@@ -19,16 +19,24 @@
 
 #include "lmtoolchain.h"
 #include "lmbaseplugin_constants.h"
+#include "lmtargetregistry.h"
+#include "sysrootpathtranslator.h"
+#include "toolchainprobecache.h"
+#include "debugindexcache.h"
+#include "lmtargettool.h"
 
 #include <utils/fileutils.h>
 #include <utils/algorithm.h>
 #include <projectexplorer/abi.h>
 #include <projectexplorer/projectexplorerconstants.h>
 #include <QDebug>
+#include <QDataStream>
 #include <QVariant>
 #include <QVariantMap>
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
+#include <QPair>
 
 namespace LmBase {
 namespace Internal {
@@ -84,8 +92,19 @@ QList<Utils::FileName> LinkMotionToolChain::suggestedMkspecList() const
     return ProjectExplorer::GccToolChain::suggestedMkspecList();
 }
 
+/*!
+ * \brief LinkMotionToolChain::suggestedDebugger
+ * Returns the debugger wrapper of the target, it lets gdb
+ * use the index cache of the target
+ */
 Utils::FileName LinkMotionToolChain::suggestedDebugger() const
 {
+    if (!DebugIndexCache::debuggerScript().isEmpty()) {
+        const QString wrapper = LinkMotionTargetTool::findOrCreateToolWrapper(
+                    QLatin1String(Constants::LM_GDB_WRAPPER_NAME), m_lmTarget);
+        if (!wrapper.isEmpty())
+            return Utils::FileName::fromString(wrapper);
+    }
     return Utils::FileName::fromString(QLatin1String("/usr/bin/gdb-multiarch"));
 }
 
@@ -96,7 +115,12 @@ QString LinkMotionToolChain::typeDisplayName() const
 
 bool LinkMotionToolChain::isValid() const
 {
-    return GccToolChain::isValid() && targetAbi().isValid() && LinkMotionTargetTool::targetExists(m_lmTarget);
+    //toolchains are restored before the registry exists and can outlive it
+    TargetRegistry *registry = TargetRegistry::instance();
+    return GccToolChain::isValid()
+            && targetAbi().isValid()
+            && registry
+            && registry->isAvailable(m_lmTarget.containerName);
 }
 
 void LinkMotionToolChain::addToEnvironment(Utils::Environment &env) const
@@ -109,6 +133,21 @@ QString LinkMotionToolChain::makeCommand(const Utils::Environment &) const
     return LinkMotionTargetTool::findOrCreateMakeWrapper(lmTarget());
 }
 
+/*!
+ * \brief LinkMotionToolChain::makeWrapperScript
+ * Returns the script used as make and cmake wrapper, or a empty
+ * string if it is not installed
+ */
+QString LinkMotionToolChain::makeWrapperScript()
+{
+    //the wrappers are provisioned from the worker threads
+    static const QString script = [](){
+        QFileInfo info(QString::fromLatin1(Constants::LM_MAKE_WRAPPER_SCRIPT).arg(Constants::LM_SCRIPTPATH));
+        return info.isExecutable() ? info.absoluteFilePath() : QString();
+    }();
+    return script;
+}
+
 bool LinkMotionToolChain::operator ==(const ProjectExplorer::ToolChain &tc) const
 {
     if (!GccToolChain::operator ==(tc))
@@ -168,6 +207,98 @@ QVariantMap LinkMotionToolChain::toMap() const
     return map;
 }
 
+/*!
+ * \brief LinkMotionToolChain::createPredefinedMacrosRunner
+ * The macros are probed only once per compiler and flags, results are
+ * shared by all toolchains of targets using the same image
+ */
+ProjectExplorer::ToolChain::PredefinedMacrosRunner LinkMotionToolChain::createPredefinedMacrosRunner() const
+{
+    const PredefinedMacrosRunner runner = GccToolChain::createPredefinedMacrosRunner();
+    const QString key = probeCacheKey();
+
+    if (key.isEmpty())
+        return runner;
+
+    return [runner, key](const QStringList &cxxflags) {
+        //the runners can outlive the plugin
+        ToolChainProbeCache *cache = ToolChainProbeCache::instance();
+        if (!cache)
+            return runner(cxxflags);
+
+        QByteArray macros;
+        if (cache->lookup(key, ToolChainProbeCache::PredefinedMacros, cxxflags, &macros))
+            return macros;
+
+        macros = runner(cxxflags);
+        if (!macros.isEmpty())
+            cache->insert(key, ToolChainProbeCache::PredefinedMacros, cxxflags, macros);
+        return macros;
+    };
+}
+
+QByteArray LinkMotionToolChain::predefinedMacros(const QStringList &cxxflags) const
+{
+    return createPredefinedMacrosRunner()(cxxflags);
+}
+
+/*!
+ * \brief LinkMotionToolChain::createSystemHeaderPathsRunner
+ * Like createPredefinedMacrosRunner, paths inside the sysroot are stored
+ * as container paths, so the results can be used with every target
+ */
+ProjectExplorer::ToolChain::SystemHeaderPathsRunner LinkMotionToolChain::createSystemHeaderPathsRunner() const
+{
+    const SystemHeaderPathsRunner runner = GccToolChain::createSystemHeaderPathsRunner();
+    const QString key = probeCacheKey();
+
+    if (key.isEmpty())
+        return runner;
+
+    return [runner, key](const QStringList &cxxflags, const QString &sysRoot) {
+        ToolChainProbeCache *cache = ToolChainProbeCache::instance();
+        if (!cache)
+            return runner(cxxflags, sysRoot);
+
+        QStringList flags = cxxflags;
+        SysrootPathTranslator::Ptr translator;
+        if (!sysRoot.isEmpty()) {
+            flags.append(QStringLiteral("--sysroot"));
+            translator = SysrootPathTranslator::forSysroot(Utils::FileName::fromString(sysRoot));
+        }
+
+        QList<ProjectExplorer::HeaderPath> paths;
+        QByteArray cached;
+        if (cache->lookup(key, ToolChainProbeCache::SystemHeaderPaths, flags, &cached)) {
+            QDataStream in(cached);
+            while (!in.atEnd()) {
+                qint32 kind;
+                QString path;
+                in >> kind >> path;
+                if (translator)
+                    path = translator->toHost(path);
+                paths.append(ProjectExplorer::HeaderPath(path, ProjectExplorer::HeaderPath::Kind(kind)));
+            }
+            return paths;
+        }
+
+        paths = runner(cxxflags, sysRoot);
+        if (paths.isEmpty())
+            return paths;
+
+        QDataStream out(&cached, QIODevice::WriteOnly);
+        foreach (const ProjectExplorer::HeaderPath &path, paths)
+            out << qint32(path.kind()) << (translator ? translator->toContainer(path.path()) : path.path());
+        cache->insert(key, ToolChainProbeCache::SystemHeaderPaths, flags, cached);
+        return paths;
+    };
+}
+
+QList<ProjectExplorer::HeaderPath> LinkMotionToolChain::systemHeaderPaths(const QStringList &cxxflags, const Utils::FileName &sysRoot) const
+{
+    return createSystemHeaderPathsRunner()(cxxflags, sysRoot.toString());
+}
+
 QString LinkMotionToolChain::gnutriplet() const
 {
     return gnutriplet(targetAbi());
@@ -211,7 +342,72 @@ bool LinkMotionToolChain::fromMap(const QVariantMap &data)
 
     m_lmTarget.architecture  = data[LM_TARGET_ARCH_KEY].toString();
     m_lmTarget.containerName = data[LM_TARGET_CONTAINER_KEY].toString();
-    return isValid();
+
+    //checking if the target still exists would block the GUI thread,
+    //toolchains of removed targets are cleaned up by LinkMotionKitManager::autoDetectKits
+    return GccToolChain::isValid() && targetAbi().isValid();
+}
+
+ProjectExplorer::GccToolChain::DetectedAbisResult LinkMotionToolChain::detectSupportedAbis() const
+{
+    const QString key = probeCacheKey();
+    if (key.isEmpty())
+        return GccToolChain::detectSupportedAbis();
+
+    const QStringList flags = platformCodeGenFlags();
+
+    QByteArray cached;
+    if (ToolChainProbeCache::instance()->lookup(key, ToolChainProbeCache::SupportedAbis, flags, &cached)) {
+        QStringList abis;
+        DetectedAbisResult result;
+        QDataStream in(cached);
+        in >> abis >> result.originalTargetTriple;
+        foreach (const QString &abi, abis)
+            result.supportedAbis.append(ProjectExplorer::Abi::fromString(abi));
+        return result;
+    }
+
+    const DetectedAbisResult result = GccToolChain::detectSupportedAbis();
+    if (result.supportedAbis.isEmpty())
+        return result;
+
+    QStringList abis;
+    foreach (const ProjectExplorer::Abi &abi, result.supportedAbis)
+        abis.append(abi.toString());
+
+    QDataStream out(&cached, QIODevice::WriteOnly);
+    out << abis << result.originalTargetTriple;
+    ToolChainProbeCache::instance()->insert(key, ToolChainProbeCache::SupportedAbis, flags, cached);
+    return result;
+}
+
+QString LinkMotionToolChain::detectVersion() const
+{
+    const QString key = probeCacheKey();
+    if (key.isEmpty())
+        return GccToolChain::detectVersion();
+
+    QByteArray cached;
+    if (ToolChainProbeCache::instance()->lookup(key, ToolChainProbeCache::CompilerVersion, QStringList(), &cached))
+        return QString::fromUtf8(cached);
+
+    const QString version = GccToolChain::detectVersion();
+    if (!version.isEmpty())
+        ToolChainProbeCache::instance()->insert(key, ToolChainProbeCache::CompilerVersion, QStringList(), version.toUtf8());
+    return version;
+}
+
+/*!
+ * \brief LinkMotionToolChain::probeCacheKey
+ * Key of the compiler inside the target in the ToolChainProbeCache, empty
+ * if the target is not known yet or the plugin is already shut down,
+ * which disables the cache
+ */
+QString LinkMotionToolChain::probeCacheKey() const
+{
+    if (!ToolChainProbeCache::instance() || m_lmTarget.containerName.isEmpty() || compilerCommand().isEmpty())
+        return QString();
+    return ToolChainProbeCache::instance()->compilerKey(m_lmTarget.containerName, remoteCompilerCommand());
 }
 
 Utils::FileName LinkMotionToolChain::compilerCommand() const
@@ -252,7 +448,12 @@ LinkMotionToolChainFactory::LinkMotionToolChainFactory()
 QList<ProjectExplorer::ToolChain *> LinkMotionToolChainFactory::autoDetect(
         const QList<ProjectExplorer::ToolChain *> &alreadyKnown)
 {
-    return createToolChainsForLMTargets(alreadyKnown);
+    //listing the targets would block the GUI thread, so only the already known
+    //toolchains are kept here. New targets are picked up asynchronously
+    //by LinkMotionKitManager::autoDetectKits, which registers their toolchains
+    return Utils::filtered(alreadyKnown, [](ProjectExplorer::ToolChain *tc) {
+        return tc->typeId() == Constants::LM_TARGET_TOOLCHAIN_ID;
+    });
 }
 
 bool LinkMotionToolChainFactory::canRestore(const QVariantMap &data)
@@ -275,11 +476,19 @@ QSet<Core::Id> LinkMotionToolChainFactory::supportedLanguages() const
     return {ProjectExplorer::Constants::CXX_LANGUAGE_ID};
 }
 
-QList<ProjectExplorer::ToolChain *> LinkMotionToolChainFactory::createToolChainsForLMTargets(const QList<ProjectExplorer::ToolChain *> &alreadyKnown)
+QList<ProjectExplorer::ToolChain *> LinkMotionToolChainFactory::createToolChainsForLMTargets(const QList<LinkMotionTargetTool::Target> &targets,
+                                                                                               const QList<ProjectExplorer::ToolChain *> &alreadyKnown)
 {
     QList<ProjectExplorer::ToolChain*> toolChains;
 
-    QList<LinkMotionTargetTool::Target> targets = LinkMotionTargetTool::listAvailableTargets();
+    QHash<QPair<QString, Core::Id>, ProjectExplorer::ToolChain *> known;
+    foreach (ProjectExplorer::ToolChain *tc, alreadyKnown) {
+        if (tc->typeId() != Constants::LM_TARGET_TOOLCHAIN_ID)
+            continue;
+        auto lmTc = static_cast<LinkMotionToolChain *>(tc);
+        known.insert(qMakePair(lmTc->lmTarget().containerName, lmTc->language()), tc);
+    }
+
     foreach(const LinkMotionTargetTool::Target &target, targets) {
         if(debug) qDebug()<<"Found Target"<<target;
 
@@ -291,15 +500,7 @@ QList<ProjectExplorer::ToolChain *> LinkMotionToolChainFactory::createToolChains
             if(comp.isEmpty())
                 return;
 
-            auto predicate = [&](ProjectExplorer::ToolChain *tc) {
-                if (tc->typeId() != Constants::LM_TARGET_TOOLCHAIN_ID)
-                    return false;
-                auto lmTc = static_cast<LinkMotionToolChain *>(tc);
-                return lmTc->lmTarget().containerName == target.containerName &&
-                        lmTc->language() == language;
-            };
-
-            ProjectExplorer::ToolChain *tc = Utils::findOrDefault(alreadyKnown, predicate);
+            ProjectExplorer::ToolChain *tc = known.value(qMakePair(target.containerName, language));
             if (!tc)
                 tc = new LinkMotionToolChain(target, language, ProjectExplorer::ToolChain::AutoDetection);
             toolChains.append(tc);
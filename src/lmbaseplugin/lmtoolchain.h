@@ -52,6 +52,11 @@ public:
     virtual ProjectExplorer::ToolChainConfigWidget *configurationWidget() override;
     virtual QVariantMap toMap() const override;
 
+    virtual PredefinedMacrosRunner createPredefinedMacrosRunner() const override;
+    virtual QByteArray predefinedMacros(const QStringList &cxxflags) const override;
+    virtual SystemHeaderPathsRunner createSystemHeaderPathsRunner() const override;
+    virtual QList<ProjectExplorer::HeaderPath> systemHeaderPaths(const QStringList &cxxflags, const Utils::FileName &sysRoot) const override;
+
     QString gnutriplet () const;
     static QString gnutriplet (const ProjectExplorer::Abi &abi);
     const LinkMotionTargetTool::Target &lmTarget () const;
@@ -60,15 +65,21 @@ public:
     static QString abiToArchitectureName ( const ProjectExplorer::Abi &abi );
     static QList<QString> supportedArchitectures ();
     static bool supportsArchitecture (const QString &arch);
+    static QString makeWrapperScript ();
 
     QString remoteCompilerCommand () const;
 
 protected:
     virtual bool fromMap(const QVariantMap &data) override;
+    virtual DetectedAbisResult detectSupportedAbis() const override;
+    virtual QString detectVersion() const override;
 
     LinkMotionToolChain(const LinkMotionToolChain& other);
     LinkMotionToolChain();
 
+private:
+    QString probeCacheKey () const;
+
 private:
     LinkMotionTargetTool::Target m_lmTarget;
 
@@ -90,7 +101,8 @@ public:
     virtual ProjectExplorer::ToolChain *restore(const QVariantMap &data) override;
     virtual QSet<Core::Id> supportedLanguages() const override;
 
-    static QList<ProjectExplorer::ToolChain *> createToolChainsForLMTargets(const QList<ProjectExplorer::ToolChain *> &alreadyKnown);
+    static QList<ProjectExplorer::ToolChain *> createToolChainsForLMTargets(const QList<LinkMotionTargetTool::Target> &targets,
+                                                                          const QList<ProjectExplorer::ToolChain *> &alreadyKnown);
 };
 
 } // namespace Internal
@@ -0,0 +1,12 @@
+HEADERS += \
+    $$PWD/lxdclient.h \
+    $$PWD/lxdeventmonitor.h
+
+SOURCES += \
+    $$PWD/lxdclient.cpp \
+    $$PWD/lxdeventmonitor.cpp
+
+equals(TEST, 1) {
+    HEADERS += $$PWD/lxdclienttest.h
+    SOURCES += $$PWD/lxdclienttest.cpp
+}
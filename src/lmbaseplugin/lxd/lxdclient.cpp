@@ -0,0 +1,501 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#include "lxdclient.h"
+
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocalSocket>
+#include <QUrl>
+#include <QDebug>
+
+namespace LmBase {
+namespace Internal {
+
+enum {
+    debug = 0
+};
+
+const char LXD_SOCKET_ENV[] = "LMSDK_LXD_SOCKET";
+
+/*!
+ * \brief decodeChunked
+ * Decodes a HTTP body that was sent with chunked transfer encoding into
+ * \a result. Returns true once the last chunk and the trailer were received,
+ * data ending with bytes that only look like the last chunk is not complete.
+ */
+static bool decodeChunked (const QByteArray &data, QByteArray *result)
+{
+    result->clear();
+
+    int pos = 0;
+    forever {
+        const int lineEnd = data.indexOf("\r\n", pos);
+        if (lineEnd < 0)
+            return false;
+
+        QByteArray sizeLine = data.mid(pos, lineEnd - pos);
+        const int extIdx = sizeLine.indexOf(';');
+        if (extIdx >= 0)
+            sizeLine.truncate(extIdx);
+
+        bool ok = false;
+        const int chunkSize = sizeLine.trimmed().toInt(&ok, 16);
+        if (!ok || chunkSize < 0)
+            return false;
+
+        pos = lineEnd + 2;
+        if (chunkSize == 0) {
+            //the trailer ends with a empty line
+            if (data.mid(pos, 2) == "\r\n")
+                return true;
+            return data.indexOf("\r\n\r\n", pos) >= 0;
+        }
+
+        if (data.size() < pos + chunkSize + 2)
+            return false;
+
+        result->append(data.mid(pos, chunkSize));
+        pos += chunkSize + 2;
+    }
+}
+
+bool LxdClient::Response::isValid() const
+{
+    return httpStatus >= 200 && httpStatus < 300
+            && document.value(QStringLiteral("type")).toString() != QStringLiteral("error");
+}
+
+QJsonValue LxdClient::Response::metadata() const
+{
+    return document.value(QStringLiteral("metadata"));
+}
+
+LxdClient::LxdClient(const QString &socketPath)
+    : m_socketPath(socketPath)
+{
+}
+
+/*!
+ * \brief LxdClient::defaultSocketPath
+ * Returns the LXD socket, LMSDK_LXD_SOCKET and LXD_DIR are respected
+ */
+QString LxdClient::defaultSocketPath()
+{
+    const QString overridePath = QString::fromLocal8Bit(qgetenv(LXD_SOCKET_ENV));
+    if (!overridePath.isEmpty())
+        return overridePath;
+
+    QStringList candidates;
+    const QString lxdDir = QString::fromLocal8Bit(qgetenv("LXD_DIR"));
+    if (!lxdDir.isEmpty())
+        candidates << lxdDir + QStringLiteral("/unix.socket");
+    candidates << QStringLiteral("/var/lib/lxd/unix.socket")
+               << QStringLiteral("/var/snap/lxd/common/lxd/unix.socket");
+
+    foreach (const QString &candidate, candidates) {
+        if (QFileInfo::exists(candidate))
+            return candidate;
+    }
+    return candidates.first();
+}
+
+/*!
+ * \brief LxdClient::isAvailable
+ * Returns true if the LXD socket exists and the current user may use it
+ */
+bool LxdClient::isAvailable()
+{
+    QFileInfo info(defaultSocketPath());
+    return info.exists() && info.isWritable();
+}
+
+QString LxdClient::socketPath() const
+{
+    return m_socketPath;
+}
+
+QString LxdClient::errorString() const
+{
+    return m_errorString;
+}
+
+LxdClient::Response LxdClient::get(const QString &path, int timeout)
+{
+    int status = 0;
+    QByteArray body;
+    if (!request("GET", path, QByteArray(), &status, &body, timeout))
+        return Response();
+    return toResponse(status, body);
+}
+
+LxdClient::Response LxdClient::post(const QString &path, const QJsonObject &body, int timeout)
+{
+    int status = 0;
+    QByteArray responseBody;
+    if (!request("POST", path, QJsonDocument(body).toJson(QJsonDocument::Compact), &status, &responseBody, timeout))
+        return Response();
+    return toResponse(status, responseBody);
+}
+
+LxdClient::Response LxdClient::deleteResource(const QString &path, int timeout)
+{
+    int status = 0;
+    QByteArray body;
+    if (!request("DELETE", path, QByteArray(), &status, &body, timeout))
+        return Response();
+    return toResponse(status, body);
+}
+
+/*!
+ * \brief LxdClient::getRaw
+ * Fetches \a path without interpreting the body, e.g. for log files
+ */
+bool LxdClient::getRaw(const QString &path, QByteArray *data, int timeout)
+{
+    int status = 0;
+    if (!request("GET", path, QByteArray(), &status, data, timeout))
+        return false;
+    if (status < 200 || status >= 300) {
+        m_errorString = QStringLiteral("GET %1 returned HTTP status %2").arg(path).arg(status);
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief LxdClient::containerExists
+ * Sets \a exists to true if \a containerName is known to LXD, returns
+ * false if LXD could not be asked
+ */
+bool LxdClient::containerExists(const QString &containerName, bool *exists)
+{
+    Response resp = get(containerPath(containerName));
+    if (resp.httpStatus == 404) {
+        *exists = false;
+        return true;
+    }
+    if (!resp.isValid())
+        return false;
+
+    *exists = true;
+    return true;
+}
+
+/*!
+ * \brief LxdClient::containerState
+ * Queries the status and the global IPv4 address of \a containerName
+ */
+bool LxdClient::containerState(const QString &containerName, LxdClient::ContainerState *state)
+{
+    Response resp = get(containerPath(containerName) + QStringLiteral("/state"));
+    if (!resp.isValid())
+        return false;
+
+    const QJsonObject meta = resp.metadata().toObject();
+    state->status = meta.value(QStringLiteral("status")).toString();
+    state->ipv4.clear();
+
+    const QJsonObject network = meta.value(QStringLiteral("network")).toObject();
+    for (auto it = network.constBegin(); it != network.constEnd() && state->ipv4.isEmpty(); ++it) {
+        if (it.key() == QStringLiteral("lo"))
+            continue;
+
+        foreach (const QJsonValue &addr, it.value().toObject().value(QStringLiteral("addresses")).toArray()) {
+            const QJsonObject obj = addr.toObject();
+            if (obj.value(QStringLiteral("family")).toString() == QStringLiteral("inet")
+                    && obj.value(QStringLiteral("scope")).toString() == QStringLiteral("global")) {
+                state->ipv4 = obj.value(QStringLiteral("address")).toString();
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+/*!
+ * \brief LxdClient::containerCpuLimit
+ * Reads the number of CPUs \a containerName is allowed to use from its
+ * limits.cpu config key, \a cpus is set to 0 if the container is not limited
+ */
+bool LxdClient::containerCpuLimit(const QString &containerName, int *cpus)
+{
+    Response resp = get(containerPath(containerName));
+    if (!resp.isValid())
+        return false;
+
+    const QString limit = resp.metadata().toObject()
+            .value(QStringLiteral("expanded_config")).toObject()
+            .value(QStringLiteral("limits.cpu")).toString().trimmed();
+
+    *cpus = parseCpuLimit(limit);
+    return true;
+}
+
+/*!
+ * \brief LxdClient::parseCpuLimit
+ * limits.cpu is either a plain CPU count or a cpuset like "0-3,6"
+ */
+int LxdClient::parseCpuLimit(const QString &limit)
+{
+    if (limit.isEmpty())
+        return 0;
+
+    bool ok = false;
+    const int count = limit.toInt(&ok);
+    if (ok)
+        return qMax(count, 0);
+
+    int cpus = 0;
+    foreach (const QString &part, limit.split(QLatin1Char(','), QString::SkipEmptyParts)) {
+        const QStringList range = part.split(QLatin1Char('-'));
+        if (range.size() == 1) {
+            cpus++;
+        } else if (range.size() == 2) {
+            const int first = range.at(0).trimmed().toInt();
+            const int last  = range.at(1).trimmed().toInt();
+            if (last >= first)
+                cpus += last - first + 1;
+        }
+    }
+    return cpus;
+}
+
+/*!
+ * \brief LxdClient::exec
+ * Runs \a command as root inside \a containerName and waits for it to finish.
+ * LXD records the output, so no websocket is required for non interactive commands.
+ */
+bool LxdClient::exec(const QString &containerName, const QStringList &command,
+                     QByteArray *standardOutput, int *exitCode, int timeout)
+{
+    QJsonObject body;
+    body.insert(QStringLiteral("command"), QJsonArray::fromStringList(command));
+    body.insert(QStringLiteral("interactive"), false);
+    body.insert(QStringLiteral("wait-for-websocket"), false);
+    body.insert(QStringLiteral("record-output"), true);
+
+    Response resp = post(containerPath(containerName) + QStringLiteral("/exec"), body);
+    if (!resp.isValid())
+        return false;
+
+    const QString operation = resp.document.value(QStringLiteral("operation")).toString();
+    if (operation.isEmpty()) {
+        m_errorString = QStringLiteral("LXD did not return a operation for exec");
+        return false;
+    }
+
+    resp = get(QStringLiteral("%1/wait?timeout=%2").arg(operation).arg(qMax(1, timeout / 1000)), timeout + 1000);
+    if (!resp.isValid())
+        return false;
+
+    const QJsonObject opMeta = resp.metadata().toObject().value(QStringLiteral("metadata")).toObject();
+    if (exitCode)
+        *exitCode = opMeta.value(QStringLiteral("return")).toInt(-1);
+
+    //LXD keeps the recorded output until it is removed
+    const QJsonObject output = opMeta.value(QStringLiteral("output")).toObject();
+    bool success = true;
+    for (auto it = output.constBegin(); it != output.constEnd(); ++it) {
+        const QString log = it.value().toString();
+        if (standardOutput && it.key() == QStringLiteral("1"))
+            success = getRaw(log, standardOutput);
+        deleteResource(log);
+    }
+
+    return success;
+}
+
+QString LxdClient::containerPath(const QString &containerName)
+{
+    return QStringLiteral("/1.0/containers/%1")
+            .arg(QString::fromLatin1(QUrl::toPercentEncoding(containerName)));
+}
+
+QByteArray LxdClient::buildRequest(const QByteArray &method, const QString &path, const QByteArray &body,
+                                   const QList<QPair<QByteArray, QByteArray> > &extraHeaders)
+{
+    QByteArray req = method + ' ' + path.toUtf8() + " HTTP/1.1\r\n";
+    req += "Host: lxd\r\n";
+
+    bool hasConnectionHeader = false;
+    for (const auto &header : extraHeaders) {
+        if (header.first.toLower() == "connection")
+            hasConnectionHeader = true;
+        req += header.first + ": " + header.second + "\r\n";
+    }
+    if (!hasConnectionHeader)
+        req += "Connection: close\r\n";
+
+    if (!body.isEmpty()) {
+        req += "Content-Type: application/json\r\n";
+        req += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    }
+
+    req += "\r\n";
+    req += body;
+    return req;
+}
+
+/*!
+ * \brief LxdClient::parseResponseHeader
+ * Parses the status line and headers of a HTTP response, header
+ * names are returned in lower case
+ */
+bool LxdClient::parseResponseHeader(const QByteArray &header, int *httpStatus,
+                                    QList<QPair<QByteArray, QByteArray> > *headers)
+{
+    const QList<QByteArray> lines = header.split('\n');
+    if (lines.isEmpty())
+        return false;
+
+    const QList<QByteArray> statusLine = lines.first().trimmed().split(' ');
+    if (statusLine.size() < 2 || !statusLine.first().startsWith("HTTP/"))
+        return false;
+
+    bool ok = false;
+    *httpStatus = statusLine.at(1).toInt(&ok);
+    if (!ok)
+        return false;
+
+    if (headers) {
+        for (int i = 1; i < lines.size(); i++) {
+            const QByteArray line = lines.at(i).trimmed();
+            int sep = line.indexOf(':');
+            if (sep <= 0)
+                continue;
+            headers->append(qMakePair(line.left(sep).trimmed().toLower(), line.mid(sep + 1).trimmed()));
+        }
+    }
+    return true;
+}
+
+bool LxdClient::connectSocket(QLocalSocket *socket, int timeout)
+{
+    socket->connectToServer(m_socketPath);
+    if (!socket->waitForConnected(timeout)) {
+        m_errorString = QStringLiteral("Could not connect to %1: %2")
+                .arg(m_socketPath)
+                .arg(socket->errorString());
+        return false;
+    }
+    return true;
+}
+
+bool LxdClient::request(const QByteArray &method, const QString &path, const QByteArray &body,
+                        int *httpStatus, QByteArray *responseBody, int timeout)
+{
+    m_errorString.clear();
+
+    QLocalSocket socket;
+    if (!connectSocket(&socket, timeout))
+        return false;
+
+    socket.write(buildRequest(method, path, body));
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QByteArray data;
+    int headerEnd = -1;
+    qint64 contentLength = -1;
+    bool chunked = false;
+    QList<QPair<QByteArray, QByteArray> > headers;
+    QByteArray chunkedBody;
+
+    forever {
+        const qint64 remaining = timeout - timer.elapsed();
+        if (remaining <= 0) {
+            m_errorString = QStringLiteral("%1 %2 timed out").arg(QString::fromLatin1(method)).arg(path);
+            return false;
+        }
+
+        const bool gotData = socket.waitForReadyRead(remaining);
+        data += socket.readAll();
+
+        if (headerEnd < 0) {
+            headerEnd = data.indexOf("\r\n\r\n");
+            if (headerEnd >= 0) {
+                if (!parseResponseHeader(data.left(headerEnd), httpStatus, &headers)) {
+                    m_errorString = QStringLiteral("Invalid response from LXD for %1").arg(path);
+                    return false;
+                }
+                for (const auto &header : headers) {
+                    if (header.first == "content-length")
+                        contentLength = header.second.toLongLong();
+                    else if (header.first == "transfer-encoding" && header.second.toLower().contains("chunked"))
+                        chunked = true;
+                }
+            }
+        }
+
+        if (headerEnd >= 0) {
+            const qint64 bodySize = data.size() - headerEnd - 4;
+            if (contentLength >= 0 && bodySize >= contentLength)
+                break;
+            if (chunked && decodeChunked(data.mid(headerEnd + 4), &chunkedBody))
+                break;
+        }
+
+        if (!gotData && socket.state() != QLocalSocket::ConnectedState)
+            break;
+    }
+
+    if (headerEnd < 0) {
+        m_errorString = QStringLiteral("LXD closed the connection for %1").arg(path);
+        return false;
+    }
+
+    QByteArray responseData = data.mid(headerEnd + 4);
+    if (chunked) {
+        //a connection closed early leaves the complete chunks only
+        decodeChunked(responseData, &chunkedBody);
+        responseData = chunkedBody;
+    } else if (contentLength >= 0) {
+        responseData.truncate(contentLength);
+    }
+
+    if (debug) qDebug()<<"LXD"<<method<<path<<*httpStatus<<responseData.size()<<"bytes";
+
+    if (responseBody)
+        *responseBody = responseData;
+    return true;
+}
+
+LxdClient::Response LxdClient::toResponse(int httpStatus, const QByteArray &body)
+{
+    Response resp;
+    resp.httpStatus = httpStatus;
+
+    QJsonParseError err;
+    QJsonDocument doc = QJsonDocument::fromJson(body, &err);
+    if (err.error != QJsonParseError::NoError || !doc.isObject()) {
+        m_errorString = QStringLiteral("Could not parse the LXD response: %1").arg(err.errorString());
+        return resp;
+    }
+
+    resp.document = doc.object();
+    if (!resp.isValid())
+        m_errorString = resp.document.value(QStringLiteral("error")).toString();
+    return resp;
+}
+
+} // namespace Internal
+} // namespace LmBase
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#ifndef LMBASE_INTERNAL_LXDCLIENT_H
+#define LMBASE_INTERNAL_LXDCLIENT_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+
+QT_BEGIN_NAMESPACE
+class QLocalSocket;
+QT_END_NAMESPACE
+
+namespace LmBase {
+namespace Internal {
+
+/*!
+ * \brief The LxdClient class
+ * Minimal client for the LXD REST API, talking directly to the LXD
+ * unix socket. All calls are blocking, so they should only be used
+ * from the LinkMotionTargetTool::workerPool(). Callers are expected
+ * to fall back to lmsdk-target if a call fails.
+ *
+ * The socket can be overridden with the LMSDK_LXD_SOCKET environment
+ * variable, e.g. to point the client to a mock server.
+ */
+class LxdClient
+{
+public:
+    struct Response {
+        int httpStatus = 0;
+        QJsonObject document;
+
+        bool isValid () const;
+        QJsonValue metadata () const;
+    };
+
+    struct ContainerState {
+        QString status;
+        QString ipv4;
+    };
+
+    explicit LxdClient(const QString &socketPath = defaultSocketPath());
+
+    static QString defaultSocketPath ();
+    static bool isAvailable ();
+
+    QString socketPath () const;
+    QString errorString () const;
+
+    Response get (const QString &path, int timeout = DEFAULT_TIMEOUT);
+    Response post (const QString &path, const QJsonObject &body, int timeout = DEFAULT_TIMEOUT);
+    Response deleteResource (const QString &path, int timeout = DEFAULT_TIMEOUT);
+    bool getRaw (const QString &path, QByteArray *data, int timeout = DEFAULT_TIMEOUT);
+
+    bool containerExists (const QString &containerName, bool *exists);
+    bool containerState (const QString &containerName, ContainerState *state);
+    bool containerCpuLimit (const QString &containerName, int *cpus);
+    bool exec (const QString &containerName, const QStringList &command,
+               QByteArray *standardOutput = nullptr, int *exitCode = nullptr,
+               int timeout = DEFAULT_EXEC_TIMEOUT);
+
+    static QString containerPath (const QString &containerName);
+    static int parseCpuLimit (const QString &limit);
+
+    static QByteArray buildRequest (const QByteArray &method, const QString &path,
+                                    const QByteArray &body = QByteArray(),
+                                    const QList<QPair<QByteArray, QByteArray> > &extraHeaders
+                                        = QList<QPair<QByteArray, QByteArray> >());
+    static bool parseResponseHeader (const QByteArray &header, int *httpStatus,
+                                     QList<QPair<QByteArray, QByteArray> > *headers);
+
+    enum {
+        DEFAULT_TIMEOUT = 3000,
+        DEFAULT_EXEC_TIMEOUT = 30000
+    };
+
+private:
+    bool request (const QByteArray &method, const QString &path, const QByteArray &body,
+                  int *httpStatus, QByteArray *responseBody, int timeout);
+    Response toResponse (int httpStatus, const QByteArray &body);
+    bool connectSocket (QLocalSocket *socket, int timeout);
+
+private:
+    QString m_socketPath;
+    QString m_errorString;
+};
+
+} // namespace Internal
+} // namespace LmBase
+
+#endif // LMBASE_INTERNAL_LXDCLIENT_H
@@ -0,0 +1,401 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#include "lxdclienttest.h"
+#include "lxdclient.h"
+#include "lxdeventmonitor.h"
+
+#include <QHash>
+#include <QJsonDocument>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTest>
+
+namespace LmBase {
+namespace Internal {
+
+//some responses are sent in pieces to test the body decoding
+const int PART_DELAY = 100;
+
+struct CannedResponse {
+    int status = 200;
+    bool chunked = false;
+    QList<QByteArray> parts;
+};
+
+/*!
+ * \brief The MockLxdServer class
+ * Answers requests with the response registered for their request line,
+ * e.g. "GET /1.0/containers/foo", unknown requests get a 404
+ */
+class MockLxdServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MockLxdServer (const QString &socketPath)
+        : m_socketPath(socketPath)
+    {
+    }
+
+    void setResponse (const QByteArray &requestLine, const CannedResponse &response)
+    {
+        QMutexLocker lock(&m_mutex);
+        m_responses.insert(requestLine, response);
+    }
+
+    void reset ()
+    {
+        QMutexLocker lock(&m_mutex);
+        m_responses.clear();
+        m_requests.clear();
+    }
+
+    QList<QByteArray> requests () const
+    {
+        QMutexLocker lock(&m_mutex);
+        return m_requests;
+    }
+
+public slots:
+    bool listen ()
+    {
+        m_server = new QLocalServer(this);
+        connect(m_server, &QLocalServer::newConnection, this, &MockLxdServer::handleNewConnection);
+        return m_server->listen(m_socketPath);
+    }
+
+    void close ()
+    {
+        delete m_server;
+        m_server = nullptr;
+    }
+
+private:
+    void handleNewConnection ()
+    {
+        while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+            connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+                handleReadyRead(socket);
+            });
+            connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+        }
+    }
+
+    void handleReadyRead (QLocalSocket *socket)
+    {
+        QByteArray &data = m_buffers[socket];
+        data += socket->readAll();
+
+        const int headerEnd = data.indexOf("\r\n\r\n");
+        if (headerEnd < 0)
+            return;
+
+        int contentLength = 0;
+        foreach (const QByteArray &line, data.left(headerEnd).split('\n')) {
+            if (line.toLower().startsWith("content-length:"))
+                contentLength = line.mid(15).trimmed().toInt();
+        }
+        if (data.size() < headerEnd + 4 + contentLength)
+            return;
+
+        const QList<QByteArray> requestLine = data.left(data.indexOf("\r\n")).split(' ');
+        m_buffers.remove(socket);
+
+        const QByteArray key = requestLine.value(0) + ' ' + requestLine.value(1);
+        CannedResponse response;
+        {
+            QMutexLocker lock(&m_mutex);
+            m_requests.append(key);
+            if (m_responses.contains(key)) {
+                response = m_responses.value(key);
+            } else {
+                response.status = 404;
+                response.parts.append("{\"type\":\"error\",\"error\":\"not found\",\"error_code\":404}");
+            }
+        }
+        sendResponse(socket, response);
+    }
+
+    void sendResponse (QLocalSocket *socket, const CannedResponse &response)
+    {
+        QByteArray header = "HTTP/1.1 " + QByteArray::number(response.status) + " Canned\r\n"
+                "Content-Type: application/json\r\n";
+        if (response.chunked) {
+            header += "Transfer-Encoding: chunked\r\n";
+        } else {
+            int length = 0;
+            foreach (const QByteArray &part, response.parts)
+                length += part.size();
+            header += "Content-Length: " + QByteArray::number(length) + "\r\n";
+        }
+        socket->write(header + "\r\n");
+
+        for (int i = 0; i < response.parts.size(); i++) {
+            if (i > 0) {
+                socket->flush();
+                QThread::msleep(PART_DELAY);
+            }
+
+            const QByteArray &part = response.parts.at(i);
+            if (response.chunked)
+                socket->write(QByteArray::number(part.size(), 16) + "\r\n" + part + "\r\n");
+            else
+                socket->write(part);
+        }
+
+        if (response.chunked)
+            socket->write("0\r\n\r\n");
+        socket->flush();
+    }
+
+private:
+    QString m_socketPath;
+    QLocalServer *m_server = nullptr;
+    QHash<QLocalSocket *, QByteArray> m_buffers;
+
+    mutable QMutex m_mutex;
+    QHash<QByteArray, CannedResponse> m_responses;
+    QList<QByteArray> m_requests;
+};
+
+static CannedResponse cannedJson (const QByteArray &json, int status = 200)
+{
+    CannedResponse response;
+    response.status = status;
+    response.parts.append(json);
+    return response;
+}
+
+static const char STATE_RUNNING[] =
+        "{\"type\":\"sync\",\"status_code\":200,\"metadata\":{"
+        "\"status\":\"Running\",\"network\":{"
+        "\"lo\":{\"addresses\":[{\"family\":\"inet\",\"address\":\"127.0.0.1\",\"scope\":\"local\"}]},"
+        "\"eth0\":{\"addresses\":["
+        "{\"family\":\"inet6\",\"address\":\"fe80::1\",\"scope\":\"link\"},"
+        "{\"family\":\"inet\",\"address\":\"10.0.3.17\",\"scope\":\"global\"}]}}}}";
+
+LxdClientTest::LxdClientTest()
+{
+}
+
+void LxdClientTest::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+
+    m_server = new MockLxdServer(socketPath());
+    m_server->moveToThread(&m_serverThread);
+    connect(&m_serverThread, &QThread::finished, m_server, &QObject::deleteLater);
+    m_serverThread.start();
+
+    bool listening = false;
+    QMetaObject::invokeMethod(m_server, "listen", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(bool, listening));
+    QVERIFY(listening);
+}
+
+void LxdClientTest::cleanupTestCase()
+{
+    QMetaObject::invokeMethod(m_server, "close", Qt::BlockingQueuedConnection);
+    m_serverThread.quit();
+    m_serverThread.wait();
+}
+
+void LxdClientTest::init()
+{
+    m_server->reset();
+}
+
+void LxdClientTest::testContainerState()
+{
+    m_server->setResponse("GET /1.0/containers/target/state", cannedJson(STATE_RUNNING));
+
+    LxdClient client(socketPath());
+    LxdClient::ContainerState state;
+    QVERIFY2(client.containerState(QStringLiteral("target"), &state), qPrintable(client.errorString()));
+    QCOMPARE(state.status, QStringLiteral("Running"));
+    QCOMPARE(state.ipv4, QStringLiteral("10.0.3.17"));
+}
+
+void LxdClientTest::testContainerMissing()
+{
+    LxdClient client(socketPath());
+    bool exists = true;
+    QVERIFY(client.containerExists(QStringLiteral("missing"), &exists));
+    QVERIFY(!exists);
+}
+
+void LxdClientTest::testErrorResponse()
+{
+    m_server->setResponse("GET /1.0/containers/broken/state",
+                          cannedJson("{\"type\":\"error\",\"error\":\"broken\",\"error_code\":500}", 500));
+
+    LxdClient client(socketPath());
+    LxdClient::ContainerState state;
+    QVERIFY(!client.containerState(QStringLiteral("broken"), &state));
+    QCOMPARE(client.errorString(), QStringLiteral("broken"));
+}
+
+void LxdClientTest::testChunkedBody()
+{
+    CannedResponse response;
+    response.chunked = true;
+    response.parts << QByteArray(STATE_RUNNING).left(40) << QByteArray(STATE_RUNNING).mid(40);
+    m_server->setResponse("GET /1.0/containers/target/state", response);
+
+    LxdClient client(socketPath());
+    LxdClient::ContainerState state;
+    QVERIFY2(client.containerState(QStringLiteral("target"), &state), qPrintable(client.errorString()));
+    QCOMPARE(state.ipv4, QStringLiteral("10.0.3.17"));
+}
+
+/*!
+ * \brief LxdClientTest::testChunkedBodyLookingLikeLastChunk
+ * The first chunk ends with "0\r\n", together with the chunk delimiter
+ * the data received so far ends like a complete chunked body
+ */
+void LxdClientTest::testChunkedBodyLookingLikeLastChunk()
+{
+    CannedResponse response;
+    response.chunked = true;
+    response.parts << "{\"type\":\"sync\",\"metadata\":{\"limit\":10\r\n"
+                   << ",\"expanded_config\":{\"limits.cpu\":\"0-3\"}}}";
+    m_server->setResponse("GET /1.0/containers/target", response);
+
+    LxdClient client(socketPath());
+    int cpus = 0;
+    QVERIFY2(client.containerCpuLimit(QStringLiteral("target"), &cpus), qPrintable(client.errorString()));
+    QCOMPARE(cpus, 4);
+}
+
+void LxdClientTest::testContainerNameIsEscaped()
+{
+    m_server->setResponse("GET /1.0/containers/my%20target%2F..%3Fx/state", cannedJson(STATE_RUNNING));
+
+    LxdClient client(socketPath());
+    LxdClient::ContainerState state;
+    QVERIFY2(client.containerState(QStringLiteral("my target/..?x"), &state), qPrintable(client.errorString()));
+    QCOMPARE(m_server->requests(),
+             QList<QByteArray>() << "GET /1.0/containers/my%20target%2F..%3Fx/state");
+}
+
+void LxdClientTest::testParseCpuLimit_data()
+{
+    QTest::addColumn<QString>("limit");
+    QTest::addColumn<int>("cpus");
+
+    QTest::newRow("unlimited") << QString() << 0;
+    QTest::newRow("count") << QStringLiteral("4") << 4;
+    QTest::newRow("set") << QStringLiteral("0-3,6") << 5;
+    QTest::newRow("single") << QStringLiteral("2") << 2;
+    QTest::newRow("reversed") << QStringLiteral("3-1") << 0;
+}
+
+void LxdClientTest::testParseCpuLimit()
+{
+    QFETCH(QString, limit);
+    QFETCH(int, cpus);
+    QCOMPARE(LxdClient::parseCpuLimit(limit), cpus);
+}
+
+static QByteArray lifecycleEvent (const QByteArray &action, const QByteArray &source)
+{
+    return "{\"type\":\"lifecycle\",\"metadata\":{\"action\":\"" + action
+            + "\",\"source\":\"" + source + "\"}}";
+}
+
+static QByteArray operationEvent (const QByteArray &description, int statusCode = 200)
+{
+    return "{\"type\":\"operation\",\"metadata\":{\"description\":\"" + description
+            + "\",\"status_code\":" + QByteArray::number(statusCode)
+            + ",\"resources\":{\"containers\":[\"/1.0/containers/target\"]}}}";
+}
+
+void LxdClientTest::testContainerChange_data()
+{
+    QTest::addColumn<QByteArray>("event");
+    QTest::addColumn<int>("change");
+    QTest::addColumn<QStringList>("containers");
+
+    const QStringList target{ QStringLiteral("target") };
+    const QByteArray source = "/1.0/containers/target";
+
+    QTest::newRow("created") << lifecycleEvent("container-created", source)
+                             << int(LxdEventMonitor::ListChange) << target;
+    QTest::newRow("renamed") << lifecycleEvent("container-renamed", source)
+                             << int(LxdEventMonitor::ListChange) << target;
+    QTest::newRow("deleted") << lifecycleEvent("container-deleted", source)
+                             << int(LxdEventMonitor::ListChange) << target;
+    QTest::newRow("started") << lifecycleEvent("container-started", source)
+                             << int(LxdEventMonitor::StateChange) << target;
+    QTest::newRow("shutdown") << lifecycleEvent("container-shutdown", source)
+                              << int(LxdEventMonitor::StateChange) << target;
+    QTest::newRow("escaped") << lifecycleEvent("container-stopped", "/1.0/containers/my%20target")
+                             << int(LxdEventMonitor::StateChange) << QStringList{ QStringLiteral("my target") };
+
+    //caused by LxdClient::exec and the file transfers, must not trigger anything
+    QTest::newRow("log-retrieved") << lifecycleEvent("container-log-retrieved", source + "/logs/exec_1.stdout")
+                                   << int(LxdEventMonitor::NoChange) << QStringList();
+    QTest::newRow("log-deleted") << lifecycleEvent("container-log-deleted", source + "/logs/exec_1.stdout")
+                                 << int(LxdEventMonitor::NoChange) << QStringList();
+    QTest::newRow("file-pushed") << lifecycleEvent("container-file-pushed", source + "/files?path=/tmp/a")
+                                 << int(LxdEventMonitor::NoChange) << QStringList();
+    QTest::newRow("file-deleted") << lifecycleEvent("container-file-deleted", source + "/files?path=/tmp/a")
+                                  << int(LxdEventMonitor::NoChange) << QStringList();
+    QTest::newRow("snapshot-created") << lifecycleEvent("container-snapshot-created", source + "/snapshots/snap0")
+                                      << int(LxdEventMonitor::NoChange) << QStringList();
+    QTest::newRow("updated") << lifecycleEvent("container-updated", source)
+                             << int(LxdEventMonitor::NoChange) << QStringList();
+
+    QTest::newRow("op-starting") << operationEvent("Starting container")
+                                 << int(LxdEventMonitor::StateChange) << target;
+    QTest::newRow("op-creating") << operationEvent("Creating container")
+                                 << int(LxdEventMonitor::ListChange) << target;
+    QTest::newRow("op-failed") << operationEvent("Starting container", 400)
+                               << int(LxdEventMonitor::NoChange) << QStringList();
+    QTest::newRow("op-exec") << operationEvent("Executing command")
+                             << int(LxdEventMonitor::NoChange) << QStringList();
+    QTest::newRow("op-snapshot") << operationEvent("Snapshotting container")
+                                 << int(LxdEventMonitor::NoChange) << QStringList();
+}
+
+void LxdClientTest::testContainerChange()
+{
+    QFETCH(QByteArray, event);
+    QFETCH(int, change);
+    QFETCH(QStringList, containers);
+
+    const QJsonDocument doc = QJsonDocument::fromJson(event);
+    QVERIFY(doc.isObject());
+
+    QStringList affected;
+    QCOMPARE(int(LxdEventMonitor::containerChange(doc.object(), &affected)), change);
+    QCOMPARE(affected, containers);
+}
+
+QString LxdClientTest::socketPath() const
+{
+    return m_dir.path() + QStringLiteral("/unix.socket");
+}
+
+} // namespace Internal
+} // namespace LmBase
+
+#include "lxdclienttest.moc"
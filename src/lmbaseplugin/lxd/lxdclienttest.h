@@ -0,0 +1,72 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#ifndef LMBASE_INTERNAL_LXDCLIENTTEST_H
+#define LMBASE_INTERNAL_LXDCLIENTTEST_H
+
+#include <QObject>
+#include <QTemporaryDir>
+#include <QThread>
+
+namespace LmBase {
+namespace Internal {
+
+class MockLxdServer;
+
+/*!
+ * \brief The LxdClientTest class
+ * Runs the LxdClient against a local socket server serving canned
+ * JSON. The client is blocking, so the server lives in its own thread.
+ * Also checks which LXD events the LxdEventMonitor reports.
+ */
+class LxdClientTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    LxdClientTest ();
+
+private slots:
+    void initTestCase ();
+    void cleanupTestCase ();
+    void init ();
+
+    void testContainerState ();
+    void testContainerMissing ();
+    void testErrorResponse ();
+    void testChunkedBody ();
+    void testChunkedBodyLookingLikeLastChunk ();
+    void testContainerNameIsEscaped ();
+    void testParseCpuLimit_data ();
+    void testParseCpuLimit ();
+    void testContainerChange_data ();
+    void testContainerChange ();
+
+private:
+    QString socketPath () const;
+
+private:
+    QTemporaryDir m_dir;
+    QThread m_serverThread;
+    MockLxdServer *m_server = nullptr;
+};
+
+} // namespace Internal
+} // namespace LmBase
+
+#endif // LMBASE_INTERNAL_LXDCLIENTTEST_H
@@ -0,0 +1,446 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#include "lxdeventmonitor.h"
+#include "lxdclient.h"
+
+#include <utils/algorithm.h>
+
+#include <QCryptographicHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocalSocket>
+#include <QStringList>
+#include <QUrl>
+#include <QDebug>
+
+namespace LmBase {
+namespace Internal {
+
+enum {
+    debug = 0
+};
+
+const int  LXD_RECONNECT_INTERVAL = 5000;
+const char LXD_EVENT_TYPES[]          = "lifecycle,operation";
+const char LXD_FALLBACK_EVENT_TYPES[] = "operation";
+const char WEBSOCKET_GUID[]           = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+enum WebSocketOpCode {
+    OpContinuation = 0x0,
+    OpText         = 0x1,
+    OpBinary       = 0x2,
+    OpClose        = 0x8,
+    OpPing         = 0x9,
+    OpPong         = 0xA
+};
+
+LxdEventMonitor *LxdEventMonitor::m_instance = nullptr;
+
+static QString containerFromResource (const QString &resource)
+{
+    const QString prefix = QStringLiteral("/1.0/containers/");
+    if (!resource.startsWith(prefix))
+        return QString();
+    return QUrl::fromPercentEncoding(resource.mid(prefix.length()).section(QLatin1Char('/'), 0, 0).toUtf8());
+}
+
+LxdEventMonitor::LxdEventMonitor(QObject *parent)
+    : QObject(parent)
+    , m_eventTypes(LXD_EVENT_TYPES)
+{
+    Q_ASSERT_X(!m_instance, Q_FUNC_INFO, "There can be only one LxdEventMonitor instance");
+    m_instance = this;
+
+    m_reconnectTimer.setSingleShot(true);
+    m_reconnectTimer.setInterval(LXD_RECONNECT_INTERVAL);
+    connect(&m_reconnectTimer, &QTimer::timeout, this, &LxdEventMonitor::start);
+}
+
+LxdEventMonitor::~LxdEventMonitor()
+{
+    stop();
+    m_instance = nullptr;
+}
+
+LxdEventMonitor *LxdEventMonitor::instance()
+{
+    return m_instance;
+}
+
+bool LxdEventMonitor::isConnected() const
+{
+    return m_state == Open;
+}
+
+/*!
+ * \brief LxdEventMonitor::start
+ * Connects to the LXD events endpoint, if LXD is not reachable
+ * it is tried again later
+ */
+void LxdEventMonitor::start()
+{
+    m_running = true;
+    if (m_socket)
+        return;
+
+    if (!LxdClient::isAvailable()) {
+        scheduleReconnect();
+        return;
+    }
+
+    m_buffer.clear();
+    m_message.clear();
+
+    m_socket = new QLocalSocket(this);
+    connect(m_socket, &QLocalSocket::connected, this, &LxdEventMonitor::onConnected);
+    connect(m_socket, &QLocalSocket::readyRead, this, &LxdEventMonitor::onReadyRead);
+    connect(m_socket, &QLocalSocket::disconnected, this, &LxdEventMonitor::onDisconnected);
+    connect(m_socket, static_cast<void (QLocalSocket::*)(QLocalSocket::LocalSocketError)>(&QLocalSocket::error),
+            this, &LxdEventMonitor::onDisconnected);
+    m_socket->connectToServer(LxdClient::defaultSocketPath());
+}
+
+void LxdEventMonitor::stop()
+{
+    m_running = false;
+    m_reconnectTimer.stop();
+
+    if (m_socket) {
+        m_socket->disconnect(this);
+        m_socket->abort();
+        m_socket->deleteLater();
+        m_socket = nullptr;
+    }
+    setState(Disconnected);
+}
+
+void LxdEventMonitor::onConnected()
+{
+    setState(Handshake);
+
+    QByteArray key;
+    for (int i = 0; i < 16; i++)
+        key.append(char(qrand() & 0xFF));
+    key = key.toBase64();
+    m_socket->setProperty("websocketKey", key);
+
+    const QString path = QStringLiteral("/1.0/events?type=%1").arg(QString::fromLatin1(m_eventTypes));
+    m_socket->write(LxdClient::buildRequest("GET", path, QByteArray(), {
+        qMakePair(QByteArray("Upgrade"), QByteArray("websocket")),
+        qMakePair(QByteArray("Connection"), QByteArray("Upgrade")),
+        qMakePair(QByteArray("Sec-WebSocket-Key"), key),
+        qMakePair(QByteArray("Sec-WebSocket-Version"), QByteArray("13"))
+    }));
+}
+
+void LxdEventMonitor::onReadyRead()
+{
+    m_buffer.append(m_socket->readAll());
+
+    if (m_state == Handshake && !processHandshake())
+        return;
+
+    if (m_state == Open)
+        processFrames();
+}
+
+void LxdEventMonitor::onDisconnected()
+{
+    if (!m_socket)
+        return;
+
+    if (debug) qDebug()<<"Lost connection to the LXD event stream"<<m_socket->errorString();
+
+    m_socket->disconnect(this);
+    m_socket->deleteLater();
+    m_socket = nullptr;
+    setState(Disconnected);
+    scheduleReconnect();
+}
+
+void LxdEventMonitor::setState(LxdEventMonitor::State state)
+{
+    if (m_state == state)
+        return;
+
+    const bool wasConnected = (m_state == Open);
+    m_state = state;
+    if (wasConnected != (m_state == Open))
+        emit connectedChanged(m_state == Open);
+}
+
+/*!
+ * \brief LxdEventMonitor::processHandshake
+ * Checks the answer to the websocket upgrade request, returns
+ * false as long as the full header was not received yet
+ */
+bool LxdEventMonitor::processHandshake()
+{
+    int headerEnd = m_buffer.indexOf("\r\n\r\n");
+    if (headerEnd < 0)
+        return false;
+
+    int status = 0;
+    QList<QPair<QByteArray, QByteArray> > headers;
+    bool valid = LxdClient::parseResponseHeader(m_buffer.left(headerEnd), &status, &headers);
+    m_buffer.remove(0, headerEnd + 4);
+
+    if (valid && status != 101 && m_eventTypes != LXD_FALLBACK_EVENT_TYPES) {
+        //older LXD versions do not know about lifecycle events
+        if (debug) qDebug()<<"LXD rejected the event types"<<m_eventTypes<<", falling back";
+        m_eventTypes = LXD_FALLBACK_EVENT_TYPES;
+        m_socket->disconnect(this);
+        m_socket->abort();
+        m_socket->deleteLater();
+        m_socket = nullptr;
+        setState(Disconnected);
+        start();
+        return false;
+    }
+
+    const QByteArray expectedAccept = QCryptographicHash::hash(
+                m_socket->property("websocketKey").toByteArray() + WEBSOCKET_GUID,
+                QCryptographicHash::Sha1).toBase64();
+
+    bool accepted = false;
+    for (const auto &header : headers) {
+        if (header.first == "sec-websocket-accept")
+            accepted = (header.second == expectedAccept);
+    }
+
+    if (!valid || status != 101 || !accepted) {
+        qWarning()<<"Could not open the LXD event stream, HTTP status"<<status;
+        m_socket->abort();
+        return false;
+    }
+
+    setState(Open);
+    return true;
+}
+
+void LxdEventMonitor::processFrames()
+{
+    forever {
+        if (!m_socket || m_buffer.size() < 2)
+            return;
+
+        const quint8 b0 = quint8(m_buffer.at(0));
+        const quint8 b1 = quint8(m_buffer.at(1));
+        const bool fin    = b0 & 0x80;
+        const quint8 op   = b0 & 0x0F;
+        const bool masked = b1 & 0x80;
+
+        int offset = 2;
+        quint64 length = b1 & 0x7F;
+        if (length == 126) {
+            if (m_buffer.size() < 4)
+                return;
+            length = (quint64(quint8(m_buffer.at(2))) << 8) | quint8(m_buffer.at(3));
+            offset = 4;
+        } else if (length == 127) {
+            if (m_buffer.size() < 10)
+                return;
+            length = 0;
+            for (int i = 0; i < 8; i++)
+                length = (length << 8) | quint8(m_buffer.at(2 + i));
+            offset = 10;
+        }
+
+        QByteArray mask;
+        if (masked) {
+            if (m_buffer.size() < offset + 4)
+                return;
+            mask = m_buffer.mid(offset, 4);
+            offset += 4;
+        }
+
+        if (quint64(m_buffer.size() - offset) < length)
+            return;
+
+        QByteArray payload = m_buffer.mid(offset, int(length));
+        m_buffer.remove(0, offset + int(length));
+        if (masked) {
+            for (int i = 0; i < payload.size(); i++)
+                payload[i] = payload.at(i) ^ mask.at(i % 4);
+        }
+
+        switch (op) {
+            case OpContinuation:
+            case OpText:
+            case OpBinary:
+                m_message.append(payload);
+                if (fin) {
+                    handleMessage(m_message);
+                    m_message.clear();
+                }
+                break;
+            case OpPing:
+                sendFrame(OpPong, payload);
+                break;
+            case OpClose:
+                sendFrame(OpClose, payload.left(2));
+                m_socket->disconnectFromServer();
+                return;
+            default:
+                break;
+        }
+    }
+}
+
+void LxdEventMonitor::sendFrame(quint8 opcode, const QByteArray &payload)
+{
+    if (!m_socket)
+        return;
+
+    //frames sent by a client always have to be masked
+    QByteArray frame;
+    frame.append(char(0x80 | opcode));
+
+    const int length = payload.size();
+    if (length < 126) {
+        frame.append(char(0x80 | length));
+    } else if (length < 65536) {
+        frame.append(char(0x80 | 126));
+        frame.append(char((length >> 8) & 0xFF));
+        frame.append(char(length & 0xFF));
+    } else {
+        frame.append(char(0x80 | 127));
+        for (int i = 7; i >= 0; i--)
+            frame.append(char((quint64(length) >> (8 * i)) & 0xFF));
+    }
+
+    QByteArray mask;
+    for (int i = 0; i < 4; i++)
+        mask.append(char(qrand() & 0xFF));
+    frame.append(mask);
+
+    for (int i = 0; i < length; i++)
+        frame.append(payload.at(i) ^ mask.at(i % 4));
+
+    m_socket->write(frame);
+}
+
+/*!
+ * \brief LxdEventMonitor::containerChange
+ * Tells how the LXD \a event changed the containers and stores the names
+ * of the affected containers in \a containers. Only the lifecycle actions
+ * and operations that create, delete, rename or change the run state of a
+ * container count, exec, file, log and snapshot events are ignored as they
+ * are caused by the plugin itself all the time.
+ */
+LxdEventMonitor::ContainerChange LxdEventMonitor::containerChange(const QJsonObject &event, QStringList *containers)
+{
+    static const QStringList listActions = {
+        QStringLiteral("container-created"), QStringLiteral("container-deleted"),
+        QStringLiteral("container-renamed")
+    };
+    static const QStringList stateActions = {
+        QStringLiteral("container-started"), QStringLiteral("container-stopped"),
+        QStringLiteral("container-restarted"), QStringLiteral("container-shutdown"),
+        QStringLiteral("container-paused"), QStringLiteral("container-resumed")
+    };
+    static const QStringList listOperations = {
+        QStringLiteral("Creating"), QStringLiteral("Deleting"), QStringLiteral("Renaming")
+    };
+    static const QStringList stateOperations = {
+        QStringLiteral("Starting"), QStringLiteral("Stopping"), QStringLiteral("Restarting"),
+        QStringLiteral("Freezing"), QStringLiteral("Unfreezing")
+    };
+
+    const QString type = event.value(QStringLiteral("type")).toString();
+    const QJsonObject meta = event.value(QStringLiteral("metadata")).toObject();
+
+    if (type == QStringLiteral("lifecycle")) {
+        const QString action = meta.value(QStringLiteral("action")).toString();
+        const QString container = containerFromResource(meta.value(QStringLiteral("source")).toString());
+        if (container.isEmpty())
+            return NoChange;
+
+        if (listActions.contains(action)) {
+            containers->append(container);
+            return ListChange;
+        }
+        if (stateActions.contains(action)) {
+            containers->append(container);
+            return StateChange;
+        }
+        return NoChange;
+    }
+
+    if (type == QStringLiteral("operation")) {
+        //only look at operations that finished successfully
+        if (meta.value(QStringLiteral("status_code")).toInt() != 200)
+            return NoChange;
+
+        const QString description = meta.value(QStringLiteral("description")).toString();
+        auto describes = [&description](const QString &op) { return description.startsWith(op); };
+
+        ContainerChange change = NoChange;
+        if (Utils::anyOf(listOperations, describes))
+            change = ListChange;
+        else if (Utils::anyOf(stateOperations, describes))
+            change = StateChange;
+        else
+            return NoChange;
+
+        const QJsonArray resources = meta.value(QStringLiteral("resources")).toObject()
+                .value(QStringLiteral("containers")).toArray();
+        foreach (const QJsonValue &res, resources) {
+            const QString container = containerFromResource(res.toString());
+            if (!container.isEmpty())
+                containers->append(container);
+        }
+        return change;
+    }
+
+    return NoChange;
+}
+
+void LxdEventMonitor::handleMessage(const QByteArray &message)
+{
+    QJsonParseError err;
+    QJsonDocument doc = QJsonDocument::fromJson(message, &err);
+    if (err.error != QJsonParseError::NoError || !doc.isObject())
+        return;
+
+    const QJsonObject event = doc.object();
+    emit eventReceived(event);
+
+    QStringList containers;
+    switch (containerChange(event, &containers)) {
+        case ListChange:
+            emit containerListChanged();
+            break;
+        case StateChange:
+            foreach (const QString &container, containers)
+                emit containerStateChanged(container);
+            break;
+        default:
+            break;
+    }
+}
+
+void LxdEventMonitor::scheduleReconnect()
+{
+    if (m_running && !m_reconnectTimer.isActive())
+        m_reconnectTimer.start();
+}
+
+} // namespace Internal
+} // namespace LmBase
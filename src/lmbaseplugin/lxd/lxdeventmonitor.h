@@ -0,0 +1,108 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#ifndef LMBASE_INTERNAL_LXDEVENTMONITOR_H
+#define LMBASE_INTERNAL_LXDEVENTMONITOR_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QJsonObject>
+#include <QStringList>
+#include <QTimer>
+
+QT_BEGIN_NAMESPACE
+class QLocalSocket;
+QT_END_NAMESPACE
+
+namespace LmBase {
+namespace Internal {
+
+/*!
+ * \brief The LxdEventMonitor class
+ * Listens on the LXD events websocket and reports changes of containers.
+ * Only the parts of RFC 6455 required to receive text messages from
+ * LXD are implemented. The connection is reestablished automatically.
+ */
+class LxdEventMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum ContainerChange {
+        NoChange,
+        ListChange,
+        StateChange
+    };
+
+    explicit LxdEventMonitor(QObject *parent = 0);
+    ~LxdEventMonitor();
+
+    static LxdEventMonitor *instance ();
+
+    bool isConnected () const;
+
+    static ContainerChange containerChange (const QJsonObject &event, QStringList *containers);
+
+public slots:
+    void start ();
+    void stop ();
+
+signals:
+    void connectedChanged (bool connected);
+    void eventReceived (const QJsonObject &event);
+
+    //a container was created, deleted or renamed
+    void containerListChanged ();
+    //a container was started, stopped or otherwise changed state
+    void containerStateChanged (const QString &containerName);
+
+private slots:
+    void onConnected ();
+    void onReadyRead ();
+    void onDisconnected ();
+
+private:
+    enum State {
+        Disconnected,
+        Handshake,
+        Open
+    };
+
+    void setState (State state);
+    bool processHandshake ();
+    void processFrames ();
+    void sendFrame (quint8 opcode, const QByteArray &payload);
+    void handleMessage (const QByteArray &message);
+    void scheduleReconnect ();
+
+private:
+    static LxdEventMonitor *m_instance;
+
+    QLocalSocket *m_socket = nullptr;
+    QTimer m_reconnectTimer;
+    QByteArray m_buffer;
+    QByteArray m_message;
+    QByteArray m_eventTypes;
+    State m_state = Disconnected;
+    bool m_running = false;
+};
+
+} // namespace Internal
+} // namespace LmBase
+
+#endif // LMBASE_INTERNAL_LXDEVENTMONITOR_H
@@ -0,0 +1,630 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#include "preamblecache.h"
+#include "lmbaseplugin_constants.h"
+#include "lmtargetregistry.h"
+#include "lmtoolchain.h"
+
+#include <coreplugin/icore.h>
+#include <cpptools/compileroptionsbuilder.h>
+#include <cpptools/cppmodelmanager.h>
+#include <cpptools/projectinfo.h>
+#include <cpptools/projectpart.h>
+#include <projectexplorer/kit.h>
+#include <projectexplorer/kitinformation.h>
+#include <projectexplorer/project.h>
+#include <projectexplorer/projectexplorerconstants.h>
+#include <projectexplorer/session.h>
+#include <projectexplorer/target.h>
+#include <projectexplorer/toolchainmanager.h>
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QDebug>
+
+namespace LmBase {
+namespace Internal {
+
+enum {
+    debug = 0
+};
+
+const char PCH_SUFFIX[]   = ".pch";
+const char STAMP_SUFFIX[] = ".stamp";
+
+//the modules a project part can get into its preamble, in include order
+static const struct {
+    const char *define;
+    const char *module;
+} PREAMBLE_MODULES[] = {
+    { "QT_CORE_LIB",        "QtCore" },
+    { "QT_GUI_LIB",         "QtGui" },
+    { "QT_WIDGETS_LIB",     "QtWidgets" },
+    { "QT_NETWORK_LIB",     "QtNetwork" },
+    { "QT_DBUS_LIB",        "QtDBus" },
+    { "QT_SQL_LIB",         "QtSql" },
+    { "QT_XML_LIB",         "QtXml" },
+    { "QT_CONCURRENT_LIB",  "QtConcurrent" },
+    { "QT_QML_LIB",         "QtQml" },
+    { "QT_QUICK_LIB",       "QtQuick" },
+    { "QT_MULTIMEDIA_LIB",  "QtMultimedia" },
+    { "QT_POSITIONING_LIB", "QtPositioning" }
+};
+
+PreambleCache *PreambleCache::m_instance = nullptr;
+
+/*!
+ * \brief languageStandard
+ * Returns the -std value the code model uses for \a part,
+ * or a empty string for C parts
+ */
+static QString languageStandard(const CppTools::ProjectPart &part)
+{
+    const QString prefix = (part.languageExtensions & CppTools::ProjectPart::GnuExtensions)
+            ? QStringLiteral("gnu++") : QStringLiteral("c++");
+
+    switch (part.languageVersion) {
+    case CppTools::ProjectPart::CXX98:
+        return prefix + QStringLiteral("98");
+    case CppTools::ProjectPart::CXX03:
+        return prefix + QStringLiteral("03");
+    case CppTools::ProjectPart::CXX11:
+        return prefix + QStringLiteral("11");
+    case CppTools::ProjectPart::CXX14:
+        return prefix + QStringLiteral("14");
+    case CppTools::ProjectPart::CXX17:
+        return prefix + QStringLiteral("1z");
+    default:
+        return QString();
+    }
+}
+
+/*!
+ * \brief qtHeaderDirectory
+ * Returns the directory containing the Qt module headers in \a rootfs
+ */
+static QString qtHeaderDirectory(const TargetRegistry::TargetInfo &info)
+{
+    const QString triplet = LinkMotionToolChain::gnutriplet(
+                LinkMotionToolChain::architectureNameToAbi(info.target.architecture));
+
+    const QStringList candidates{
+        QStringLiteral("%1/usr/include/%2/qt5").arg(info.rootfs).arg(triplet),
+        QStringLiteral("%1/usr/include/qt5").arg(info.rootfs)
+    };
+    foreach (const QString &candidate, candidates) {
+        if (QFileInfo(candidate + QStringLiteral("/QtCore/QtCore")).exists())
+            return candidate;
+    }
+    return QString();
+}
+
+static LinkMotionToolChain *cxxToolChain(const QString &containerName)
+{
+    foreach (ProjectExplorer::ToolChain *tc, ProjectExplorer::ToolChainManager::toolChains()) {
+        if (tc->typeId() != Constants::LM_TARGET_TOOLCHAIN_ID
+                || tc->language() != ProjectExplorer::Constants::CXX_LANGUAGE_ID)
+            continue;
+
+        LinkMotionToolChain *lmTc = static_cast<LinkMotionToolChain *>(tc);
+        if (lmTc->lmTarget().containerName == containerName)
+            return lmTc;
+    }
+    return nullptr;
+}
+
+PreambleCache::PreambleCache(QObject *parent)
+    : QObject(parent)
+{
+    Q_ASSERT_X(!m_instance, Q_FUNC_INFO, "There can be only one PreambleCache instance");
+    m_instance = this;
+}
+
+PreambleCache::~PreambleCache()
+{
+    stopAll();
+    m_instance = nullptr;
+}
+
+PreambleCache *PreambleCache::instance()
+{
+    return m_instance;
+}
+
+/*!
+ * \brief PreambleCache::preambleDirectory
+ * The headers and PCHs live next to the rootfs of the target
+ */
+Utils::FileName PreambleCache::preambleDirectory(const QString &containerName)
+{
+    const QString rootfs = TargetRegistry::instance()->rootfs(containerName);
+    if (rootfs.isEmpty())
+        return Utils::FileName();
+
+    return Utils::FileName::fromString(rootfs)
+            .parentDir()
+            .appendPath(QLatin1String(Constants::LM_PREAMBLE_CACHE_DIR));
+}
+
+/*!
+ * \brief PreambleCache::modulesForPart
+ * Returns the Qt modules \a part uses. qmake and CMake define QT_<MODULE>_LIB
+ * for every module a project links, projects without those defines are
+ * matched by the module directories in their include paths.
+ */
+QStringList PreambleCache::modulesForPart(const CppTools::ProjectPart &part)
+{
+    QSet<QByteArray> defines;
+    foreach (const QByteArray &line, part.projectDefines.split('\n')) {
+        const QByteArray directive = line.trimmed();
+        if (directive.startsWith("#define "))
+            defines.insert(directive.mid(8).split(' ').first());
+    }
+
+    QSet<QString> includeDirs;
+    foreach (const CppTools::ProjectPartHeaderPath &path, part.headerPaths)
+        includeDirs.insert(QFileInfo(path.path).fileName());
+
+    QStringList modules;
+    for (const auto &entry : PREAMBLE_MODULES) {
+        const QString module = QLatin1String(entry.module);
+        if (defines.contains(entry.define) || includeDirs.contains(module))
+            modules.append(module);
+    }
+
+    //every Qt project uses QtCore, even if it does not say so
+    if (!modules.contains(QStringLiteral("QtCore")))
+        modules.prepend(QStringLiteral("QtCore"));
+    return modules;
+}
+
+/*!
+ * \brief PreambleCache::optionsForPart
+ * Returns the defines and include paths the code model passes to clang for
+ * \a part. clang rejects a PCH built with different macro definitions, which
+ * includes the __PIC__ a -fPIC build gets from the toolchain defines.
+ */
+QStringList PreambleCache::optionsForPart(const CppTools::ProjectPart &part)
+{
+    CppTools::CompilerOptionsBuilder builder(part);
+    builder.addToolchainAndProjectDefines();
+    builder.addHeaderPathOptions();
+    return builder.options();
+}
+
+/*!
+ * \brief PreambleCache::start
+ * Starts following the project parts of the code model,
+ * the model manager does not exist before the plugins are initialized
+ */
+void PreambleCache::start()
+{
+    connect(CppTools::CppModelManager::instance(), &CppTools::CppModelManager::projectPartsUpdated,
+            this, &PreambleCache::updateProject);
+}
+
+/*!
+ * \brief PreambleCache::updateProject
+ * Adds the preamble to the C++ parts of \a project if it uses a Link Motion
+ * kit. Parts of preambles that are not built yet are updated once the PCH
+ * is ready. Updating the project info emits projectPartsUpdated again,
+ * but then all parts are already up to date.
+ */
+void PreambleCache::updateProject(ProjectExplorer::Project *project)
+{
+    if (!project || !project->activeTarget() || m_support == Unsupported)
+        return;
+
+    ProjectExplorer::ToolChain *tc = ProjectExplorer::ToolChainKitInformation::toolChain(
+                project->activeTarget()->kit(), ProjectExplorer::Constants::CXX_LANGUAGE_ID);
+    if (!tc || tc->typeId() != Constants::LM_TARGET_TOOLCHAIN_ID)
+        return;
+
+    const QString containerName = static_cast<LinkMotionToolChain *>(tc)->lmTarget().containerName;
+    if (!TargetRegistry::instance()->isAvailable(containerName))
+        return;
+
+    CppTools::CppModelManager *modelManager = CppTools::CppModelManager::instance();
+    const CppTools::ProjectInfo info = modelManager->projectInfo(project);
+    if (!info.isValid())
+        return;
+
+    bool changed = false;
+    CppTools::ProjectInfo updated(project);
+    foreach (const CppTools::ProjectPart::Ptr &part, info.projectParts()) {
+        const QString standard = languageStandard(*part);
+        if (standard.isEmpty() || part->qtVersion != CppTools::ProjectPart::Qt5) {
+            updated.appendProjectPart(part);
+            continue;
+        }
+
+        Variant variant;
+        variant.containerName = containerName;
+        variant.standard = standard;
+        variant.targetTriple = part->targetTriple;
+        variant.modules = modulesForPart(*part);
+        variant.options = optionsForPart(*part);
+
+        //parts with the same modules and options share the PCH
+        const QByteArray optionsHash = QCryptographicHash::hash(
+                    (variant.modules + variant.options).join(QLatin1Char('\n')).toUtf8(),
+                    QCryptographicHash::Md5).toHex().left(12);
+        variant.key = QStringList{
+                containerName, standard, part->targetTriple, QString::fromLatin1(optionsHash)
+        }.join(QLatin1Char('/'));
+
+        const QString header = headerFile(variant);
+        if (!m_ready.contains(variant.key) || part->precompiledHeaders.value(0) == header) {
+            if (!m_ready.contains(variant.key)) {
+                schedule(variant);
+                QList<QPointer<ProjectExplorer::Project> > &waiting = m_waiting[variant.key];
+                if (!waiting.contains(project))
+                    waiting.append(project);
+            }
+            updated.appendProjectPart(part);
+            continue;
+        }
+
+        //clang only uses the PCH for the first included header
+        CppTools::ProjectPart::Ptr copy = part->copy();
+        copy->precompiledHeaders.removeAll(header);
+        copy->precompiledHeaders.prepend(header);
+        updated.appendProjectPart(copy);
+        changed = true;
+    }
+
+    if (!changed)
+        return;
+
+    if (debug) qDebug()<<"Using the code model preamble of"<<containerName<<"for"<<project->displayName();
+
+    updated.finish();
+    modelManager->updateProjectInfo(updated);
+}
+
+/*!
+ * \brief PreambleCache::invalidate
+ * Drops the PCHs of \a containerName and builds them again for the open
+ * projects, used after the target was upgraded. The headers are kept,
+ * the project parts still include them until the PCHs are ready. The
+ * builds start once the running registry refresh finished.
+ */
+void PreambleCache::invalidate(const QString &containerName)
+{
+    if (m_process && m_current.containerName == containerName) {
+        m_process->disconnect(this);
+        m_process->kill();
+        m_process->deleteLater();
+        m_process = nullptr;
+        m_current = Variant();
+    }
+
+    const QString prefix = containerName + QLatin1Char('/');
+    for (auto it = m_ready.begin(); it != m_ready.end();) {
+        if (it->startsWith(prefix))
+            it = m_ready.erase(it);
+        else
+            ++it;
+    }
+
+    const Utils::FileName dirName = preambleDirectory(containerName);
+    if (!dirName.isEmpty()) {
+        QDir dir(dirName.toString());
+        const QStringList stale = dir.entryList(QStringList{
+                                                    QLatin1Char('*') + QLatin1String(PCH_SUFFIX),
+                                                    QLatin1Char('*') + QLatin1String(STAMP_SUFFIX)
+                                                }, QDir::Files);
+        foreach (const QString &file, stale)
+            dir.remove(file);
+    }
+
+    foreach (ProjectExplorer::Project *project, ProjectExplorer::SessionManager::projects())
+        updateProject(project);
+
+    startNext();
+}
+
+void PreambleCache::stopAll()
+{
+    m_queue.clear();
+    if (m_process) {
+        m_process->disconnect(this);
+        m_process->kill();
+        m_process->waitForFinished(1000);
+        delete m_process;
+        m_process = nullptr;
+    }
+    m_current = Variant();
+}
+
+/*!
+ * \brief PreambleCache::checkCompiler
+ * A PCH can only be loaded by the clang version that wrote it. The clang
+ * shipped with the IDE is preferred, a clang from PATH is only used if
+ * its version matches the resource directory of the code model.
+ */
+void PreambleCache::checkCompiler()
+{
+    m_support = Checking;
+
+    const QString clangDir = Core::ICore::libexecPath() + QStringLiteral("/clang");
+    const QStringList resourceVersions = QDir(clangDir + QStringLiteral("/lib/clang"))
+            .entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    const QString requiredVersion = resourceVersions.value(0);
+
+    const QFileInfo bundled(clangDir + QStringLiteral("/bin/clang"));
+    m_compiler = bundled.isExecutable()
+            ? bundled.absoluteFilePath()
+            : QStandardPaths::findExecutable(QStringLiteral("clang"));
+
+    if (m_compiler.isEmpty()) {
+        if (debug) qDebug()<<"No clang found, the code model preamble is not used";
+        m_support = Unsupported;
+        m_queue.clear();
+        return;
+    }
+
+    QProcess *proc = new QProcess(this);
+    connect(proc, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+            this, [this, proc, requiredVersion]() {
+        const QString version = QRegularExpression(QStringLiteral("version (\\d+\\.\\d+\\.\\d+)"))
+                .match(QString::fromLocal8Bit(proc->readAllStandardOutput())).captured(1);
+        proc->deleteLater();
+
+        if (version.isEmpty() || (!requiredVersion.isEmpty() && version != requiredVersion)) {
+            if (debug) qDebug()<<"clang"<<version<<"does not match the code model"<<requiredVersion;
+            m_support = Unsupported;
+            m_queue.clear();
+            m_waiting.clear();
+            return;
+        }
+
+        m_support = Supported;
+        m_compilerVersion = version;
+        startNext();
+    });
+    connect(proc, &QProcess::errorOccurred, this, [this, proc](QProcess::ProcessError err) {
+        if (err != QProcess::FailedToStart)
+            return;
+        proc->deleteLater();
+        m_support = Unsupported;
+        m_queue.clear();
+        m_waiting.clear();
+    });
+
+    proc->start(m_compiler, QStringList{QStringLiteral("--version")});
+}
+
+void PreambleCache::schedule(const PreambleCache::Variant &variant)
+{
+    if (m_current.key == variant.key)
+        return;
+
+    foreach (const Variant &queued, m_queue) {
+        if (queued.key == variant.key)
+            return;
+    }
+
+    m_queue.append(variant);
+
+    if (m_support == Unknown)
+        checkCompiler();
+    else
+        startNext();
+}
+
+/*!
+ * \brief PreambleCache::startNext
+ * Builds the next PCH in the queue, a PCH that is still current
+ * from a earlier session is used right away. Nothing is started
+ * while the registry is refreshing, the stamps might be outdated.
+ */
+void PreambleCache::startNext()
+{
+    if (m_process || m_support != Supported || TargetRegistry::instance()->isRefreshing())
+        return;
+
+    while (!m_queue.isEmpty()) {
+        const Variant variant = m_queue.takeFirst();
+        const QByteArray stamp = buildStamp(variant);
+        const QString header = headerFile(variant);
+        if (stamp.isEmpty() || header.isEmpty())
+            continue;
+
+        QFile stampFile(header + QLatin1String(STAMP_SUFFIX));
+        if (stampFile.open(QIODevice::ReadOnly) && stampFile.readAll() == stamp
+                && QFileInfo::exists(header + QLatin1String(PCH_SUFFIX))) {
+            markReady(variant.key);
+            continue;
+        }
+
+        if (!writeHeader(variant))
+            continue;
+
+        if (debug) qDebug()<<"Building the code model preamble"<<variant.key;
+
+        m_current = variant;
+        m_currentStamp = stamp;
+        m_process = new QProcess(this);
+        m_process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        connect(m_process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+                this, [this](int exitCode, QProcess::ExitStatus status) {
+            buildFinished(status == QProcess::NormalExit && exitCode == 0);
+        });
+        connect(m_process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError err) {
+            if (err == QProcess::FailedToStart)
+                buildFinished(false);
+        });
+        m_process->start(m_compiler, buildArguments(variant));
+        return;
+    }
+}
+
+void PreambleCache::buildFinished(bool success)
+{
+    m_process->deleteLater();
+    m_process = nullptr;
+
+    const Variant variant = m_current;
+    const QByteArray stamp = m_currentStamp;
+    m_current = Variant();
+    m_currentStamp.clear();
+
+    const QString header = headerFile(variant);
+    if (success) {
+        QSaveFile stampFile(header + QLatin1String(STAMP_SUFFIX));
+        if (stampFile.open(QIODevice::WriteOnly)) {
+            stampFile.write(stamp);
+            stampFile.commit();
+        }
+        markReady(variant.key);
+    } else {
+        qWarning()<<"Building the code model preamble of"<<variant.containerName<<"failed";
+        QFile::remove(header + QLatin1String(PCH_SUFFIX));
+        m_waiting.remove(variant.key);
+    }
+
+    startNext();
+}
+
+void PreambleCache::markReady(const QString &key)
+{
+    m_ready.insert(key);
+    foreach (const QPointer<ProjectExplorer::Project> &project, m_waiting.take(key)) {
+        if (project)
+            updateProject(project);
+    }
+}
+
+QString PreambleCache::headerFile(const PreambleCache::Variant &variant) const
+{
+    const Utils::FileName dir = preambleDirectory(variant.containerName);
+    if (dir.isEmpty())
+        return QString();
+
+    QString name = QStringLiteral("preamble-") + variant.standard;
+    if (!variant.targetTriple.isEmpty())
+        name += QLatin1Char('-') + variant.targetTriple;
+    name += QLatin1Char('-') + variant.key.section(QLatin1Char('/'), -1);
+    return dir.appendPath(name + QStringLiteral(".h")).toString();
+}
+
+/*!
+ * \brief PreambleCache::buildStamp
+ * Changes whenever the PCH has to be built again, because
+ * the image or the compiler changed
+ */
+QByteArray PreambleCache::buildStamp(const PreambleCache::Variant &variant) const
+{
+    const TargetRegistry::TargetInfo info = TargetRegistry::instance()->targetInfo(variant.containerName);
+    if (info.rootfs.isEmpty())
+        return QByteArray();
+
+    return QStringList{
+        variant.key,
+        info.target.distribution,
+        info.target.version,
+        QString::number(info.rootfsStamp),
+        m_compilerVersion
+    }.join(QLatin1Char('\n')).toUtf8();
+}
+
+/*!
+ * \brief PreambleCache::buildArguments
+ * The language, target and preprocessor options have to match the
+ * ones of the code model, otherwise clang refuses to load the PCH
+ */
+QStringList PreambleCache::buildArguments(const PreambleCache::Variant &variant) const
+{
+    const TargetRegistry::TargetInfo info = TargetRegistry::instance()->targetInfo(variant.containerName);
+    const QString header = headerFile(variant);
+
+    QStringList args{
+        QStringLiteral("-x"), QStringLiteral("c++-header"),
+        QStringLiteral("-std=") + variant.standard,
+        QStringLiteral("-fcxx-exceptions"),
+        QStringLiteral("-fexceptions"),
+        QStringLiteral("-fretain-comments-from-system-headers")
+    };
+
+    if (!variant.targetTriple.isEmpty())
+        args << QStringLiteral("-target") << variant.targetTriple;
+
+    //the code model puts its own qobjectdefs.h in front of the one of Qt
+    const QString wrappedQtHeaders = Core::ICore::resourcePath() + QStringLiteral("/cplusplus/wrappedQtHeaders");
+    if (QFileInfo(wrappedQtHeaders).isDir()) {
+        args << QStringLiteral("-I") << wrappedQtHeaders
+             << QStringLiteral("-I") << wrappedQtHeaders + QStringLiteral("/QtCore");
+    }
+
+    args << variant.options
+         << QStringLiteral("--sysroot=") + info.rootfs;
+
+    if (LinkMotionToolChain *tc = cxxToolChain(variant.containerName)) {
+        const QList<ProjectExplorer::HeaderPath> paths = tc->systemHeaderPaths(
+                    QStringList{QStringLiteral("-std=") + variant.standard},
+                    Utils::FileName::fromString(info.rootfs));
+        foreach (const ProjectExplorer::HeaderPath &path, paths)
+            args << QStringLiteral("-isystem") << path.path();
+    }
+
+    args << QStringLiteral("-isystem") << qtHeaderDirectory(info)
+         << header
+         << QStringLiteral("-o") << header + QLatin1String(PCH_SUFFIX);
+    return args;
+}
+
+/*!
+ * \brief PreambleCache::writeHeader
+ * Writes the header including the Qt modules of the variant
+ * that the target provides
+ */
+bool PreambleCache::writeHeader(const PreambleCache::Variant &variant) const
+{
+    const TargetRegistry::TargetInfo info = TargetRegistry::instance()->targetInfo(variant.containerName);
+    const QString qtHeaders = qtHeaderDirectory(info);
+    const QString header = headerFile(variant);
+    if (qtHeaders.isEmpty() || header.isEmpty())
+        return false;
+
+    if (!QDir::root().mkpath(QFileInfo(header).absolutePath()))
+        return false;
+
+    QByteArray content = QStringLiteral("// Code model preamble of %1, generated by the Link Motion SDK\n")
+            .arg(variant.containerName).toUtf8();
+    foreach (const QString &module, variant.modules) {
+        if (QFileInfo::exists(QStringLiteral("%1/%2/%2").arg(qtHeaders).arg(module)))
+            content += QStringLiteral("#include <%1/%1>\n").arg(module).toUtf8();
+    }
+
+    QSaveFile file(header);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(content);
+    return file.commit();
+}
+
+} // namespace Internal
+} // namespace LmBase
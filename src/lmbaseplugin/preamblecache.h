@@ -0,0 +1,118 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#ifndef LMBASE_INTERNAL_PREAMBLECACHE_H
+#define LMBASE_INTERNAL_PREAMBLECACHE_H
+
+#include <utils/fileutils.h>
+
+#include <QObject>
+#include <QHash>
+#include <QPointer>
+#include <QSet>
+#include <QStringList>
+
+QT_BEGIN_NAMESPACE
+class QProcess;
+QT_END_NAMESPACE
+
+namespace ProjectExplorer { class Project; }
+namespace CppTools { class ProjectPart; }
+
+namespace LmBase {
+namespace Internal {
+
+/*!
+ * \brief The PreambleCache class
+ * Builds a precompiled header of the Qt and system headers for every
+ * target, language standard and set of code model options, shared by all
+ * project parts on the kits of the target using the same Qt modules and
+ * options. The header is added as first precompiled header to the C++
+ * project parts, the clang code model then loads the PCH next to it
+ * instead of parsing the headers of the rootfs for every project.
+ *
+ * The PCH is only built with a clang matching the code model, it is
+ * built again when the target was upgraded.
+ */
+class PreambleCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PreambleCache(QObject *parent = 0);
+    ~PreambleCache();
+
+    static PreambleCache *instance ();
+
+    static Utils::FileName preambleDirectory (const QString &containerName);
+    static QStringList modulesForPart (const CppTools::ProjectPart &part);
+    static QStringList optionsForPart (const CppTools::ProjectPart &part);
+
+public slots:
+    void start ();
+    void updateProject (ProjectExplorer::Project *project);
+    void invalidate (const QString &containerName);
+    void startNext ();
+    void stopAll ();
+
+private:
+    struct Variant {
+        QString key;
+        QString containerName;
+        QString standard;
+        QString targetTriple;
+        QStringList modules;
+        QStringList options;   //defines and include paths of the code model
+    };
+
+    void checkCompiler ();
+    void schedule (const Variant &variant);
+    void buildFinished (bool success);
+    void markReady (const QString &key);
+
+    QString headerFile (const Variant &variant) const;
+    QByteArray buildStamp (const Variant &variant) const;
+    QStringList buildArguments (const Variant &variant) const;
+    bool writeHeader (const Variant &variant) const;
+
+private:
+    enum CompilerSupport {
+        Unknown,
+        Checking,
+        Supported,
+        Unsupported
+    };
+
+    static PreambleCache *m_instance;
+
+    CompilerSupport m_support = Unknown;
+    QString m_compiler;
+    QString m_compilerVersion;
+
+    QList<Variant> m_queue;
+    QSet<QString> m_ready;                                        //variants with a current PCH
+    QHash<QString, QList<QPointer<ProjectExplorer::Project> > > m_waiting; //variant -> projects
+    Variant m_current;
+    QByteArray m_currentStamp;
+    QProcess *m_process = nullptr;
+};
+
+} // namespace Internal
+} // namespace LmBase
+
+#endif // LMBASE_INTERNAL_PREAMBLECACHE_H
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+
+#include "preamblecachetest.h"
+#include "preamblecache.h"
+
+#include <cpptools/projectpart.h>
+
+#include <QTest>
+
+namespace LmBase {
+namespace Internal {
+
+PreambleCacheTest::PreambleCacheTest()
+{
+}
+
+void PreambleCacheTest::testModulesForPart_data()
+{
+    QTest::addColumn<QByteArray>("defines");
+    QTest::addColumn<QStringList>("includePaths");
+    QTest::addColumn<QStringList>("modules");
+
+    QTest::newRow("core")
+            << QByteArray("#define QT_CORE_LIB\n")
+            << QStringList()
+            << QStringList{ QStringLiteral("QtCore") };
+    QTest::newRow("quick")
+            << QByteArray("#define QT_QUICK_LIB\n#define QT_GUI_LIB 1\n#define QT_QML_LIB\n#define QT_CORE_LIB\n")
+            << QStringList()
+            << QStringList{ QStringLiteral("QtCore"), QStringLiteral("QtGui"),
+                            QStringLiteral("QtQml"), QStringLiteral("QtQuick") };
+    QTest::newRow("widgets-without-qml")
+            << QByteArray("#define QT_WIDGETS_LIB\n#define QT_GUI_LIB\n#define QT_CORE_LIB\n#define APP_QML_LIB\n")
+            << QStringList()
+            << QStringList{ QStringLiteral("QtCore"), QStringLiteral("QtGui"), QStringLiteral("QtWidgets") };
+    QTest::newRow("include-paths")
+            << QByteArray("#define QT_NO_DEBUG\n")
+            << QStringList{ QStringLiteral("/rootfs/usr/include/x86_64-linux-gnu/qt5"),
+                            QStringLiteral("/rootfs/usr/include/x86_64-linux-gnu/qt5/QtNetwork"),
+                            QStringLiteral("/rootfs/usr/include/x86_64-linux-gnu/qt5/QtCore") }
+            << QStringList{ QStringLiteral("QtCore"), QStringLiteral("QtNetwork") };
+    QTest::newRow("implicit-core")
+            << QByteArray()
+            << QStringList()
+            << QStringList{ QStringLiteral("QtCore") };
+}
+
+void PreambleCacheTest::testModulesForPart()
+{
+    QFETCH(QByteArray, defines);
+    QFETCH(QStringList, includePaths);
+    QFETCH(QStringList, modules);
+
+    CppTools::ProjectPart part;
+    part.projectDefines = defines;
+    foreach (const QString &path, includePaths)
+        part.headerPaths.append(CppTools::ProjectPartHeaderPath(path, CppTools::ProjectPartHeaderPath::IncludePath));
+
+    QCOMPARE(PreambleCache::modulesForPart(part), modules);
+}
+
+void PreambleCacheTest::testOptionsForPart()
+{
+    CppTools::ProjectPart part;
+    part.toolchainDefines = "#define __PIC__ 2\n#define __pic__ 2\n#define __cplusplus 201103L\n";
+    part.projectDefines = "#define QT_GUI_LIB\n#define APP_VERSION \"1.2\"\n";
+    part.headerPaths.append(CppTools::ProjectPartHeaderPath(QStringLiteral("/home/user/app/src"),
+                                                            CppTools::ProjectPartHeaderPath::IncludePath));
+
+    const QStringList options = PreambleCache::optionsForPart(part);
+    auto hasOption = [&options](const QString &prefix) {
+        foreach (const QString &option, options) {
+            if (option.startsWith(prefix))
+                return true;
+        }
+        return false;
+    };
+
+    //the PCH has to see the same macros as the code model
+    QVERIFY(hasOption(QStringLiteral("-D__PIC__=2")));
+    QVERIFY(hasOption(QStringLiteral("-DQT_GUI_LIB")));
+    QVERIFY(hasOption(QStringLiteral("-DAPP_VERSION=\"1.2\"")));
+    QVERIFY(!hasOption(QStringLiteral("-D__cplusplus")));
+    QVERIFY(options.join(QLatin1Char(' ')).contains(QStringLiteral("/home/user/app/src")));
+
+    //a project with other defines gets its own PCH
+    CppTools::ProjectPart other(part);
+    other.projectDefines = "#define QT_GUI_LIB\n#define APP_VERSION \"1.3\"\n";
+    QVERIFY(PreambleCache::optionsForPart(other) != options);
+}
+
+} // namespace Internal
+} // namespace LmBase
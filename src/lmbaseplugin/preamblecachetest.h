@@ -0,0 +1,48 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+
+#ifndef LMBASE_INTERNAL_PREAMBLECACHETEST_H
+#define LMBASE_INTERNAL_PREAMBLECACHETEST_H
+
+#include <QObject>
+
+namespace LmBase {
+namespace Internal {
+
+/*!
+ * \brief The PreambleCacheTest class
+ * Checks how the preamble of a project part is derived from it
+ */
+class PreambleCacheTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    PreambleCacheTest ();
+
+private slots:
+    void testModulesForPart_data ();
+    void testModulesForPart ();
+    void testOptionsForPart ();
+};
+
+} // namespace Internal
+} // namespace LmBase
+
+#endif // LMBASE_INTERNAL_PREAMBLECACHETEST_H
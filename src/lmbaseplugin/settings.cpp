@@ -48,6 +48,8 @@ static const char KEY_IP[] = "DeviceConnectivity.IP";
 static const char KEY_SSH[] = "DeviceConnectivity.SSH";
 static const char KEY_AUTOTOGGLE[] = "Devices.Auto_Toggle";
 static const char KEY_CHROOT_USE_LOCAL_MIRROR[] = "Target.Use_Local_Mirror";
+static const char KEY_CCACHE_ENABLED[] = "CompilerCache.Enabled";
+static const char KEY_CCACHE_MAX_SIZE[] = "CompilerCache.Max_Size_GB";
 static const char KEY_TREAT_REVIEW_ERRORS_AS_WARNINGS[] = "ProjectDefaults.Treat_Review_Warnings_As_Errors";
 static const char KEY_ENABLE_DEBUG_HELPER_DEFAULT[] = "ProjectDefaults.Enable_Debug_Helper_By_Default";
 static const char KEY_UNINSTALL_APPS_FROM_DEVICE_DEFAULT[] = "ProjectDefaults.Uninstall_Apps_From_Device_By_Default";
@@ -77,6 +79,7 @@ Settings::Settings()
 
     //set default values
     setChrootSettings(TargetSettings());
+    setCompilerCacheSettings(CompilerCacheSettings());
     setImageServerCredentials(ImageServerCredentials());
     setProjectDefaults(ProjectDefaults());
     setDeviceAutoToggle(DEFAULT_DEVICES_AUTOTOGGLE);
@@ -191,6 +194,20 @@ void Settings::setChrootSettings(const Settings::TargetSettings &settings)
     m_instance->m_settings[QLatin1String(KEY_CHROOT_USE_LOCAL_MIRROR)]    = settings.useLocalMirror;
 }
 
+Settings::CompilerCacheSettings Settings::compilerCacheSettings()
+{
+    CompilerCacheSettings val;
+    val.enabled   = m_instance->m_settings.value(QLatin1String(KEY_CCACHE_ENABLED),val.enabled).toBool();
+    val.maxSizeGb = m_instance->m_settings.value(QLatin1String(KEY_CCACHE_MAX_SIZE),val.maxSizeGb).toInt();
+    return val;
+}
+
+void Settings::setCompilerCacheSettings(const Settings::CompilerCacheSettings &settings)
+{
+    m_instance->m_settings[QLatin1String(KEY_CCACHE_ENABLED)]  = settings.enabled;
+    m_instance->m_settings[QLatin1String(KEY_CCACHE_MAX_SIZE)] = settings.maxSizeGb;
+}
+
 bool Settings::deviceAutoToggle()
 {
     return m_instance->m_settings.value(QLatin1String(KEY_AUTOTOGGLE),
@@ -51,6 +51,11 @@ public:
         bool useLocalMirror = false;
     };
 
+    struct CompilerCacheSettings {
+        bool enabled   = true;
+        int  maxSizeGb = 5;
+    };
+
     explicit Settings();
     virtual ~Settings();
 
@@ -68,6 +73,9 @@ public:
     static TargetSettings chrootSettings ();
     static void setChrootSettings (const TargetSettings &settings);
 
+    static CompilerCacheSettings compilerCacheSettings ();
+    static void setCompilerCacheSettings (const CompilerCacheSettings &settings);
+
     static bool deviceAutoToggle ();
     static void setDeviceAutoToggle (const bool set);
 
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#include "sysrootpathtranslator.h"
+
+#include <QDir>
+#include <QFile>
+#include <QMutexLocker>
+
+#include <limits.h>
+#include <unistd.h>
+
+namespace LmBase {
+namespace Internal {
+
+//upper bound for chained symbolic links, like the kernel uses
+const int MAX_LINK_HOPS = 40;
+
+/*!
+ * the top level directories of the container that are mapped
+ * to the sysroot on the host
+ */
+static const char *CONTAINER_ROOT_DIRS[] = {
+    "var", "bin", "boot", "dev", "etc", "lib", "lib64", "media",
+    "mnt", "opt", "proc", "root", "run", "sbin", "srv", "sys", "usr"
+};
+
+SysrootPathTranslator::SysrootPathTranslator(const Utils::FileName &sysroot)
+    : m_sysroot(sysroot)
+{
+    m_hostPrefix = sysroot.toString();
+    while (m_hostPrefix.endsWith(QLatin1Char('/')))
+        m_hostPrefix.chop(1);
+
+    QStringList dirs;
+    for (const char *dir : CONTAINER_ROOT_DIRS)
+        dirs.append(QLatin1String(dir));
+
+    //one alternation for all directories, the path can be prefixed by a
+    //separator or a compiler flag like -I/usr/include
+    m_toHostExp = QRegularExpression(QString::fromLatin1("(^|[^\\w+]|\\s+|[-=]\\w)\\/(%1)")
+                                     .arg(dirs.join(QLatin1Char('|'))));
+    m_toHostExp.optimize();
+
+    m_replacement = QString::fromLatin1("\\1%1/\\2").arg(sysroot.toUserOutput());
+
+    m_toContainerExp = QRegularExpression(QRegularExpression::escape(m_hostPrefix)
+                                          + QStringLiteral("(?=/|$)"));
+    m_toContainerExp.optimize();
+}
+
+/*!
+ * \brief SysrootPathTranslator::forSysroot
+ * Returns the shared translator for \a sysroot, it is created on first use
+ */
+SysrootPathTranslator::Ptr SysrootPathTranslator::forSysroot(const Utils::FileName &sysroot)
+{
+    static QMutex translatorsMutex;
+    static QHash<QString, Ptr> translators;
+
+    QMutexLocker lock(&translatorsMutex);
+    Ptr &translator = translators[sysroot.toString()];
+    if (!translator)
+        translator = Ptr(new SysrootPathTranslator(sysroot));
+    return translator;
+}
+
+Utils::FileName SysrootPathTranslator::sysroot() const
+{
+    return m_sysroot;
+}
+
+/*!
+ * \brief SysrootPathTranslator::toHost
+ * Maps all container paths in \a containerPath into the sysroot,
+ * paths that are already inside the sysroot are left untouched
+ */
+QString SysrootPathTranslator::toHost(const QString &containerPath) const
+{
+    if (containerPath.isEmpty() || m_hostPrefix.isEmpty())
+        return containerPath;
+
+    QMutexLocker lock(&m_cacheMutex);
+    auto it = m_toHostCache.constFind(containerPath);
+    if (it != m_toHostCache.constEnd())
+        return it.value();
+
+    QString result = containerPath;
+    if (!result.startsWith(m_hostPrefix))
+        result.replace(m_toHostExp, m_replacement);
+
+    m_toHostCache.insert(containerPath, result);
+    return result;
+}
+
+/*!
+ * \brief SysrootPathTranslator::toContainer
+ * Strips the sysroot from all paths in \a hostPath
+ */
+QString SysrootPathTranslator::toContainer(const QString &hostPath) const
+{
+    if (hostPath.isEmpty() || m_hostPrefix.isEmpty())
+        return hostPath;
+
+    QMutexLocker lock(&m_cacheMutex);
+    auto it = m_toContainerCache.constFind(hostPath);
+    if (it != m_toContainerCache.constEnd())
+        return it.value();
+
+    QString result = hostPath;
+    if (result.contains(m_hostPrefix)) {
+        result.replace(m_toContainerExp, QString());
+        if (result.isEmpty())
+            result = QStringLiteral("/");
+    }
+
+    m_toContainerCache.insert(hostPath, result);
+    return result;
+}
+
+Utils::FileName SysrootPathTranslator::toHost(const Utils::FileName &containerPath) const
+{
+    return Utils::FileName::fromString(toHost(containerPath.toString()));
+}
+
+Utils::FileName SysrootPathTranslator::toContainer(const Utils::FileName &hostPath) const
+{
+    return Utils::FileName::fromString(toContainer(hostPath.toString()));
+}
+
+/*!
+ * \brief SysrootPathTranslator::resolve
+ * Returns the host file for \a containerPath with all symbolic links
+ * followed inside the sysroot. Absolute link targets are relative to the
+ * container root, so QFileInfo::canonicalFilePath can not be used here.
+ * The result is not memoized, the files can change with the container.
+ */
+QFileInfo SysrootPathTranslator::resolve(const QString &containerPath) const
+{
+    QString path = containerPath;
+    for (int hop = 0; hop < MAX_LINK_HOPS; hop++) {
+        QFileInfo info(m_hostPrefix + path);
+        if (!info.isSymLink())
+            return info;
+
+        QByteArray target(PATH_MAX, 0);
+        const ssize_t len = ::readlink(QFile::encodeName(info.filePath()).constData(),
+                                       target.data(), target.size());
+        if (len <= 0)
+            return info;
+        target.truncate(len);
+
+        const QString linkTarget = QFile::decodeName(target);
+        if (linkTarget.startsWith(QLatin1Char('/')))
+            path = QDir::cleanPath(linkTarget);
+        else
+            path = QDir::cleanPath(QFileInfo(path).path() + QLatin1Char('/') + linkTarget);
+    }
+    return QFileInfo(m_hostPrefix + path);
+}
+
+} // namespace Internal
+} // namespace LmBase
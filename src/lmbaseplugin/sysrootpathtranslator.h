@@ -0,0 +1,75 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#ifndef LMBASE_INTERNAL_SYSROOTPATHTRANSLATOR_H
+#define LMBASE_INTERNAL_SYSROOTPATHTRANSLATOR_H
+
+#include <utils/fileutils.h>
+
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QRegularExpression>
+#include <QSharedPointer>
+#include <QString>
+
+namespace LmBase {
+namespace Internal {
+
+/*!
+ * \brief The SysrootPathTranslator class
+ * Maps paths between the container and the host. All top level
+ * directories of the container are matched by one precompiled
+ * expression, results are memoized so each distinct path is only
+ * translated once. Instances are shared per sysroot and thread safe.
+ */
+class SysrootPathTranslator
+{
+public:
+    typedef QSharedPointer<SysrootPathTranslator> Ptr;
+
+    explicit SysrootPathTranslator(const Utils::FileName &sysroot);
+
+    static Ptr forSysroot (const Utils::FileName &sysroot);
+
+    Utils::FileName sysroot () const;
+
+    QString toHost (const QString &containerPath) const;
+    QString toContainer (const QString &hostPath) const;
+
+    Utils::FileName toHost (const Utils::FileName &containerPath) const;
+    Utils::FileName toContainer (const Utils::FileName &hostPath) const;
+
+    QFileInfo resolve (const QString &containerPath) const;
+
+private:
+    Utils::FileName m_sysroot;
+    QString m_hostPrefix;
+    QString m_replacement;
+    QRegularExpression m_toHostExp;
+    QRegularExpression m_toContainerExp;
+
+    mutable QMutex m_cacheMutex;
+    mutable QHash<QString, QString> m_toHostCache;
+    mutable QHash<QString, QString> m_toContainerCache;
+};
+
+} // namespace Internal
+} // namespace LmBase
+
+#endif // LMBASE_INTERNAL_SYSROOTPATHTRANSLATOR_H
@@ -0,0 +1,258 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#include "toolchainprobecache.h"
+#include "lmtargetregistry.h"
+#include "settings.h"
+#include "sysrootpathtranslator.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QDebug>
+
+namespace LmBase {
+namespace Internal {
+
+enum {
+    debug = 0
+};
+
+const char PROBE_CACHE_FILENAME[] = "toolchain-probes.cache";
+const quint32 PROBE_CACHE_MAGIC   = 0x4c4d5450; // "LMTP"
+const quint32 PROBE_CACHE_VERSION = 1;
+
+//every project part can use different flags, do not let a single
+//compiler grow without bounds
+const int MAX_ENTRIES_PER_COMPILER = 512;
+const int SAVE_DELAY = 5000;
+
+ToolChainProbeCache *ToolChainProbeCache::m_instance = nullptr;
+
+ToolChainProbeCache::ToolChainProbeCache(QObject *parent)
+    : QObject(parent)
+{
+    Q_ASSERT_X(!m_instance, Q_FUNC_INFO, "There can be only one ToolChainProbeCache instance");
+    m_instance = this;
+
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(SAVE_DELAY);
+    connect(&m_saveTimer, &QTimer::timeout, this, &ToolChainProbeCache::save);
+}
+
+ToolChainProbeCache::~ToolChainProbeCache()
+{
+    save();
+    m_instance = nullptr;
+}
+
+ToolChainProbeCache *ToolChainProbeCache::instance()
+{
+    return m_instance;
+}
+
+/*!
+ * \brief ToolChainProbeCache::compilerKey
+ * Returns the key for \a remoteCompiler inside \a containerName, it is the
+ * hash of the compiler binary and the image version of the target. The hash
+ * is only calculated again if size or modification time of the binary change.
+ * Returns a empty string if the compiler can not be found in the rootfs.
+ */
+QString ToolChainProbeCache::compilerKey(const QString &containerName, const QString &remoteCompiler)
+{
+    const TargetRegistry::TargetInfo info = TargetRegistry::instance()->targetInfo(containerName);
+    if (info.rootfs.isEmpty())
+        return QString();
+
+    const QFileInfo compiler = SysrootPathTranslator::forSysroot(Utils::FileName::fromString(info.rootfs))
+            ->resolve(remoteCompiler);
+    if (!compiler.isFile())
+        return QString();
+
+    const QString stampKey = compiler.filePath();
+    const qint64 modified = compiler.lastModified().toMSecsSinceEpoch();
+    {
+        QMutexLocker lock(&m_mutex);
+        const CompilerStamp stamp = m_stamps.value(stampKey);
+        if (stamp.size == compiler.size() && stamp.modified == modified) {
+            m_containerKeys[containerName].insert(stamp.key);
+            return stamp.key;
+        }
+    }
+
+    QFile file(compiler.filePath());
+    if (!file.open(QIODevice::ReadOnly))
+        return QString();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if (!hash.addData(&file))
+        return QString();
+    hash.addData(info.target.distribution.toUtf8());
+    hash.addData(info.target.version.toUtf8());
+
+    CompilerStamp stamp;
+    stamp.size = compiler.size();
+    stamp.modified = modified;
+    stamp.key = QString::fromLatin1(hash.result().toHex());
+
+    if (debug) qDebug()<<"Compiler"<<remoteCompiler<<"of"<<containerName<<"has the key"<<stamp.key;
+
+    QMutexLocker lock(&m_mutex);
+    m_stamps.insert(stampKey, stamp);
+    m_containerKeys[containerName].insert(stamp.key);
+    return stamp.key;
+}
+
+bool ToolChainProbeCache::lookup(const QString &compilerKey, ToolChainProbeCache::ProbeKind kind, const QStringList &flags, QByteArray *result) const
+{
+    if (compilerKey.isEmpty())
+        return false;
+
+    QMutexLocker lock(&m_mutex);
+    const auto compiler = m_entries.constFind(compilerKey);
+    if (compiler == m_entries.constEnd())
+        return false;
+
+    const auto entry = compiler->constFind(entryKey(kind, flags));
+    if (entry == compiler->constEnd())
+        return false;
+
+    *result = entry.value();
+    return true;
+}
+
+void ToolChainProbeCache::insert(const QString &compilerKey, ToolChainProbeCache::ProbeKind kind, const QStringList &flags, const QByteArray &result)
+{
+    if (compilerKey.isEmpty())
+        return;
+
+    {
+        QMutexLocker lock(&m_mutex);
+        QHash<QString, QByteArray> &entries = m_entries[compilerKey];
+        if (entries.size() >= MAX_ENTRIES_PER_COMPILER)
+            entries.clear();
+        entries.insert(entryKey(kind, flags), result);
+        m_dirty = true;
+    }
+
+    //probes run in worker threads, the timer lives in the GUI thread
+    QMetaObject::invokeMethod(&m_saveTimer, "start", Qt::QueuedConnection);
+}
+
+/*!
+ * \brief ToolChainProbeCache::invalidate
+ * Forgets all results of the compilers of \a containerName,
+ * used after the target was upgraded
+ */
+void ToolChainProbeCache::invalidate(const QString &containerName)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        foreach (const QString &key, m_containerKeys.take(containerName)) {
+            m_entries.remove(key);
+            for (auto it = m_stamps.begin(); it != m_stamps.end();) {
+                if (it.value().key == key)
+                    it = m_stamps.erase(it);
+                else
+                    ++it;
+            }
+        }
+        m_dirty = true;
+    }
+    m_saveTimer.start();
+}
+
+/*!
+ * \brief ToolChainProbeCache::save
+ * Writes the cache to the settings directory if it was changed
+ */
+void ToolChainProbeCache::save()
+{
+    QMutexLocker lock(&m_mutex);
+    if (!m_dirty)
+        return;
+
+    QSaveFile file(cacheFileName());
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning()<<"Unable to write the toolchain probe cache"<<file.fileName();
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_6);
+    out << PROBE_CACHE_MAGIC << PROBE_CACHE_VERSION;
+    out << m_entries << m_containerKeys;
+
+    if (!file.commit()) {
+        qWarning()<<"Unable to write the toolchain probe cache"<<file.fileName();
+        return;
+    }
+    m_dirty = false;
+}
+
+QString ToolChainProbeCache::entryKey(ToolChainProbeCache::ProbeKind kind, const QStringList &flags)
+{
+    return QString::number(kind) + QLatin1Char('\n') + flags.join(QLatin1Char('\n'));
+}
+
+QString ToolChainProbeCache::cacheFileName()
+{
+    return Settings::settingsPath()
+            .appendPath(QLatin1String(PROBE_CACHE_FILENAME))
+            .toString();
+}
+
+/*!
+ * \brief ToolChainProbeCache::load
+ * Restores the results of earlier sessions from the settings directory
+ */
+void ToolChainProbeCache::load()
+{
+    QFile file(cacheFileName());
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_6);
+
+    quint32 magic = 0, version = 0;
+    in >> magic >> version;
+    if (magic != PROBE_CACHE_MAGIC || version != PROBE_CACHE_VERSION) {
+        if (debug) qDebug()<<"Ignoring toolchain probe cache with unknown format version"<<version;
+        return;
+    }
+
+    QHash<QString, QHash<QString, QByteArray> > entries;
+    QHash<QString, QSet<QString> > containerKeys;
+    in >> entries >> containerKeys;
+    if (in.status() != QDataStream::Ok) {
+        qWarning()<<"Ignoring corrupted toolchain probe cache"<<file.fileName();
+        return;
+    }
+
+    QMutexLocker lock(&m_mutex);
+    m_entries = entries;
+    m_containerKeys = containerKeys;
+}
+
+} // namespace Internal
+} // namespace LmBase
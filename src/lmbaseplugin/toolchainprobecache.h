@@ -0,0 +1,94 @@
+/*
+ * Copyright 2017 Link Motion Oy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+ */
+
+#ifndef LMBASE_INTERNAL_TOOLCHAINPROBECACHE_H
+#define LMBASE_INTERNAL_TOOLCHAINPROBECACHE_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+
+namespace LmBase {
+namespace Internal {
+
+/*!
+ * \brief The ToolChainProbeCache class
+ * Remembers the results of probing the compilers of the targets, like the
+ * predefined macros, builtin header paths and the target ABI. Results are
+ * keyed by a hash of the compiler binary inside the target and the flags,
+ * so targets created from the same image share them. The cache is kept in
+ * the settings directory and can be used from any thread.
+ */
+class ToolChainProbeCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum ProbeKind {
+        PredefinedMacros,
+        SystemHeaderPaths,
+        SupportedAbis,
+        CompilerVersion
+    };
+
+    explicit ToolChainProbeCache(QObject *parent = 0);
+    ~ToolChainProbeCache();
+
+    static ToolChainProbeCache *instance ();
+
+    QString compilerKey (const QString &containerName, const QString &remoteCompiler);
+
+    bool lookup (const QString &compilerKey, ProbeKind kind, const QStringList &flags, QByteArray *result) const;
+    void insert (const QString &compilerKey, ProbeKind kind, const QStringList &flags, const QByteArray &result);
+
+    void invalidate (const QString &containerName);
+
+    void load ();
+
+public slots:
+    void save ();
+
+private:
+    struct CompilerStamp {
+        qint64 size = -1;
+        qint64 modified = -1;
+        QString key;
+    };
+
+    static QString entryKey (ProbeKind kind, const QStringList &flags);
+    static QString cacheFileName ();
+
+private:
+    static ToolChainProbeCache *m_instance;
+
+    mutable QMutex m_mutex;
+    QHash<QString, QHash<QString, QByteArray> > m_entries; //compiler key -> probe -> result
+    QHash<QString, QSet<QString> > m_containerKeys;        //container -> compiler keys
+    QHash<QString, CompilerStamp> m_stamps;                //compiler file in the rootfs -> key
+    bool m_dirty = false;
+    QTimer m_saveTimer;
+};
+
+} // namespace Internal
+} // namespace LmBase
+
+#endif // LMBASE_INTERNAL_TOOLCHAINPROBECACHE_H
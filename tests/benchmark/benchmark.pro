@@ -0,0 +1,37 @@
+####################################################################
+#
+# This file is part of the LinkMotion plugins.
+#
+# License: GNU Lesser General Public License v 2.1
+# Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+#
+# All rights reserved.
+# (C) 2017 Link Motion Oy
+####################################################################
+
+# Startup and kit autodetection benchmark, run it with "make benchmark".
+# The plugin needs to be built with TEST=1, the Qt Creator binary and the
+# target counts can be overridden with QTCREATOR_BIN and BENCHMARK_COUNTS.
+
+TEMPLATE = aux
+
+OTHER_FILES += \
+    run_benchmark.py \
+    stubs/benchstub.py \
+    stubs/lmsdk-target \
+    stubs/lmsdk-wrapper \
+    stubs/lxc-start
+
+isEmpty(QTCREATOR_BIN) {
+    QTCREATOR_BIN = $$(QTC_BUILD)
+    isEmpty(QTCREATOR_BIN): QTCREATOR_BIN = qtcreator
+    else: QTCREATOR_BIN = $$QTCREATOR_BIN/bin/qtcreator
+}
+
+isEmpty(BENCHMARK_COUNTS): BENCHMARK_COUNTS = 10,50,200,500
+
+QMAKE_EXTRA_TARGETS += benchmark
+benchmark.commands = python3 $$PWD/run_benchmark.py \
+    --qtcreator $$QTCREATOR_BIN \
+    --counts $$BENCHMARK_COUNTS \
+    --output $$OUT_PWD/benchmark-results.json
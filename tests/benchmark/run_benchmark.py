@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+#
+# Copyright 2017 Link Motion Oy.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation; version 2.1.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+#
+# Runs the startup and kit autodetection benchmark of the lmbaseplugin
+# against synthetic targets. The plugin has to be built with TEST=1.
+#
+# Every target count is measured in a fresh Qt Creator instance with its own
+# settings directory. For each run the total wall time, the number of
+# lmsdk-target/lmsdk-wrapper spawns and the peak RSS are recorded, together
+# with the phases measured inside the plugin. The result is written as JSON.
+
+import argparse
+import json
+import os
+import platform
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+STUB_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "stubs")
+DEFAULT_COUNTS = "10,50,200,500"
+RESULT_FORMAT_VERSION = 1
+
+
+def run_once(args, count):
+    workdir = tempfile.mkdtemp(prefix="lmsdk-bench-%d-" % count)
+    try:
+        spawn_log = os.path.join(workdir, "spawns.log")
+        plugin_result = os.path.join(workdir, "result.json")
+
+        env = dict(os.environ)
+        env.update({
+            "PATH": STUB_DIR + os.pathsep + env.get("PATH", ""),
+            "LMSDK_BENCH_TARGETS": str(count),
+            "LMSDK_BENCH_ROOT": os.path.join(workdir, "lxd"),
+            "LMSDK_BENCH_SPAWN_LOG": spawn_log,
+            "LMSDK_BENCH_RESULT": plugin_result,
+            # make sure the plugin never talks to a real LXD
+            "LMSDK_LXD_SOCKET": os.path.join(workdir, "no-lxd.socket"),
+            "QT_QPA_PLATFORM": env.get("QT_QPA_PLATFORM", "offscreen"),
+        })
+
+        cmd = [args.qtcreator, "-settingspath", os.path.join(workdir, "settings")]
+        if args.pluginpath:
+            cmd += ["-pluginpath", args.pluginpath]
+        cmd += ["-test", "lmbaseplugin"]
+
+        started = time.monotonic()
+        proc = subprocess.Popen(cmd, env=env,
+                                stdout=subprocess.DEVNULL if not args.verbose else None,
+                                stderr=subprocess.DEVNULL if not args.verbose else None)
+        _, status, usage = os.wait4(proc.pid, 0)
+        wall_ms = int((time.monotonic() - started) * 1000)
+        proc.returncode = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -os.WTERMSIG(status)
+
+        spawns = 0
+        if os.path.exists(spawn_log):
+            with open(spawn_log) as log:
+                spawns = sum(1 for _ in log)
+
+        phases = []
+        if os.path.exists(plugin_result):
+            with open(plugin_result) as result:
+                phases = json.load(result).get("phases", [])
+
+        return {
+            "targets": count,
+            "exit_code": proc.returncode,
+            "wall_ms": wall_ms,
+            "spawns": spawns,
+            # ru_maxrss is reported in kilobytes on Linux
+            "peak_rss_kb": usage.ru_maxrss,
+            "phases": phases,
+        }
+    finally:
+        if not args.keep:
+            shutil.rmtree(workdir, ignore_errors=True)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark lmbaseplugin startup with synthetic targets")
+    parser.add_argument("--qtcreator", default="qtcreator", help="Qt Creator binary to run")
+    parser.add_argument("--pluginpath", help="additional plugin path containing the TEST=1 build")
+    parser.add_argument("--counts", default=DEFAULT_COUNTS, help="comma separated target counts")
+    parser.add_argument("--output", default="benchmark-results.json", help="result file")
+    parser.add_argument("--keep", action="store_true", help="keep the temporary directories")
+    parser.add_argument("--verbose", action="store_true", help="show the Qt Creator output")
+    args = parser.parse_args()
+
+    if not shutil.which(args.qtcreator):
+        sys.stderr.write("%s was not found\n" % args.qtcreator)
+        return 1
+
+    runs = []
+    for count in [int(c) for c in args.counts.split(",") if c]:
+        run = run_once(args, count)
+        runs.append(run)
+        print("%4d targets: %6d ms, %5d spawns, %7d kB peak RSS%s"
+              % (count, run["wall_ms"], run["spawns"], run["peak_rss_kb"],
+                 "" if run["exit_code"] == 0 else " (FAILED)"))
+
+    result = {
+        "version": RESULT_FORMAT_VERSION,
+        "timestamp": int(time.time()),
+        "host": platform.node(),
+        "cpus": os.cpu_count(),
+        "runs": runs,
+    }
+    with open(args.output, "w") as out:
+        json.dump(result, out, indent=2)
+
+    return 0 if all(run["exit_code"] == 0 for run in runs) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
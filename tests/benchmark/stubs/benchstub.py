@@ -0,0 +1,54 @@
+#
+# Copyright 2017 Link Motion Oy.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation; version 2.1.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+#
+# Helpers shared by the benchmark stubs.
+
+import fcntl
+import os
+
+
+def container_name(index):
+    return "bench-%03d" % index
+
+
+def architecture(container):
+    """Every fourth target uses the host architecture, so it gets a container device"""
+    try:
+        index = int(container.rsplit("-", 1)[1])
+    except (IndexError, ValueError):
+        index = 1
+    return os.uname().machine if index % 4 == 0 else "aarch64"
+
+
+def log_spawn(tool, args):
+    path = os.environ.get("LMSDK_BENCH_SPAWN_LOG")
+    if not path:
+        return
+    with open(path, "a") as log:
+        fcntl.flock(log, fcntl.LOCK_EX)
+        log.write("%s %s\n" % (tool, " ".join(args)))
+
+
+def rootfs(container):
+    """Returns the fake rootfs of container, it is created on first use.
+    The layout mirrors LXD, the wrappers are created next to the rootfs."""
+    base = os.environ.get("LMSDK_BENCH_ROOT", "/tmp/lmsdk-bench")
+    path = os.path.join(base, "containers", container, "rootfs")
+    bindir = os.path.join(path, "usr", "bin")
+    if not os.path.isdir(bindir):
+        os.makedirs(bindir, exist_ok=True)
+    return path
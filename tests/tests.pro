@@ -0,0 +1,13 @@
+####################################################################
+#
+# This file is part of the LinkMotion plugins.
+#
+# License: GNU Lesser General Public License v 2.1
+# Author: Benjamin Zeller <benjamin.zeller@link-motion.com>
+#
+# All rights reserved.
+# (C) 2017 Link Motion Oy
+####################################################################
+
+TEMPLATE = subdirs
+SUBDIRS = benchmark